@@ -0,0 +1,434 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "cycle_clock.hpp"
+#include "latency_histogram.hpp"
+#include "matching_engine.hpp"
+#include "perf_counters.hpp"
+
+using TradeDS::CycleClock, TradeDS::LatencyHistogram, TradeDS::PerfCounters;
+
+/**
+ * hardware counters of the timed operations, nullptr unless run with --perf_counters
+ */
+PerfCounters *perf_counters = nullptr;
+
+/**
+ * order-size distributions of the resting book
+ */
+enum SizeDistribution : int64_t {
+    FIXED = 0,          // every order is 100
+    UNIFORM = 1,        // uniform in [1, 200]
+    HEAVY_TAILED = 2,   // pareto, mostly small orders and the odd block of up to 10000
+};
+
+/**
+ * a MatchingEngine with one book of a given shape, resting symmetrically around MID\n
+ * shape comes from the benchmark arguments: levels per side, orders per level, SizeDistribution
+ */
+class ShapedBook {
+public:
+    struct RestingOrder {
+        uint64_t order_id;
+        Side side;
+        int64_t price;
+        int64_t volume;
+    };
+
+    static constexpr int64_t MID = 100000;
+
+    const int64_t levels;
+    const int64_t depth;
+    const int64_t size_distribution;
+
+    MatchingEngine engine;
+    InstrumentId instrument;
+    uint64_t next_order_id = 1;     // order ids are never reused
+    std::mt19937_64 rng{42};
+    vector<RestingOrder> resting;   // every order placed by fill_level, local updates kept in sync
+
+    explicit ShapedBook(const benchmark::State &state)
+            : levels{state.range(0)}, depth{state.range(1)}, size_distribution{state.range(2)} {
+        const size_t order_count = 2 * this->levels * this->depth;
+        this->instrument = this->engine.create_book("BENCH", 1, order_count + 1024, 2 * this->levels + 64);
+        this->resting.reserve(order_count);
+        for (int64_t i = 0; i < this->levels; i++) {
+            this->fill_level(Side::Buy, this->price_of(Side::Buy, i));
+            this->fill_level(Side::Sell, this->price_of(Side::Sell, i));
+        }
+    }
+
+    /**
+     * get the price of the i-th level of a side, 0 is the touch
+     */
+    static int64_t price_of(Side side, int64_t i) { return side == Side::Buy ? MID - 1 - i : MID + 1 + i; }
+
+    int64_t draw_volume() {
+        switch (this->size_distribution) {
+            case UNIFORM:
+                return (int64_t) (this->rng() % 200) + 1;
+            case HEAVY_TAILED: {
+                const double u = std::uniform_real_distribution<double>(1e-9, 1.0)(this->rng);
+                return std::min<int64_t>((int64_t) (10.0 / std::pow(u, 1.0 / 1.5)), 10000);
+            }
+            default:
+                return 100;
+        }
+    }
+
+    int64_t draw_level() { return (int64_t) (this->rng() % this->levels); }
+
+    /**
+     * add depth passive orders at price
+     */
+    void fill_level(Side side, int64_t price) {
+        vector<Fill> fills;
+        for (int64_t n = 0; n < this->depth; n++) {
+            const RestingOrder order{this->next_order_id++, side, price, this->draw_volume()};
+            this->engine.add_order(order.order_id, this->instrument, side, price, order.volume, fills);
+            this->resting.push_back(order);
+        }
+    }
+};
+
+/**
+ * time one operation with CycleClock, record it and hand it to benchmark as manual time\n
+ * with --perf_counters, hardware counters count the operation too, the prctl calls stay out of the timing
+ */
+template<typename Operation>
+inline void timed(benchmark::State &state, LatencyHistogram &histogram, Operation &&operation) {
+    if (perf_counters != nullptr) PerfCounters::start();
+    const uint64_t start = CycleClock::now();
+    operation();
+    const uint64_t ticks = CycleClock::now() - start;
+    if (perf_counters != nullptr) PerfCounters::stop();
+
+    histogram.record(ticks);
+    state.SetIterationTime(CycleClock::to_ns(ticks) * 1e-9);
+}
+
+/**
+ * publish latency percentiles in nanoseconds and throughput\n
+ * with --perf_counters, also every hardware event per operation, as <event>_per_op, and instructions per cycle;
+ * an iteration is one operation, one burst for BM_Batch
+ */
+void report(benchmark::State &state, const LatencyHistogram &histogram) {
+    state.counters["p50_ns"] = CycleClock::to_ns(histogram.percentile(0.50));
+    state.counters["p99_ns"] = CycleClock::to_ns(histogram.percentile(0.99));
+    state.counters["p99.9_ns"] = CycleClock::to_ns(histogram.percentile(0.999));
+    state.counters["max_ns"] = CycleClock::to_ns(histogram.max());
+    state.SetItemsProcessed((int64_t) state.iterations());
+
+    if (perf_counters != nullptr) {
+        for (int event = 0; event < PerfCounters::EVENTS; event++) {
+            if (!perf_counters->available((PerfCounters::Event) event)) continue;
+            state.counters[std::string(PerfCounters::NAMES[event]) + "_per_op"] = benchmark::Counter(
+                    perf_counters->read((PerfCounters::Event) event), benchmark::Counter::kAvgIterations);
+        }
+        const double cycles = perf_counters->read(PerfCounters::CYCLES);
+        if (cycles > 0) state.counters["ipc"] = perf_counters->read(PerfCounters::INSTRUCTIONS) / cycles;
+        perf_counters->reset();     // for the next run, counting is off in between
+    }
+}
+
+/**
+ * passive insert at a random level of the book, the order is pulled again untimed
+ */
+static void BM_Insert(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    vector<Fill> fills;
+
+    for (auto _: state) {
+        const Side side = (book.rng() & 1) ? Side::Buy : Side::Sell;
+        const int64_t price = ShapedBook::price_of(side, book.draw_level());
+        const int64_t volume = book.draw_volume();
+        const uint64_t order_id = book.next_order_id++;
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.add_order(order_id, book.instrument, side, price, volume, fills));
+        });
+        book.engine.pull_order(order_id);
+    }
+    report(state, histogram);
+}
+
+/**
+ * cancel of a random resting order, it is replaced untimed by a new order at the same price
+ */
+static void BM_Cancel(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    vector<Fill> fills;
+
+    for (auto _: state) {
+        auto &order = book.resting[book.rng() % book.resting.size()];
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.pull_order(order.order_id));
+        });
+        order.order_id = book.next_order_id++;
+        book.engine.add_order(order.order_id, book.instrument, order.side, order.price, order.volume, fills);
+    }
+    report(state, histogram);
+}
+
+/**
+ * in-place amend of a random resting order: same price, volume not increased, priority kept
+ */
+static void BM_AmendInPlace(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    vector<Fill> fills;
+
+    for (auto _: state) {
+        auto &order = book.resting[book.rng() % book.resting.size()];
+        order.volume = (int64_t) (book.rng() % order.volume) + 1;
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.amend_order(book.instrument, order.order_id,
+                                                             order.price, order.volume, fills));
+        });
+    }
+    report(state, histogram);
+}
+
+/**
+ * amend of a random resting order to another, non-crossing, level of its side
+ */
+static void BM_AmendReprice(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    vector<Fill> fills;
+
+    for (auto _: state) {
+        auto &order = book.resting[book.rng() % book.resting.size()];
+        order.price = ShapedBook::price_of(order.side, book.draw_level());
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.amend_order(book.instrument, order.order_id,
+                                                             order.price, order.volume, fills));
+        });
+    }
+    report(state, histogram);
+}
+
+/**
+ * aggressive buy taking out exactly the best state.range(3) ask levels, which are refilled untimed
+ */
+static void BM_Sweep(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    const int64_t swept_levels = std::min(state.range(3), book.levels);
+    uint64_t fill_count = 0;
+    auto on_fill = [&fill_count](const Fill &) { fill_count++; };
+
+    for (auto _: state) {
+        const int64_t price = ShapedBook::price_of(Side::Sell, swept_levels - 1);
+        int64_t volume = 0;
+        for (int64_t i = 0; i < swept_levels; i++) {
+            volume += (int64_t) book.engine.get_book(book.instrument)->get_volume_by_limit(
+                    Side::Sell, ShapedBook::price_of(Side::Sell, i));
+        }
+        const uint64_t order_id = book.next_order_id++;
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.add_order(order_id, book.instrument, Side::Buy, price, volume,
+                                                           on_fill));
+        });
+
+        // swept orders are gone from the book, forget about them before refilling
+        book.resting.erase(std::remove_if(book.resting.begin(), book.resting.end(), [&](const auto &order) {
+            return order.side == Side::Sell && order.price <= price;
+        }), book.resting.end());
+        for (int64_t i = 0; i < swept_levels; i++) book.fill_level(Side::Sell, ShapedBook::price_of(Side::Sell, i));
+    }
+    report(state, histogram);
+    state.counters["fills_per_sweep"] = benchmark::Counter((double) fill_count / (double) state.iterations());
+}
+
+/**
+ * a burst of state.range(3) cancel and replace pairs on random resting orders through process_batch\n
+ * latency counters are per burst, items_per_second counts commands
+ */
+static void BM_Batch(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    const auto pairs = (size_t) state.range(3);
+    vector<OrderCommand> commands(2 * pairs);
+    vector<CommandFill> fills;
+
+    for (auto _: state) {
+        for (size_t i = 0; i < pairs; i++) {
+            auto &order = book.resting[book.rng() % book.resting.size()];
+            commands[2 * i] = {OrderCommand::PULL, OrderType::LIMIT, order.side, book.instrument, order.order_id, 0, 0};
+            order.order_id = book.next_order_id++;
+            commands[2 * i + 1] = {OrderCommand::ADD, OrderType::LIMIT, order.side, book.instrument, order.order_id,
+                                   order.price, order.volume};
+        }
+
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.process_batch(commands.data(), commands.size(), fills));
+        });
+    }
+    report(state, histogram);
+    state.SetItemsProcessed((int64_t) (state.iterations() * commands.size()));
+}
+
+/**
+ * best bid and offer of both sides
+ */
+static void BM_TopOfBook(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+
+    for (auto _: state) {
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.get_top_of_book(book.instrument));
+        });
+    }
+    report(state, histogram);
+}
+
+/**
+ * aggregated depth of the ten best bid levels, as a router would query it
+ */
+static void BM_Depth(benchmark::State &state) {
+    ShapedBook book(state);
+    LatencyHistogram histogram;
+    DepthLevel levels[10];
+
+    for (auto _: state) {
+        timed(state, histogram, [&] {
+            benchmark::DoNotOptimize(book.engine.get_depth(book.instrument, Side::Buy, 10, levels));
+            benchmark::ClobberMemory();
+        });
+    }
+    report(state, histogram);
+}
+
+/**
+ * Book-level insert then cancel of a passive order at a random level, with its API price converted to ticks by the
+ * Book, on a Book of state.range(0) levels per side and state.range(1) orders per level\n
+ * instantiated for TradeDS::Book, TradeDS::WindowBook and TradeDS::FixedTickBook, to compare tick policies and level
+ * storages on the same flow
+ */
+template<typename BookType>
+static void BM_BookInsertCancel(benchmark::State &state) {
+    const int64_t UNIT = 5;
+    const int64_t levels = state.range(0);
+    const int64_t depth = state.range(1);
+    BookType book("BENCH", UNIT, (size_t) (2 * levels * depth + 1024), (size_t) (2 * levels + 64));
+    LatencyHistogram histogram;
+    std::mt19937_64 rng{42};
+    uint64_t next_order_id = 1;
+    for (int64_t i = 0; i < levels; i++) {
+        for (int64_t n = 0; n < depth; n++) {
+            for (const Side side: {Side::Buy, Side::Sell}) {
+                const int64_t ticks = book.to_ticks(ShapedBook::price_of(side, i) * UNIT);
+                book.insert(book.create_order(next_order_id++, side, ticks, 100));
+            }
+        }
+    }
+
+    for (auto _: state) {
+        const Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+        const int64_t price = ShapedBook::price_of(side, (int64_t) (rng() % levels)) * UNIT;
+        const uint64_t order_id = next_order_id++;
+
+        timed(state, histogram, [&] {
+            TradeDS::Order *order = book.insert(book.create_order(order_id, side, book.to_ticks(price), 100));
+            benchmark::DoNotOptimize(book.remove(order));
+        });
+    }
+    report(state, histogram);
+}
+
+/**
+ * book shapes: levels per side, orders per level, SizeDistribution
+ */
+static void book_shapes(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"levels", "depth", "sizes"});
+    benchmark->Args({10, 5, FIXED});            // thin liquid book
+    benchmark->Args({100, 10, UNIFORM});        // typical equity book
+    benchmark->Args({50, 100, UNIFORM});        // deep queues at few prices
+    benchmark->Args({1000, 2, HEAVY_TAILED});   // wide sparse book with blocks
+}
+
+/**
+ * book shapes plus the number of levels an aggressive order takes out
+ */
+static void sweep_shapes(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"levels", "depth", "sizes", "swept"});
+    benchmark->Args({10, 5, FIXED, 1});
+    benchmark->Args({100, 10, UNIFORM, 1});
+    benchmark->Args({100, 10, UNIFORM, 5});
+    benchmark->Args({1000, 2, HEAVY_TAILED, 20});
+}
+
+/**
+ * book shapes plus the number of cancel and replace pairs per burst
+ */
+static void batch_shapes(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"levels", "depth", "sizes", "pairs"});
+    benchmark->Args({100, 10, UNIFORM, 1});
+    benchmark->Args({100, 10, UNIFORM, 64});
+    benchmark->Args({1000, 2, HEAVY_TAILED, 64});
+}
+
+BENCHMARK(BM_Insert)->Apply(book_shapes)->UseManualTime();
+BENCHMARK(BM_Cancel)->Apply(book_shapes)->UseManualTime();
+BENCHMARK(BM_AmendInPlace)->Apply(book_shapes)->UseManualTime();
+BENCHMARK(BM_AmendReprice)->Apply(book_shapes)->UseManualTime();
+BENCHMARK(BM_Sweep)->Apply(sweep_shapes)->UseManualTime();
+BENCHMARK(BM_Batch)->Apply(batch_shapes)->UseManualTime();
+BENCHMARK(BM_TopOfBook)->Apply(book_shapes)->UseManualTime();
+BENCHMARK(BM_Depth)->Apply(book_shapes)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_BookInsertCancel, TradeDS::Book)->Apply(book_shapes)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_BookInsertCancel, TradeDS::WindowBook)->Apply(book_shapes)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_BookInsertCancel, TradeDS::FixedTickBook)->Apply(book_shapes)->UseManualTime();
+
+/**
+ * benchmark's own main, plus --perf_counters\n
+ * results go out as benchmark reports them: --benchmark_format=json, or --benchmark_out=<file> which defaults to
+ * JSON, carries every counter for tracking across commits
+ */
+int main(int argc, char **argv) {
+    bool counted = false;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--perf_counters") == 0) {
+            counted = true;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    PerfCounters counters;
+    if (counted) {
+        if (counters.available()) {
+            counters.reset();
+            perf_counters = &counters;
+        } else {
+            std::fprintf(stderr, "--perf_counters: perf_event_open failed, see /proc/sys/kernel/perf_event_paranoid; "
+                                 "running without\n");
+        }
+    }
+    benchmark::AddCustomContext("perf_counters", perf_counters != nullptr ? "on" : "off");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
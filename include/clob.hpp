@@ -3,114 +3,408 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <unordered_map>
 
 #include <utility>
 #include <sstream>
+#include <vector>
 
-#include "sparse_set.hpp"
+#include "instrumentation.hpp"
+#include "level_storage.hpp"
+#include "object_pool.hpp"
+#include "seqlock.hpp"
+#include "snapshot_format.hpp"
+#include "spsc_ring.hpp"
+#include "tick_policy.hpp"
 #include "types.hpp"
 
-using std::ostream, std::stringstream, std::to_string, std::unordered_map;
+using std::ostream, std::stringstream, std::to_string, std::vector, std::endl;
 
 namespace TradeDS {
     struct Order;
     struct Limit;
 
-    class Book;
+    class BookBase;
+
+    template<typename TickPolicy, typename LevelStorage>
+    class BasicBook;
 
     /**
-     * an struct containing Order information and chaining information
+     * A node of an intrusive, circular, doubly linked list of all resting and stop Orders of one owner, see
+     * MatchingEngine::mass_cancel; the head of a list is a node without order\n
+     * unlinking is O(1) and needs no lookup of the list head
      */
-    struct Order {
-        const uint64_t order_id;
-        const Side side;
-        double price;
-        uint64_t volume;
+    struct OwnerLink {
+        OwnerLink *prev;    // nullptr while not linked
+        OwnerLink *next;
+        Order *order;       // nullptr for a list head
 
-        Limit *limit = nullptr;
-        Order *prev = nullptr;
+        /**
+         * link this node in front of another, at the tail of the list when next is its head
+         * @param next node of a list, the head or a linked node
+         */
+        void link_before(OwnerLink *const next) {
+            this->prev = next->prev;
+            this->next = next;
+            next->prev->next = this;
+            next->prev = this;
+        }
+
+        /**
+         * take this node out of its list, no-op if not linked
+         */
+        void unlink() {
+            if (this->prev == nullptr) return;
+            this->prev->next = this->next;
+            this->next->prev = this->prev;
+            this->prev = nullptr;
+            this->next = nullptr;
+        }
+    };
+
+    /**
+     * an struct containing Order information and chaining information\n
+     * price is expressed in integer ticks of the owning Book's unit\n
+     * an Order is the handle used by the Book-level API, it always knows which Book it belongs to\n
+     * a BookBase is the part of a book common to all its level storages, an owner holding a single kind of\n
+     * Book may static_cast it back\n
+     * \n
+     * The first cache line holds every field read by the matching walk, so walking a Limit costs one miss
+     * per Order; Orders are aligned by their pool\n
+     * The second holds the owner list link, only ever touched for an Order with an owner: it isn't even
+     * initialised otherwise, and the destructor reads owner before it, together with the self-trade prevention the
+     * Order matches with again when repriced; and the reserve of an iceberg Order, only ever touched if iceberg
+     * is set\n
+     * \n
+     * An iceberg Order displays volume and keeps hidden in reserve: once volume trades out, up to peak of hidden is
+     * displayed again and the Order moves to the tail of its Limit, in place, keeping its order_id and its address;
+     * Limit and Book volumes, and so the top of book and depth, only count displayed volume
+     */
+    struct alignas(64) Order {
+        // hot, read or written by match, detach and insert
+        uint64_t volume;
         Order *next = nullptr;
+        Order *prev = nullptr;
+        Limit *limit = nullptr;
+        const uint64_t order_id;    // reported with every fill
+        int64_t price;              // in ticks
+
+        // cold
+        BookBase *book = nullptr;
+        const Side side;
+        bool iceberg = false;       // read by the match only once volume is out, see set_reserve
+        const OwnerId owner;        // read by the match only for self-trade prevention, same cache line
+
+        // second cache line
+        OwnerLink owner_link;       // owner list, valid only if owner isn't 0
+        uint64_t hidden;            // reserve not displayed yet, valid only if iceberg
+        uint64_t peak;              // volume displayed by each refresh, valid only if iceberg
+        StpMode stp;                // self-trade prevention of the Order, valid only if owner isn't 0
 
-        Order(uint64_t order_id, Side side, double limitPrice, uint64_t volume) : order_id{order_id}, side{side},
-                                                                                  price{limitPrice},
-                                                                                  volume{volume} {};
+        Order(uint64_t order_id, Side side, int64_t limitPrice, uint64_t volume, OwnerId owner = 0,
+              StpMode stp = StpMode::NONE) : volume{volume}, order_id{order_id}, price{limitPrice}, side{side},
+                                             owner{owner} {
+            if (owner != 0) {
+                this->owner_link = OwnerLink{nullptr, nullptr, this};
+                this->stp = stp;
+            }
+        };
+
+        /**
+         * leave the owner list, if linked; every way an Order leaves its Book releases it through here
+         */
+        ~Order() {
+            if (this->owner != 0) this->owner_link.unlink();
+        }
+
+        /**
+         * make this Order an iceberg Order, before it is inserted
+         * @param hidden_volume volume kept in reserve, on top of volume
+         * @param peak_volume volume displayed on every refresh, positive
+         */
+        void set_reserve(uint64_t hidden_volume, uint64_t peak_volume) {
+            this->iceberg = true;
+            this->hidden = hidden_volume;
+            this->peak = peak_volume;
+        }
 
         string toString() const;
     };
 
+    // size budget, a regression here costs a second cache miss per Order in every matching walk
+    static_assert(offsetof(Order, owner_link) == 64, "the matching walk must only touch the first cache line");
+    static_assert(sizeof(Order) == 128, "an Order must fit in exactly two cache lines");
 
     /**
-     * A Limit Price, containing all orders with respected price, chained in double linked list chronological order
+     * The symbol and price unit of a book, independent of how the book stores its levels\n
+     * All prices inside a Book are integer ticks, a tick being one unit of the API price\n
+     * use to_ticks and to_price to convert at the API edge
      */
-    struct Limit {
-        const double price;
-        size_t size = 0;
-        unsigned long long int volume = 0;
+    class BookBase {
+    public:
+        const string symbol;
+        const int64_t unit;  // API price increment of one tick
 
         /**
-         * Order in this Limit price with highest priority
+         * convert an API price into ticks of this Book\n
+         * @param price API price
+         * @return price in ticks
+         * @return 0 if price is not a positive multiple of unit
          */
-        Order *front_order = nullptr;
+        int64_t to_ticks(int64_t price) const {
+            if (price <= 0 || price % this->unit != 0) return 0;
+            return price / this->unit;
+        }
+
         /**
-         * Order in this Limit price with lowest priority
-        */
-        Order *tail_order = nullptr;
+         * convert a price in ticks of this Book back into an API price
+         * @param ticks price in ticks
+         * @return API price
+         */
+        int64_t to_price(int64_t ticks) const { return ticks * this->unit; }
 
-        explicit Limit(double limitPrice) : price{limitPrice} {};
+    protected:
+        BookBase(string symbol, int64_t unit) : symbol{std::move(symbol)}, unit{unit} {};
     };
 
     /**
      * An "Central Limit Order Book", contain all order from both side and metadata\n
      * Internal correctness is guaranteed via guarded modifying methods\n
      * Meaning Orders are in correct storage position and priority  and metadata is updated when necessary\n
+     * \n
+     * All prices inside a Book are integer ticks, a tick being one BookBase::unit of the API price\n
+     * \n
+     * How API prices map to ticks is chosen by TickPolicy:\n
+     * - TradeDS::RuntimeTick, unit given at construction, any positive price, the default\n
+     * - TradeDS::FixedTick, unit and price band as compile-time constants, for instruments configured up front\n
+     * \n
+     * How the non-empty Limits of each side are indexed by price is chosen by LevelStorage:\n
+     * - TradeDS::BasicSparseLevels, absolute price index, sized for the band of the TickPolicy, the default;
+     * TradeDS::Book\n
+     * - TradeDS::WindowLevels, circular window around the touch plus overflow, TradeDS::WindowBook\n
+     * \n
+     * Book, WindowBook and FixedTickBook are instantiated in clob.cpp, include clob_impl.hpp to instantiate any other
+     * BasicBook
+     *
+     * @tparam TickPolicy tick policy, see tick_policy.hpp
+     * @tparam LevelStorage level storage of one side
      */
-    class Book {
+    template<typename TickPolicy = RuntimeTick, typename LevelStorage = BasicSparseLevels<TickPolicy::MAX_TICK>>
+    class BasicBook : public BookBase {
     private:
-        unordered_map<uint64_t, Order *> orders;    // O(1) order access
-        SparseSet<Limit *> *buy_set = new SparseSet<Limit *>(4096);
-        SparseSet<Limit *> *sell_set = new SparseSet<Limit *>(4096);
+        ObjectPool<Order> order_pool;   // storage of all Orders in this Book
+        LevelStorage buy_set{Side::Buy};
+        LevelStorage sell_set{Side::Sell};
         uint64_t order_count = 0;
         int64_t buy_volume = 0;
         int64_t sell_volume = 0;
+        int64_t hidden_buy_volume = 0;              // reserves of iceberg Orders, not part of buy_volume
+        int64_t hidden_sell_volume = 0;
         Limit *highest_buy = nullptr;
         Limit *lowest_sell = nullptr;
+        bool auction = false;                       // see set_auction
+        BestBidOffer published_top;                 // last value stored in top_of_book, writer side copy
+        Seqlock<BestBidOffer> top_of_book;          // read by other threads, on a cache line of its own
+        int64_t stale_buy = 0;                      // price of an emptied best Limit not replaced yet, see withdraw
+        int64_t stale_sell = 0;
+
+        // trigger book, stop orders chained in Limits at their stop price, see insert_stop
+        BasicSparseLevels<TickPolicy::MAX_TICK> buy_stops{Side::Sell};     // iterated from the lowest stop price
+        BasicSparseLevels<TickPolicy::MAX_TICK> sell_stops{Side::Buy};     // iterated from the highest stop price
+        Limit *lowest_buy_stop = nullptr;
+        Limit *highest_sell_stop = nullptr;
+        size_t stop_count = 0;
+        int64_t last_price = 0;                     // price of the last trade in ticks, 0 before the first one
+
+        // scratch ladder of the crossing price range, reused by every equilibrium; one entry per candidate price
+        vector<const Limit *> crossing_bids;        // Buy Limits of the range, highest first
+        vector<int64_t> ladder_prices;              // in ticks, ascending
+        vector<int64_t> ladder_executable;          // Sell volume at or below the price, then executable volume
+        vector<int64_t> ladder_surplus;             // Buy volume below the price, then Buy minus Sell volume
 
         /**
-         * if an order_id exists\n
-         * @param order_id target order_id
-         * @return True if order exist, False otherwise
+         * a level touched by the current message, with its state before the message
          */
-        bool exist(uint64_t order_id) const;
+        struct DirtyLevel {
+            Side side;
+            int64_t price;
+            uint64_t volume;
+            size_t size;
+        };
 
-    public:
-        const string symbol;
-        const double unit;  // unit between each price, 0.01 by default
+        SpscRing<LevelDelta> *delta_feed = nullptr;  // optional, see set_delta_feed
+        InstrumentId delta_instrument = 0;
+        vector<DirtyLevel> dirty_levels;            // only tracked while a delta feed is set
+
+        /**
+         * remember the state of a level before it is modified, once per message, if a delta feed is set
+         * @param side Side of the resting orders
+         * @param price in ticks
+         * @param limit the Limit at price, nullptr if the level doesn't exist yet
+         */
+        void note_level(Side side, int64_t price, const Limit *limit) {
+            if (this->delta_feed != nullptr) this->track_level(side, price, limit);
+        }
+
+        /**
+         * see note_level
+         */
+        void track_level(Side side, int64_t price, const Limit *limit);
+
+        /**
+         * compare every dirty level with its state before the message and push the deltas, see publish_deltas
+         */
+        void flush_deltas();
+
+        /**
+         * republish top_of_book if the best Limit of a side changed price or volume\n
+         * called by every modifying method that may have touched the best Limit
+         * @param side Side of the resting orders
+         */
+        void publish_touch(Side side);
+
+        /**
+         * find the next non-empty Limit after a given price, moving away from the touch
+         * @param side Side of the resting orders
+         * @param price in ticks, exclusive
+         * @return reference to TradeDS::Limit, nullptr if there is none
+         */
+        Limit *find_next_limit(Side side, int64_t price) const;
+
+        /**
+         * retire a Limit that just became empty\n
+         * it is removed from its LevelStorage, which owns it\n
+         * if it was the best Limit, the next non-empty one is looked up in the LevelStorage\n
+         * time-complexity that of LevelStorage::next
+         * @param side
+         * @param limit an empty Limit of this Book
+         */
+        void vacate(Side side, Limit *limit);
+
+        /**
+         * take an Order out of its Limit's chain and update the Limit's size and volume, nothing else
+         * @param limit the Limit the Order is chained in
+         * @param order
+         */
+        static void unchain(Limit *limit, Order *order);
+
+        /**
+         * take an Order out of its Limit's chain and update Limit and Book metadata, see detach
+         * @param order an Order resting in this Book
+         * @return the Limit the Order was in, possibly empty now
+         */
+        Limit *unlink(Order *order);
+
+        /**
+         * take traded volume off an Order in place, updating Limit and Book metadata
+         * @param order an Order resting in this Book, with at least volume left
+         * @param volume
+         */
+        void reduce(Order *order, uint64_t volume);
+
+        /**
+         * display the next peak of an iceberg Order whose volume traded out, moving it to the tail of its Limit
+         * @param order an iceberg Order resting in this Book, without volume left and with hidden volume
+         */
+        void replenish(Order *order);
+
+        /**
+         * take a fully traded Order out of the Book and destruct it, see detach
+         * @param order an Order resting in this Book, without volume left
+         */
+        void retire(Order *order);
+
+        /**
+         * the matching walk behind both match overloads, see match
+         * @tparam PREVENT whether resting orders of owner are checked for self-trades, fixed per walk so a walk
+         * without self-trade prevention carries no owner comparison
+         */
+        template<bool PREVENT, typename FillHandler, typename PreventHandler>
+        uint64_t walk(Side side, int64_t limit_price, uint64_t volume, OwnerId owner, StpMode stp,
+                      FillHandler &on_fill, PreventHandler &on_prevented);
 
+    public:
         /**
          * create a new central limit order book, with a immutable symbol and price unit\n
          * @param symbol the symbol of product
-         * @param unit the unit of order price; for example, price of 2.51 is in unit of 0.01
+         * @param unit the API price increment of one tick; for example, with prices quoted in cents and a
+         * 5 cent tick, unit is 5; ignored by a TradeDS::FixedTick Book
+         * @param order_capacity optional, number of Orders to preallocate
+         * @param limit_capacity optional, number of Limits to preallocate
          */
-        explicit Book(string symbol, double unit) : symbol{std::move(symbol)}, unit{unit} {};
+        explicit BasicBook(string symbol, int64_t unit, size_t order_capacity = 0, size_t limit_capacity = 0)
+                : BookBase{std::move(symbol), TickPolicy::unit(unit)}, order_pool{order_capacity} {
+            this->buy_set.reserve(limit_capacity);
+            this->sell_set.reserve(limit_capacity);
+        };
 
         /**
          * deconstruct central limit order book\n
          * all TradeDS::Order within will also be destructed as well
          */
-        ~Book();
+        ~BasicBook();
+
+        BasicBook(BasicBook const &rhs) = delete;
+
+        BasicBook &operator=(BasicBook const &rhs) = delete;
+
+        /**
+         * preallocate storage so the hot path never calls the global allocator\n
+         * @param order_capacity number of Orders the Book should hold without allocating
+         * @param limit_capacity number of Limits the Book should hold without allocating
+         */
+        void reserve(size_t order_capacity, size_t limit_capacity);
+
+        /**
+         * convert an API price into ticks of this Book, see BookBase::to_ticks\n
+         * with a TradeDS::FixedTick, a division by a constant and a check against the price band
+         * @param price API price
+         * @return price in ticks
+         * @return 0 if price is not a valid price of TickPolicy
+         */
+        int64_t to_ticks(int64_t price) const { return TickPolicy::to_ticks(price, this->unit); }
+
+        /**
+         * convert a price in ticks of this Book back into an API price
+         * @param ticks price in ticks
+         * @return API price
+         */
+        int64_t to_price(int64_t ticks) const { return TickPolicy::to_price(ticks, this->unit); }
+
+        /**
+         * construct a new TradeDS::Order from this Book's pool, the Order is NOT inserted\n
+         * Orders passed to Book::insert must be created via this method\n
+         * \n
+         * Time-complexity O(1)
+         *
+         * @param order_id
+         * @param side
+         * @param price in ticks
+         * @param volume
+         * @param owner optional, owner of the Order, 0 for none
+         * @param stp optional, self-trade prevention of the Order, only kept with an owner
+         * @return reference to newly created TradeDS::Order
+         */
+        Order *create_order(uint64_t order_id, Side side, int64_t price, uint64_t volume, OwnerId owner = 0,
+                            StpMode stp = StpMode::NONE);
+
+        /**
+         * destruct a TradeDS::Order that is not in the Book and return it to the pool\n
+         * @param order reference previously returned by Book::create_order
+         */
+        void destroy_order(Order *order);
 
         /**
          * insert a new TradeDS::Order into corresponding price TradeDS:Limit\n
          * update Book's metadata\n
          * a new TradeDS::Limit will be created if necessary\n
+         * order_id uniqueness is NOT checked, it is the responsibility of the owner of the order index\n
          * \n
          * Time-complexity O(1)\n
          *
-         * @param new_order reference to TradeDS::Order to be inserted
+         * @param new_order reference to TradeDS::Order created via Book::create_order, to be inserted; its price
+         * must be a tick of TickPolicy
          * @return reference to TradeDS::Order on successful insertion
-         * @return nullptr if order_id already exists
-         * @return nullptr if order.price is in wrong unit
+         * @return nullptr if order belongs to another Book
          */
         Order *insert(Order *new_order);
 
@@ -121,14 +415,13 @@ namespace TradeDS {
          * \n
          * time-complexity O(1)
          *
-         * @param order_id
-         * @param new_price
+         * @param order an Order in this Book
+         * @param new_price in ticks
          * @param new_volume
          * @return reference to TraderDS::Order on success
-         * @return nullptr if order_id doesn't exist
-         * @return nullptr if new_price is in wrong unit
+         * @return nullptr if order is not in this Book
          */
-        Order *amend(uint64_t order_id, double new_price, uint64_t new_volume);
+        Order *amend(Order *order, int64_t new_price, uint64_t new_volume);
 
         /**
          * Remove an existing TradeDS::Order from it's TradeDS::Limit without destructing it\n
@@ -137,29 +430,276 @@ namespace TradeDS {
          * \n
          * time-complexity\n
          * O(1) on average\n
-         * O(L) on worst case; where L is the number of Limit on Order's Side.
-         * this happens when Order is the only order in its TradeDS::Limit, and all Limit are empty\n
-         * updating Book's metadata will resulting a full Limit iteration over one Side
+         * O(log64 L) when Order is the only order in the best TradeDS::Limit; where L is the range of Limit on
+         * Order's Side. the next best Limit is looked up in the LevelStorage
          *
-         * @param order_id
+         * @param order an Order in this Book
          * @return reference to TraderDS::Order on success
-         * @return nullptr if order_id doesn't exist
+         * @return nullptr if order is not in this Book
          */
-        Order *detach(uint64_t order_id);
+        Order *detach(Order *order);
 
         /**
          * Remove an existing TradeDS::Order from it's TradeDS::Limit and destructing it\n
+         * the Order is returned to the Book's pool\n
          * \n
          * time-complexity\n
          * O(1) on average\n
-         * O(L) on worst case; where L is the number of Limit on Order's Side.
-         * this happens when Order is the only order in its TradeDS::Limit, and all Limit are empty\n
-         * updating Book's metadata will resulting a full Limit iteration over one Side
+         * O(log64 L) when Order is the only order in the best TradeDS::Limit, see TradeDS::Book::detach
          *
-         * @param order_id
-         * @return True on successful removal, False if order_id doesn't exist
+         * @param order an Order in this Book
+         * @return True on successful removal, False if order is not in this Book
+         */
+        bool remove(Order *order);
+
+        /**
+         * Remove an existing TradeDS::Order and destruct it, as part of a bulk removal such as a mass cancel\n
+         * same as remove, except that an emptied best Limit isn't replaced right away: the next best one is looked
+         * up once for all withdrawn Orders by settle, which must be called before the Book is used otherwise\n
+         * time-complexity O(1)
+         *
+         * @param order an Order in this Book
+         * @return True on successful removal, False if order is not in this Book
+         */
+        bool withdraw(Order *order);
+
+        /**
+         * finish a bulk removal, see withdraw: find the best Limit of every side whose best Limit emptied, once,
+         * and republish the top of book\n
+         * time-complexity that of LevelStorage::next per side
+         */
+        void settle();
+
+        /**
+         * Bulk-insert a whole price level of new Orders, as when loading a snapshot\n
+         * Orders are created from the pool and chained in the given priority order in one pass, Limit and Book
+         * metadata is updated once\n
+         * order_id uniqueness is NOT checked, see Book::insert\n
+         * \n
+         * time-complexity O(K); where K is the number of orders
+         *
+         * @param side
+         * @param price in ticks
+         * @param orders order_id, volume and owner of each order, in priority order
+         * @param count number of orders
+         * @return reference to the front TradeDS::Order of the level, its chain reaches all of them
+         * @return nullptr if price is not positive, count is 0 or a Limit already exists at price
+         */
+        Order *restore_level(Side side, int64_t price, const Snapshot::OrderRecord *orders, size_t count);
+
+        /**
+         * park a stop order in the trigger book, until the last trade price reaches its stop price\n
+         * a Buy stop triggers once the last trade price is at or above its stop price, a Sell stop once it is at or
+         * below; until then the Order isn't matched against, nor counted in any volume, depth or order count\n
+         * a waiting stop order leaves the trigger book through next_triggered or remove_stop only\n
+         * time-complexity O(1)
+         *
+         * @param stop reference to TradeDS::Order created via Book::create_order; its price is the limit price
+         * in ticks to match at once triggered, 0 for a stop-market order
+         * @param stop_price in ticks, must be a tick of TickPolicy
+         * @return reference to TradeDS::Order on success
+         * @return nullptr if order belongs to another Book
          */
-        bool remove(uint64_t order_id);
+        Order *insert_stop(Order *stop, int64_t stop_price);
+
+        /**
+         * take the next stop order triggered by the last trade price out of the trigger book\n
+         * Buy stops go before Sell stops, each side from its nearest stop price outward and in arrival order
+         * within one stop price, so triggering is deterministic\n
+         * the caller matches or inserts the Order, then calls again until nullptr: its trades move the last trade
+         * price and may trigger more stops\n
+         * time-complexity O(1), that of LevelStorage::next when a stop price runs out of Orders
+         *
+         * @return reference to the triggered TradeDS::Order, not in any Limit
+         * @return nullptr if no stop order is triggered
+         */
+        Order *next_triggered();
+
+        /**
+         * cancel a waiting stop order, destructing it\n
+         * time-complexity O(1), that of LevelStorage::next when it was the last Order at the nearest stop price
+         *
+         * @param stop an Order waiting in this Book's trigger book
+         * @return True on successful removal, False if stop isn't waiting in this Book's trigger book
+         */
+        bool remove_stop(Order *stop);
+
+        /**
+         * get the stop price of a waiting stop order, in ticks
+         * @param stop an Order waiting in this Book's trigger book
+         */
+        static int64_t get_stop_price(const Order *stop) { return stop->limit->price; }
+
+        /**
+         * get the nearest non-empty stop Limit of a given side, the first one to trigger
+         * @param side Side of the stop orders
+         * @return reference to TradeDS::Limit, nullptr if there is no stop order on side
+         */
+        const Limit *get_first_stop(Side side) const {
+            return side == Side::Buy ? this->lowest_buy_stop : this->highest_sell_stop;
+        }
+
+        /**
+         * get the next non-empty stop Limit after a given stop price, in trigger order, see get_first_stop\n
+         * time-complexity that of LevelStorage::next
+         *
+         * @param side Side of the stop orders
+         * @param stop_price in ticks, exclusive
+         * @return reference to TradeDS::Limit, nullptr if there is no further one
+         */
+        const Limit *get_next_stop(Side side, int64_t stop_price) const {
+            return (side == Side::Buy ? this->buy_stops : this->sell_stops).next(stop_price);
+        }
+
+        /**
+         * get the number of stop orders waiting in the trigger book
+         */
+        size_t get_stop_count() const { return this->stop_count; }
+
+        /**
+         * get the price of the last trade, in ticks
+         * @return 0 if nothing traded yet
+         */
+        int64_t get_last_price() const { return this->last_price; }
+
+        /**
+         * set the price of the last trade, as when loading a snapshot; nothing is triggered
+         * @param price in ticks, 0 for none
+         */
+        void restore_last_price(int64_t price) { this->last_price = price; }
+
+        /**
+         * Match an incoming order's volume against the opposite side of the book\n
+         * walks TradeDS::Limit::front_order chains in place from the best offer, consuming resting volume\n
+         * fully filled resting Orders are unlinked and returned to the pool, Limit and Book metadata is updated
+         * once per Limit\n
+         * nothing is inserted, the caller decides what happens with the remaining volume\n
+         * \n
+         * time-complexity O(F + E); where F is the number of resting Orders touched and E the number of
+         * Limit emptied
+         *
+         * @tparam FillHandler callable as void(const TradeDS::Order &resting, uint64_t traded), invoked once per
+         * fill after resting.volume is reduced; resting.volume == 0 means the resting Order is about to be destructed,
+         * an iceberg Order has already displayed its next peak, see Order
+         * @param side Side of the incoming order
+         * @param limit_price worst acceptable price of the incoming order, in ticks
+         * @param volume volume of the incoming order
+         * @param on_fill fill handler
+         * @return volume left unmatched
+         */
+        template<typename FillHandler>
+        uint64_t match(Side side, int64_t limit_price, uint64_t volume, FillHandler &&on_fill);
+
+        /**
+         * Match an incoming order's volume against the opposite side of the book, with self-trade prevention\n
+         * same as match, but a resting Order of the same owner is not traded against: its owner is compared inline
+         * in the walk, and what stp cancels instead is handed to on_prevented\n
+         * without owner or stp, this is match without the comparison
+         *
+         * @tparam FillHandler see match
+         * @tparam PreventHandler callable as void(const TradeDS::Order &resting, uint64_t resting_cancelled,
+         * uint64_t aggressor_cancelled), invoked once per self-trade after both volumes are reduced;
+         * resting.volume == 0 means the resting Order is about to be destructed
+         * @param side Side of the incoming order
+         * @param limit_price worst acceptable price of the incoming order, in ticks
+         * @param volume volume of the incoming order
+         * @param owner owner of the incoming order, 0 for none
+         * @param stp self-trade prevention of the incoming order
+         * @param on_fill fill handler
+         * @param on_prevented self-trade handler
+         * @return volume left unmatched, and not cancelled
+         */
+        template<typename FillHandler, typename PreventHandler>
+        uint64_t match(Side side, int64_t limit_price, uint64_t volume, OwnerId owner, StpMode stp,
+                       FillHandler &&on_fill, PreventHandler &&on_prevented);
+
+        /**
+         * Match an incoming order's volume against the opposite side of the book\n
+         * see TradeDS::Book::match, fills are appended with price converted back into API price
+         *
+         * @param side Side of the incoming order
+         * @param limit_price worst acceptable price of the incoming order, in ticks
+         * @param volume volume of the incoming order
+         * @param fills an vector passed by reference, all filled order needs to be written in there
+         * @return volume left unmatched
+         */
+        uint64_t match(Side side, int64_t limit_price, uint64_t volume, vector<Fill> &fills);
+
+        /**
+         * put the Book in, or out of, auction mode\n
+         * the Book itself never matches on insert, so orders always accumulate as they are inserted; the mode tells
+         * the owner of the Book to insert instead of match, until uncross executes the crossed orders at once\n
+         * meanwhile, the Book may be crossed: its best bid may be at or above its best offer
+         * @param auction True for auction mode
+         */
+        void set_auction(bool auction) { this->auction = auction; }
+
+        bool in_auction() const { return this->auction; }
+
+        /**
+         * find the price an uncross would execute at, and its volume, without touching any Order\n
+         * the crossing Limits of both sides are merged into one ascending ladder of candidate prices with their
+         * cumulative Buy and Sell volumes, in one linear pass; executable volume and surplus at every price are
+         * then computed branch-free over plain arrays, a pass the compiler vectorises wherever the target has 64-bit
+         * vector compares, from SSE4.2 or AVX2 on\n
+         * the equilibrium price has the maximum executable volume, then the minimum surplus, then, to follow market
+         * pressure, is the highest one if the surplus is on the Buy side and the lowest one otherwise\n
+         * time-complexity O(C) times that of LevelStorage::next; where C is the number of crossing Limits
+         *
+         * @param price set to the equilibrium price in ticks, 0 if the Book isn't crossed
+         * @return executable volume, 0 if the Book isn't crossed
+         */
+        uint64_t equilibrium(int64_t &price);
+
+        /**
+         * execute every crossed order at the equilibrium price, see equilibrium, leaving the Book uncrossed\n
+         * Buy orders are taken from the highest price and Sell orders from the lowest, in priority order within a
+         * price, trading with each other in place; the mode is left as it is, see set_auction\n
+         * time-complexity O(C + F + E); where F is the number of Orders traded and E the number of Limits emptied
+         *
+         * @tparam UncrossHandler callable as void(const TradeDS::Order &buy, const TradeDS::Order &sell,
+         * int64_t price, uint64_t traded), price in ticks, invoked once per trade after both volumes are reduced;
+         * a volume of 0 means that Order is about to be destructed
+         * @param on_fill trade handler
+         * @return volume executed, 0 if the Book isn't crossed
+         */
+        template<typename UncrossHandler>
+        uint64_t uncross(UncrossHandler &&on_fill);
+
+        /**
+         * check whether an incoming order would match anything, against the best Limit only\n
+         * time-complexity O(1)
+         *
+         * @param side Side of the incoming order
+         * @param limit_price worst acceptable price of the incoming order, in ticks
+         * @return True if the best opposite Limit satisfies the limit price
+         */
+        bool crosses(Side side, int64_t limit_price) const {
+            const Limit *const best = (side == Side::Buy) ? this->lowest_sell : this->highest_buy;
+            if (best == nullptr) return false;
+            return (side == Side::Buy) ? (best->price <= limit_price) : (best->price >= limit_price);
+        }
+
+        /**
+         * get how much of an incoming order's volume would trade, without modifying any Order\n
+         * without self-trade prevention nor iceberg Orders on the opposite side, only the aggregated volume of the
+         * crossing Limits is read, and only until volume is reached; otherwise, the Orders of those Limits are read
+         * too, as match walks them: the reserve of iceberg Orders is counted, volume of a resting Order of owner
+         * never is, and under CANCEL_AGGRESSOR or DECREMENT_BOTH counting stops at the first one, where match would
+         * cancel volume of the incoming order\n
+         * time-complexity O(E) times that of LevelStorage::next; where E is the number of Limit read, plus the number
+         * of Orders read with self-trade prevention or iceberg Orders
+         *
+         * @param side Side of the incoming order
+         * @param limit_price worst acceptable price of the incoming order, in ticks
+         * @param volume volume of the incoming order
+         * @param owner optional, owner of the incoming order, 0 for none
+         * @param stp optional, self-trade prevention of the incoming order
+         * @return volume that would trade before self-trade prevention cancels any of the incoming order, at most
+         * volume
+         */
+        uint64_t matchable_volume(Side side, int64_t limit_price, uint64_t volume, OwnerId owner = 0,
+                                  StpMode stp = StpMode::NONE) const;
 
         /**
          * Return the best offer order_id on a given side
@@ -168,17 +708,105 @@ namespace TradeDS {
          */
         uint64_t get_best_offer_id(Side side) const;
 
+        /**
+         * Return the best offer Order a given side can be matched against
+         * @param side
+         * @return reference to TradeDS::Order if exists, otherwise nullptr
+         */
+        Order *get_best_offer(Side side) const;
+
         // getters
         /**
-         * get a copy of all orders in book, in a unordered_map\n
+         * get all orders in book, Buy side first, each side from best price outward in priority order\n
+         * time-complexity O(N + L); where N is the number of orders and L the number of non-empty Limits
          */
-        unordered_map<uint64_t, Order *> get_orders() const;
+        vector<Order *> get_orders() const;
 
         /**
-         * get a copy of Order with a given order_id\n
-         * @param order_id
+         * get the best non-empty Limit of resting orders on a given side\n
+         * @param side Side of the resting orders, Buy for bids and Sell for asks
+         * @return reference to TradeDS::Limit, nullptr if side is empty
          */
-        Order get_order_by_id(uint64_t order_id) const;
+        const Limit *get_best_limit(Side side) const {
+            return side == Side::Buy ? this->highest_buy : this->lowest_sell;
+        }
+
+        /**
+         * get the next non-empty Limit after a given price, moving away from the touch\n
+         * meaning the next lower price for Buy and the next higher price for Sell\n
+         * together with get_best_limit, this iterates all populated levels of one side:\n
+         * for (auto l = book.get_best_limit(side); l != nullptr; l = book.get_next_limit(side, l->price))\n
+         * \n
+         * time-complexity that of LevelStorage::next, O(log64 L) for SparseLevels; where L is the range of Limit on
+         * the Side
+         *
+         * @param side Side of the resting orders, Buy for bids and Sell for asks
+         * @param price in ticks, exclusive
+         * @return reference to TradeDS::Limit, nullptr if there is no further non-empty Limit
+         */
+        const Limit *get_next_limit(Side side, int64_t price) const;
+
+        /**
+         * get the aggregated depth of up to n populated levels of a side, from the touch outward\n
+         * levels are found through the LevelStorage occupancy index, nothing is allocated or copied but the
+         * aggregates written to out\n
+         * time-complexity O(n) times that of LevelStorage::next
+         *
+         * @param side Side of the resting orders, Buy for bids and Sell for asks
+         * @param n maximum number of levels
+         * @param out caller-provided array of at least n levels, prices in API unit
+         * @return number of levels written, less than n if the side has fewer levels
+         */
+        size_t depth(Side side, size_t n, DepthLevel *out) const;
+
+        /**
+         * get the aggregated depth of up to n populated levels of a side, visiting every Order within them in
+         * place, see depth\n
+         * time-complexity O(n + K) times that of LevelStorage::next; where K is the number of orders visited
+         *
+         * @tparam OrderVisitor callable as void(size_t level, const TradeDS::Order &order), invoked in priority
+         * order; the Book must not be modified while visiting
+         * @param side Side of the resting orders, Buy for bids and Sell for asks
+         * @param n maximum number of levels
+         * @param out caller-provided array of at least n levels, prices in API unit
+         * @param visit order visitor, level is the index into out
+         * @return number of levels written
+         */
+        template<typename OrderVisitor>
+        size_t depth(Side side, size_t n, DepthLevel *out, OrderVisitor &&visit) const;
+
+        /**
+         * get the best bid and offer, prices in API unit, volumes 0 and prices 0 for an empty side\n
+         * safe to call from any thread while the Book is modified: it reads a seqlock-protected copy published
+         * whenever the touch changes, never the Book's internals\n
+         * time-complexity O(1), retried while a publish is in progress
+         */
+        BestBidOffer get_top_of_book() const { return this->top_of_book.load(); }
+
+        /**
+         * get the number of times the top of book changed, any thread; poll it to detect a new top of book
+         */
+        uint64_t get_top_of_book_version() const { return this->top_of_book.version(); }
+
+        /**
+         * publish an incremental L2 feed of this Book into a ring buffer\n
+         * every modifying method notes the levels it touches; publish_deltas, called once per incoming message,
+         * pushes one LevelDelta per level whose aggregate volume or order count changed, so a level that is
+         * emptied and refilled, or traded through several times, by one message is reported once\n
+         * without a feed the modifying methods track nothing
+         * @param feed ring the deltas are pushed into, deltas that don't fit are dropped and counted by the ring;
+         * nullptr to stop publishing
+         * @param instrument optional, tagged on every delta, to tell books sharing one feed apart
+         */
+        void set_delta_feed(SpscRing<LevelDelta> *feed, InstrumentId instrument = 0);
+
+        /**
+         * end the current incoming message: push the coalesced deltas of all levels touched since the last call\n
+         * time-complexity O(D); where D is the number of levels touched
+         */
+        void publish_deltas() {
+            if (!this->dirty_levels.empty()) this->flush_deltas();
+        }
 
         /**
          * get the number of orders in book
@@ -196,26 +824,226 @@ namespace TradeDS {
         int64_t get_sell_volume() const;
 
         /**
-         * get the volume of a given limit price on a given side
+         * get the total volume held in reserve by the iceberg Orders of a side, not part of get_buy_volume or
+         * get_sell_volume
          */
-        uint64_t get_volume_by_limit(Side side, double price) const;
+        int64_t get_hidden_volume(Side side) const {
+            return side == Side::Buy ? this->hidden_buy_volume : this->hidden_sell_volume;
+        }
 
         /**
-         * get the highest price among all Buy orders
+         * get the volume of a given limit price (in ticks) on a given side
          */
-        uint64_t get_highest_price() const;
+        uint64_t get_volume_by_limit(Side side, int64_t price) const;
 
         /**
-         * get the lowest price among all Sell orders
-         * @return
+         * get the highest price among all Buy orders, in ticks
+         * @return 0 if no Buy order exists
          */
-        uint64_t get_lowest_price() const;
+        int64_t get_highest_price() const;
+
+        /**
+         * get the lowest price among all Sell orders, in ticks
+         * @return 0 if no Sell order exists
+         */
+        int64_t get_lowest_price() const;
 
         /**
          * fine print Order book and all it's Orders
          */
         string to_string();
     };
+
+    using Book = BasicBook<RuntimeTick, SparseLevels>;
+    using WindowBook = BasicBook<RuntimeTick, WindowLevels>;
+
+    /**
+     * a TradeDS::FixedTick Book of a tick of 5 and prices up to 5 * 2^20, its level storage sized for the band up
+     * front; the FixedTick Book the benchmarks and tests compare with Book
+     */
+    using FixedTickBook = BasicBook<FixedTick<5, 5, 5 << 20>>;
+
+    // instantiated once in clob.cpp
+    extern template class BasicBook<RuntimeTick, SparseLevels>;
+    extern template class BasicBook<RuntimeTick, WindowLevels>;
+    extern template class BasicBook<FixedTick<5, 5, 5 << 20>>;
+}
+
+template<typename TickPolicy, typename LevelStorage>
+template<typename FillHandler>
+uint64_t TradeDS::BasicBook<TickPolicy, LevelStorage>::match(const Side side, const int64_t limit_price, uint64_t volume,
+                                                             FillHandler &&on_fill) {
+    auto ignore = [](const Order &, uint64_t, uint64_t) {};
+    return this->template walk<false>(side, limit_price, volume, 0, StpMode::NONE, on_fill, ignore);
+}
+
+template<typename TickPolicy, typename LevelStorage>
+template<typename FillHandler, typename PreventHandler>
+uint64_t TradeDS::BasicBook<TickPolicy, LevelStorage>::match(const Side side, const int64_t limit_price, uint64_t volume,
+                                                             const OwnerId owner, const StpMode stp,
+                                                             FillHandler &&on_fill, PreventHandler &&on_prevented) {
+    if (owner == 0 || stp == StpMode::NONE) {
+        return this->template walk<false>(side, limit_price, volume, owner, stp, on_fill, on_prevented);
+    }
+    return this->template walk<true>(side, limit_price, volume, owner, stp, on_fill, on_prevented);
+}
+
+template<typename TickPolicy, typename LevelStorage>
+template<bool PREVENT, typename FillHandler, typename PreventHandler>
+uint64_t TradeDS::BasicBook<TickPolicy, LevelStorage>::walk(const Side side, const int64_t limit_price, uint64_t volume,
+                                                            const OwnerId owner, const StpMode stp,
+                                                            FillHandler &on_fill, PreventHandler &on_prevented) {
+    const Side resting_side = (side == Side::Buy) ? Side::Sell : Side::Buy;
+    Limit *const &best_limit = (side == Side::Buy) ? this->lowest_sell : this->highest_buy;
+    int64_t &resting_volume = (side == Side::Buy) ? this->sell_volume : this->buy_volume;
+    int64_t &resting_hidden = (side == Side::Buy) ? this->hidden_sell_volume : this->hidden_buy_volume;
+    bool traded_any = false;
+    int64_t traded_price = 0;
+    uint64_t levels_traded = 0;
+    uint64_t orders_traded = 0;
+
+    while (volume > 0 && best_limit != nullptr) {
+        Limit *const target_limit = best_limit;
+
+        // stop once best offer doesn't satisfy the limit price
+        if ((side == Side::Buy) ? (target_limit->price > limit_price) : (target_limit->price < limit_price)) break;
+
+        this->note_level(resting_side, target_limit->price, target_limit);
+
+        // walk the Limit in priority order, consuming volume in place
+        Order *curr_order = target_limit->front_order;
+        uint64_t limit_removed = 0;     // traded, or cancelled by self-trade prevention
+        uint64_t limit_refilled = 0;    // displayed from the reserve of iceberg Orders
+        size_t limit_filled = 0;
+        while (curr_order != nullptr && volume > 0) {
+            orders_traded++;
+            bool refreshed = false;
+
+            if (PREVENT && curr_order->owner == owner) {
+                if (stp == StpMode::CANCEL_AGGRESSOR) {
+                    on_prevented(*curr_order, 0, volume);
+                    volume = 0;
+                    break;
+                }
+                // CANCEL_RESTING takes all of the resting Order, DECREMENT_BOTH the overlap off both
+                const uint64_t cancelled = (stp == StpMode::CANCEL_RESTING || curr_order->volume < volume)
+                                           ? curr_order->volume : volume;
+                const uint64_t aggressor_cancelled = (stp == StpMode::DECREMENT_BOTH) ? cancelled : 0;
+                curr_order->volume -= cancelled;
+                volume -= aggressor_cancelled;
+                limit_removed += cancelled;
+                if (curr_order->volume == 0 && curr_order->iceberg) {
+                    // a cancelled iceberg Order is cancelled with its reserve
+                    resting_hidden -= (int64_t) curr_order->hidden;
+                    curr_order->hidden = 0;
+                }
+
+                on_prevented(*curr_order, cancelled, aggressor_cancelled);
+            } else {
+                const uint64_t traded = (curr_order->volume < volume) ? curr_order->volume : volume;
+                curr_order->volume -= traded;
+                volume -= traded;
+                limit_removed += traded;
+                traded_price = target_limit->price;
+                if (curr_order->volume == 0 && curr_order->iceberg && curr_order->hidden > 0) {
+                    // display the next peak before the fill is reported, the Order lives on
+                    const uint64_t shown = (curr_order->hidden < curr_order->peak) ? curr_order->hidden
+                                                                                   : curr_order->peak;
+                    curr_order->hidden -= shown;
+                    curr_order->volume = shown;
+                    limit_refilled += shown;
+                    refreshed = true;
+                }
+
+                on_fill(*curr_order, traded);
+            }
+            if (refreshed) {
+                // the Orders in front of it are all filled, move it from the front to the tail and keep walking
+                if (curr_order->next != nullptr) {
+                    Order *const requeued = curr_order;
+                    curr_order = requeued->next;
+                    requeued->next = nullptr;
+                    requeued->prev = target_limit->tail_order;
+                    target_limit->tail_order->next = requeued;
+                    target_limit->tail_order = requeued;
+                }
+                continue;
+            }
+            if (curr_order->volume > 0) break;  // partially filled, keeps its priority
+
+            Order *const filled_order = curr_order;
+            curr_order = curr_order->next;
+            limit_filled++;
+            this->order_pool.release(filled_order);
+        }
+
+        // unlink all filled orders at once and update metadata once per Limit
+        target_limit->front_order = curr_order;
+        if (curr_order != nullptr) {
+            curr_order->prev = nullptr;
+        } else {
+            target_limit->tail_order = nullptr;
+        }
+        target_limit->size -= limit_filled;
+        target_limit->volume += limit_refilled;
+        target_limit->volume -= limit_removed;
+        this->order_count -= limit_filled;
+        resting_volume += (int64_t) limit_refilled - (int64_t) limit_removed;
+        resting_hidden -= (int64_t) limit_refilled;
+        if (target_limit->size == 0) this->vacate(resting_side, target_limit);
+        traded_any = true;
+        levels_traded++;
+    }
+
+    if (traded_any) this->publish_touch(resting_side);
+    if (traded_price != 0) this->last_price = traded_price;
+    Instrumentation::count(Instrumentation::LEVELS_PER_MATCH, levels_traded);
+    Instrumentation::count(Instrumentation::ORDERS_PER_MATCH, orders_traded);
+    return volume;
+}
+
+template<typename TickPolicy, typename LevelStorage>
+template<typename UncrossHandler>
+uint64_t TradeDS::BasicBook<TickPolicy, LevelStorage>::uncross(UncrossHandler &&on_fill) {
+    int64_t price;
+    const uint64_t executable = this->equilibrium(price);
+
+    // the fronts of both sides are always within the price while executable volume is left
+    for (uint64_t volume = executable; volume > 0;) {
+        Order *const buy = this->highest_buy->front_order;
+        Order *const sell = this->lowest_sell->front_order;
+        uint64_t traded = (buy->volume < sell->volume) ? buy->volume : sell->volume;
+        if (volume < traded) traded = volume;
+        volume -= traded;
+        this->reduce(buy, traded);
+        this->reduce(sell, traded);
+        if (buy->volume == 0 && buy->iceberg && buy->hidden > 0) this->replenish(buy);
+        if (sell->volume == 0 && sell->iceberg && sell->hidden > 0) this->replenish(sell);
+
+        on_fill(*buy, *sell, price, traded);
+        if (buy->volume == 0) this->retire(buy);
+        if (sell->volume == 0) this->retire(sell);
+    }
+
+    if (executable > 0) {
+        this->last_price = price;
+        this->publish_touch(Side::Buy);
+        this->publish_touch(Side::Sell);
+    }
+    return executable;
+}
+
+template<typename TickPolicy, typename LevelStorage>
+template<typename OrderVisitor>
+size_t TradeDS::BasicBook<TickPolicy, LevelStorage>::depth(const Side side, const size_t n, DepthLevel *const out,
+                                               OrderVisitor &&visit) const {
+    size_t level = 0;
+    for (const Limit *limit = this->get_best_limit(side); limit != nullptr && level < n;
+         limit = this->get_next_limit(side, limit->price), level++) {
+        out[level] = DepthLevel{this->to_price(limit->price), (int64_t) limit->volume, limit->size};
+        for (const Order *order = limit->front_order; order != nullptr; order = order->next) visit(level, *order);
+    }
+    return level;
 }
 
 /**
@@ -226,4 +1054,13 @@ namespace TradeDS {
  */
 ostream &operator<<(ostream &os, const TradeDS::Order &o);
 
+/**
+ * Overloaded ostream << operator for quick fine-print
+ * @param os ostream
+ * @param o a Book
+ * @return ostream
+ */
+template<typename TickPolicy, typename LevelStorage>
+ostream &operator<<(ostream &os, const TradeDS::BasicBook<TickPolicy, LevelStorage> &o);
+
 #endif  // !CLOB_H
\ No newline at end of file
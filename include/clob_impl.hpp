@@ -0,0 +1,748 @@
+#ifndef CLOB_IMPL_H
+#define CLOB_IMPL_H
+
+#include "clob.hpp"
+
+/**
+ * Definitions of the TradeDS::BasicBook templates\n
+ * clob.cpp instantiates TradeDS::Book, TradeDS::WindowBook and TradeDS::FixedTickBook from here once; a translation
+ * unit using any other BasicBook, a TradeDS::FixedTick one of another band for example, includes this header to
+ * instantiate it
+ */
+
+// Book fine-print
+template<typename TickPolicy, typename LevelStorage>
+ostream &operator<<(ostream &os, const TradeDS::BasicBook<TickPolicy, LevelStorage> &o) {
+    os << "Book\t[ "
+       << "-symbol: " << o.symbol
+       << "\t-uint: " << o.unit
+       << "\t-order count: " << o.get_order_count()
+       << "\t-buy volume: " << o.get_buy_volume()
+       << "\t-sell volume: " << o.get_sell_volume()
+       << "\t-highest_buy: " << o.get_highest_price()
+       << "\t-lowest_sell: " << o.get_lowest_price()
+       << " ]" << endl;
+
+    for (auto order: o.get_orders()) {
+        os << order->toString() << endl;
+    }
+
+    return os;
+}
+
+namespace TradeDS {
+    template<typename TickPolicy, typename LevelStorage>
+    string BasicBook<TickPolicy, LevelStorage>::to_string() {
+        stringstream ss;
+        ss << (*this);
+        return ss.str();
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    BasicBook<TickPolicy, LevelStorage>::~BasicBook() {
+        // Orders and Limits are owned by the pools, which free all their storage at once
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::reserve(size_t order_capacity, size_t limit_capacity) {
+        this->order_pool.reserve(order_capacity);
+        this->buy_set.reserve(limit_capacity);
+        this->sell_set.reserve(limit_capacity);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::create_order(uint64_t order_id, Side side, int64_t price,
+                                                             uint64_t volume, OwnerId owner, StpMode stp) {
+        Order *new_order = this->order_pool.acquire(order_id, side, price, volume, owner, stp);
+        new_order->book = this;
+        return new_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::destroy_order(Order *order) {
+        this->order_pool.release(order);
+    }
+
+    /**
+     * 1. insert into correct limit
+     * 2. adjust Book's meta data
+     * @param new_order
+     * @return reference to new_order
+     */
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::insert(Order *const new_order) {
+        // reject if order is not owned by this book
+        if (new_order->book != this) return nullptr;
+
+        // insert into right limit, prices are already in ticks
+        LevelStorage &target_side = (new_order->side == Side::Buy) ? (this->buy_set) : (this->sell_set);
+        const int64_t limit_idx = new_order->price;
+        Limit *target_limit = target_side.get(limit_idx);
+        this->note_level(new_order->side, limit_idx, target_limit);
+
+        // create limit if not exist
+        if (target_limit == nullptr) target_limit = target_side.create(limit_idx);
+
+        // append order to the tail of limit
+        if (target_limit->size == 0) {
+            target_limit->front_order = new_order;
+            target_limit->tail_order = new_order;
+        } else {
+            target_limit->tail_order->next = new_order;
+            new_order->prev = target_limit->tail_order;
+            target_limit->tail_order = new_order;
+        }
+        target_limit->size++;
+        target_limit->volume += new_order->volume;
+
+        new_order->limit = target_limit;
+
+        // adjust Book's meta data
+        this->order_count++;
+        (new_order->side == Side::Buy) ? (this->buy_volume += new_order->volume) : (this->sell_volume += new_order->volume);
+        if (new_order->iceberg) {
+            ((new_order->side == Side::Buy) ? this->hidden_buy_volume : this->hidden_sell_volume) +=
+                    (int64_t) new_order->hidden;
+        }
+
+        // Adjust Best offer, letting the level storage follow the touch
+        if (new_order->side == Side::Buy) {
+            if (this->highest_buy == nullptr || this->highest_buy->price < target_limit->price) {
+                this->highest_buy = target_limit;
+                this->buy_set.recentre(target_limit->price);
+            }
+        } else {
+            if (this->lowest_sell == nullptr || this->lowest_sell->price > target_limit->price) {
+                this->lowest_sell = target_limit;
+                this->sell_set.recentre(target_limit->price);
+            }
+        }
+        if (target_limit == this->get_best_limit(new_order->side)) this->publish_touch(new_order->side);
+
+        return new_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::amend(Order *const target_order, const int64_t new_price,
+                                                      const uint64_t new_volume) {
+        // reject if order isn't in this book
+        if (target_order->book != this || target_order->limit == nullptr) return nullptr;
+
+        Limit *target_limit = target_order->limit;
+
+        if (target_order->price != new_price) {
+            // new price, detach order, modify and reinsert
+            this->detach(target_order);   // metadata updated
+            target_order->price = new_price;
+            target_order->volume = new_volume;
+            this->insert(target_order);           // metadata updated
+        } else {
+            // same price, simply change volume and metadata
+            this->note_level(target_order->side, target_limit->price, target_limit);
+            auto volume_diff = (int64_t) (new_volume - target_order->volume);
+            target_limit->volume += volume_diff;
+            (target_order->side == Side::Buy) ? (this->buy_volume += volume_diff) : (this->sell_volume += volume_diff);
+
+            target_order->volume = new_volume;
+            if (target_limit == this->get_best_limit(target_order->side)) this->publish_touch(target_order->side);
+        }
+
+        return target_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::detach(Order *const target_order) {
+        // reject if order isn't in this book
+        if (target_order->book != this || target_order->limit == nullptr) return nullptr;
+
+        const bool at_touch = (target_order->limit == this->get_best_limit(target_order->side));
+        Limit *const target_limit = this->unlink(target_order);
+
+        // retire exhausted limit, best offer is updated if necessary
+        if (target_limit->size == 0) this->vacate(target_order->side, target_limit);
+        if (at_touch) this->publish_touch(target_order->side);
+
+        return target_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Limit *BasicBook<TickPolicy, LevelStorage>::unlink(Order *const target_order) {
+        Limit *target_limit = target_order->limit;
+        target_order->limit = nullptr;
+        this->note_level(target_order->side, target_limit->price, target_limit);
+        unchain(target_limit, target_order);
+
+        // modify Book's metadata
+        this->order_count--;
+        target_order->side == Side::Buy ? this->buy_volume -= target_order->volume
+                                        : this->sell_volume -= target_order->volume;
+        if (target_order->iceberg) {
+            ((target_order->side == Side::Buy) ? this->hidden_buy_volume : this->hidden_sell_volume) -=
+                    (int64_t) target_order->hidden;
+        }
+
+        return target_limit;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::unchain(Limit *const target_limit, Order *const target_order) {
+        // detach from limit linked list
+        // middle order, most likely a hit, check first
+        if (target_limit->front_order != target_order && target_limit->tail_order != target_order) {
+            target_order->prev->next = target_order->next;
+            target_order->next->prev = target_order->prev;
+
+            target_order->prev = nullptr;
+            target_order->next = nullptr;
+            goto CHANGE_META;
+        }
+
+        // only order in Limit
+        if (target_limit->size == 1) {
+            target_limit->front_order = nullptr;
+            target_limit->tail_order = nullptr;
+            goto CHANGE_META;
+        }
+
+        // head order, with other order behind
+        if (target_limit->front_order == target_order) {
+            target_order->next->prev = nullptr;
+            target_limit->front_order = target_order->next;
+
+            target_order->next = nullptr;
+            goto CHANGE_META;
+        }
+
+        // tail order
+        if (target_limit->tail_order == target_order) {
+            target_order->prev->next = nullptr;
+            target_limit->tail_order = target_order->prev;
+
+            target_order->prev = nullptr;
+            goto CHANGE_META;
+        }
+
+        // modify Limit's metadata
+        CHANGE_META:
+        target_limit->size--;
+        target_limit->volume -= target_order->volume;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::insert_stop(Order *const stop, const int64_t stop_price) {
+        // reject if order is not owned by this book
+        if (stop->book != this) return nullptr;
+
+        auto &target_side = (stop->side == Side::Buy) ? this->buy_stops : this->sell_stops;
+        Limit *target_limit = target_side.get(stop_price);
+        if (target_limit == nullptr) target_limit = target_side.create(stop_price);
+
+        // append order to the tail of limit, same as insert
+        if (target_limit->size == 0) {
+            target_limit->front_order = stop;
+            target_limit->tail_order = stop;
+        } else {
+            target_limit->tail_order->next = stop;
+            stop->prev = target_limit->tail_order;
+            target_limit->tail_order = stop;
+        }
+        target_limit->size++;
+        target_limit->volume += stop->volume;
+        stop->limit = target_limit;
+        this->stop_count++;
+
+        // keep the nearest stop of each side
+        if (stop->side == Side::Buy) {
+            if (this->lowest_buy_stop == nullptr || this->lowest_buy_stop->price > stop_price) {
+                this->lowest_buy_stop = target_limit;
+            }
+        } else {
+            if (this->highest_sell_stop == nullptr || this->highest_sell_stop->price < stop_price) {
+                this->highest_sell_stop = target_limit;
+            }
+        }
+
+        return stop;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::next_triggered() {
+        if (this->last_price == 0) return nullptr;
+
+        // Buy stops first, then Sell stops, each from the nearest stop price
+        const bool buy_triggered = this->lowest_buy_stop != nullptr && this->lowest_buy_stop->price <= this->last_price;
+        if (!buy_triggered && (this->highest_sell_stop == nullptr || this->highest_sell_stop->price < this->last_price)) {
+            return nullptr;
+        }
+        auto &target_side = buy_triggered ? this->buy_stops : this->sell_stops;
+        Limit *&nearest = buy_triggered ? this->lowest_buy_stop : this->highest_sell_stop;
+
+        Limit *const target_limit = nearest;
+        Order *const triggered = target_limit->front_order;
+        unchain(target_limit, triggered);
+        triggered->limit = nullptr;
+        this->stop_count--;
+
+        if (target_limit->size == 0) {
+            const int64_t stop_price = target_limit->price;
+            target_side.remove(stop_price);
+            nearest = target_side.next(stop_price);
+        }
+        return triggered;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    bool BasicBook<TickPolicy, LevelStorage>::remove_stop(Order *const stop) {
+        // reject if order isn't waiting in this book's trigger book
+        if (stop->book != this || stop->limit == nullptr) return false;
+        auto &target_side = (stop->side == Side::Buy) ? this->buy_stops : this->sell_stops;
+        Limit *const target_limit = stop->limit;
+        if (target_side.get(target_limit->price) != target_limit) return false;
+
+        unchain(target_limit, stop);
+        stop->limit = nullptr;
+        this->stop_count--;
+
+        if (target_limit->size == 0) {
+            Limit *&nearest = (stop->side == Side::Buy) ? this->lowest_buy_stop : this->highest_sell_stop;
+            const int64_t stop_price = target_limit->price;
+            target_side.remove(stop_price);
+            if (nearest == target_limit) nearest = target_side.next(stop_price);
+        }
+        this->order_pool.release(stop);
+        return true;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::reduce(Order *const order, const uint64_t volume) {
+        Limit *const target_limit = order->limit;
+        this->note_level(order->side, target_limit->price, target_limit);
+        order->volume -= volume;
+        target_limit->volume -= volume;
+        (order->side == Side::Buy) ? (this->buy_volume -= (int64_t) volume) : (this->sell_volume -= (int64_t) volume);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::replenish(Order *const order) {
+        Limit *const target_limit = order->limit;
+        const uint64_t shown = (order->hidden < order->peak) ? order->hidden : order->peak;
+        this->note_level(order->side, target_limit->price, target_limit);
+
+        // requeue at the tail, same Order
+        unchain(target_limit, order);
+        if (target_limit->size == 0) {
+            target_limit->front_order = order;
+        } else {
+            target_limit->tail_order->next = order;
+            order->prev = target_limit->tail_order;
+        }
+        target_limit->tail_order = order;
+        target_limit->size++;
+
+        order->hidden -= shown;
+        order->volume = shown;
+        target_limit->volume += shown;
+        if (order->side == Side::Buy) {
+            this->buy_volume += (int64_t) shown;
+            this->hidden_buy_volume -= (int64_t) shown;
+        } else {
+            this->sell_volume += (int64_t) shown;
+            this->hidden_sell_volume -= (int64_t) shown;
+        }
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::retire(Order *const order) {
+        Limit *const target_limit = this->unlink(order);
+        if (target_limit->size == 0) this->vacate(order->side, target_limit);
+        this->order_pool.release(order);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::equilibrium(int64_t &price) {
+        price = 0;
+        if (this->highest_buy == nullptr || this->lowest_sell == nullptr) return 0;
+        const int64_t low = this->lowest_sell->price;
+        const int64_t high = this->highest_buy->price;
+        if (high < low) return 0;   // not crossed
+
+        this->crossing_bids.clear();
+        for (const Limit *limit = this->highest_buy; limit != nullptr && limit->price >= low;
+             limit = this->find_next_limit(Side::Buy, limit->price)) {
+            this->crossing_bids.push_back(limit);
+        }
+
+        // 1. merge both sides of the range into an ascending ladder, with cumulative volumes
+        this->ladder_prices.clear();
+        this->ladder_executable.clear();
+        this->ladder_surplus.clear();
+        auto bid = this->crossing_bids.rbegin();
+        const Limit *ask = this->lowest_sell;
+        int64_t asks_at_or_below = 0;
+        int64_t bids_below = 0;
+        while (true) {
+            const bool has_ask = ask != nullptr && ask->price <= high;
+            const bool has_bid = bid != this->crossing_bids.rend();
+            if (!has_ask && !has_bid) break;
+            const int64_t level_price = (has_ask && (!has_bid || ask->price < (*bid)->price)) ? ask->price
+                                                                                              : (*bid)->price;
+            int64_t bid_volume = 0;
+            if (has_ask && ask->price == level_price) {
+                asks_at_or_below += (int64_t) ask->volume;
+                ask = this->find_next_limit(Side::Sell, ask->price);
+            }
+            if (has_bid && (*bid)->price == level_price) {
+                bid_volume = (int64_t) (*bid)->volume;
+                bid++;
+            }
+            this->ladder_prices.push_back(level_price);
+            this->ladder_executable.push_back(asks_at_or_below);
+            this->ladder_surplus.push_back(bids_below);
+            bids_below += bid_volume;
+        }
+        const int64_t total_bids = bids_below;
+
+        // 2. executable volume and surplus at every price, branch-free
+        const size_t count = this->ladder_prices.size();
+        int64_t *const executable = this->ladder_executable.data();
+        int64_t *const surplus = this->ladder_surplus.data();
+        for (size_t i = 0; i < count; i++) {
+            const int64_t bids = total_bids - surplus[i];
+            const int64_t asks = executable[i];
+            executable[i] = bids < asks ? bids : asks;
+            surplus[i] = bids - asks;
+        }
+
+        // 3. maximum volume, then minimum surplus, then market pressure
+        size_t best = 0;
+        for (size_t i = 1; i < count; i++) {
+            const int64_t imbalance = surplus[i] < 0 ? -surplus[i] : surplus[i];
+            const int64_t best_imbalance = surplus[best] < 0 ? -surplus[best] : surplus[best];
+            if (executable[i] > executable[best] ||
+                (executable[i] == executable[best] &&
+                 (imbalance < best_imbalance || (imbalance == best_imbalance && surplus[i] > 0)))) {
+                best = i;
+            }
+        }
+
+        price = this->ladder_prices[best];
+        return (uint64_t) executable[best];
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::vacate(const Side side, Limit *const limit) {
+        LevelStorage &target_side = (side == Side::Buy) ? (this->buy_set) : (this->sell_set);
+        Limit *&best_limit = (side == Side::Buy) ? this->highest_buy : this->lowest_sell;
+        const int64_t price = limit->price;
+        const bool was_best = (best_limit == limit);
+
+        // the level storage owns the Limit, it is gone after this
+        target_side.remove(price);
+
+        // if best offer is exhausted, find next one; if no suitable limit is found, best offer becomes nullptr
+        if (was_best) {
+            StageTimer timer;
+            best_limit = target_side.next(price);
+            if (best_limit != nullptr) target_side.recentre(best_limit->price);
+            timer.lap(Instrumentation::BEST_PRICE);
+        }
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::publish_touch(const Side side) {
+        const Limit *best_limit = this->get_best_limit(side);
+        const int64_t volume = best_limit != nullptr ? (int64_t) best_limit->volume : 0;
+        const int64_t price = best_limit != nullptr ? this->to_price(best_limit->price) : 0;
+
+        BestBidOffer top = this->published_top;
+        if (side == Side::Buy) {
+            if (top.bid_volume == volume && top.bid_price == price) return;
+            top.bid_volume = volume;
+            top.bid_price = price;
+        } else {
+            if (top.ask_volume == volume && top.ask_price == price) return;
+            top.ask_volume = volume;
+            top.ask_price = price;
+        }
+        this->published_top = top;
+        this->top_of_book.store(top);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::set_delta_feed(SpscRing<LevelDelta> *const feed,
+                                                             const InstrumentId instrument) {
+        this->delta_feed = feed;
+        this->delta_instrument = instrument;
+        this->dirty_levels.clear();
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::track_level(const Side side, const int64_t price,
+                                                          const Limit *const limit) {
+        // most messages touch one or two levels, the most recent one is the likeliest repeat
+        for (auto it = this->dirty_levels.rbegin(); it != this->dirty_levels.rend(); it++) {
+            if (it->price == price && it->side == side) return;
+        }
+        this->dirty_levels.push_back({side, price, limit != nullptr ? (uint64_t) limit->volume : 0,
+                                      limit != nullptr ? limit->size : 0});
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::flush_deltas() {
+        // hold one delta back, so the last one pushed can be flagged as the end of the message
+        LevelDelta delta;
+        bool pending = false;
+        for (const DirtyLevel &level: this->dirty_levels) {
+            const Limit *limit = (level.side == Side::Buy ? this->buy_set : this->sell_set).get(level.price);
+            const uint64_t volume = limit != nullptr ? (uint64_t) limit->volume : 0;
+            const size_t size = limit != nullptr ? limit->size : 0;
+            if (volume == level.volume && size == level.size) continue;     // net unchanged
+
+            if (pending) (*this->delta_feed)(delta);
+            delta.instrument = this->delta_instrument;
+            delta.side = level.side;
+            delta.price = this->to_price(level.price);
+            delta.volume = (int64_t) volume;
+            delta.order_count = (uint32_t) size;
+            delta.type = size == 0 ? LevelDelta::REMOVED : (level.size == 0 ? LevelDelta::ADDED : LevelDelta::CHANGED);
+            pending = true;
+        }
+        if (pending) {
+            delta.end_of_message = true;
+            (*this->delta_feed)(delta);
+        }
+        this->dirty_levels.clear();
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    const Limit *BasicBook<TickPolicy, LevelStorage>::get_next_limit(const Side side, const int64_t price) const {
+        return this->find_next_limit(side, price);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Limit *BasicBook<TickPolicy, LevelStorage>::find_next_limit(const Side side, const int64_t price) const {
+        return (side == Side::Buy ? this->buy_set : this->sell_set).next(price);
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::match(const Side side, const int64_t limit_price, const uint64_t volume,
+                                                        vector<Fill> &fills) {
+        uint64_t remaining = volume;
+        return this->match(side, limit_price, volume, [this, &fills, &remaining](const Order &resting, uint64_t traded) {
+            remaining -= traded;
+            fills.push_back(Fill{resting.order_id, this->to_price(resting.price), static_cast<int64_t>(traded),
+                                 0, static_cast<int64_t>(remaining), static_cast<int64_t>(resting.volume), Fill::TRADE,
+                                 resting.owner});
+        });
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::matchable_volume(const Side side, const int64_t limit_price,
+                                                                   const uint64_t volume, const OwnerId owner,
+                                                                   const StpMode stp) const {
+        const Side resting_side = (side == Side::Buy) ? Side::Sell : Side::Buy;
+        const bool prevent = (owner != 0 && stp != StpMode::NONE);
+        const bool reserve = this->get_hidden_volume(resting_side) > 0;
+        uint64_t matchable = 0;
+        for (const Limit *limit = this->get_best_limit(resting_side); limit != nullptr && matchable < volume;
+             limit = this->get_next_limit(resting_side, limit->price)) {
+            if ((side == Side::Buy) ? (limit->price > limit_price) : (limit->price < limit_price)) break;
+            if (!prevent && !reserve) {
+                matchable += limit->volume;
+                continue;
+            }
+
+            // in walk order, an Order of owner is cancelled under CANCEL_RESTING, and cancels volume of the incoming
+            // order otherwise, which then can't all trade; the reserve of an iceberg Order is displayed behind every
+            // other Order of its Limit, so it only trades once the walk got past all of them
+            uint64_t hidden = 0;
+            for (const Order *order = limit->front_order; order != nullptr && matchable < volume; order = order->next) {
+                if (prevent && order->owner == owner) {
+                    if (stp != StpMode::CANCEL_RESTING) return matchable;
+                    continue;
+                }
+                matchable += order->volume;
+                if (order->iceberg) hidden += order->hidden;
+            }
+            matchable += hidden;
+        }
+        return matchable < volume ? matchable : volume;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    bool BasicBook<TickPolicy, LevelStorage>::remove(Order *const order) {
+        Order *to_remove = this->detach(order);
+
+        if (to_remove != nullptr) {
+            this->order_pool.release(to_remove);
+            return true;
+        } else { return false; }
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    bool BasicBook<TickPolicy, LevelStorage>::withdraw(Order *const order) {
+        // reject if order isn't in this book
+        if (order->book != this || order->limit == nullptr) return false;
+
+        const Side side = order->side;
+        Limit *const target_limit = this->unlink(order);
+        if (target_limit->size == 0) {
+            // remember where the best Limit was, settle looks up the next one from there
+            Limit *&best_limit = (side == Side::Buy) ? this->highest_buy : this->lowest_sell;
+            if (best_limit == target_limit) {
+                ((side == Side::Buy) ? this->stale_buy : this->stale_sell) = target_limit->price;
+                best_limit = nullptr;
+            }
+            ((side == Side::Buy) ? this->buy_set : this->sell_set).remove(target_limit->price);
+        }
+        this->order_pool.release(order);
+        return true;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    void BasicBook<TickPolicy, LevelStorage>::settle() {
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            int64_t &stale_price = (side == Side::Buy) ? this->stale_buy : this->stale_sell;
+            if (stale_price != 0) {
+                LevelStorage &target_side = (side == Side::Buy) ? (this->buy_set) : (this->sell_set);
+                Limit *&best_limit = (side == Side::Buy) ? this->highest_buy : this->lowest_sell;
+                StageTimer timer;
+                best_limit = target_side.next(stale_price);
+                if (best_limit != nullptr) target_side.recentre(best_limit->price);
+                timer.lap(Instrumentation::BEST_PRICE);
+                stale_price = 0;
+            }
+            this->publish_touch(side);
+        }
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::restore_level(const Side side, const int64_t price,
+                                                              const Snapshot::OrderRecord *const orders,
+                                                              const size_t count) {
+        LevelStorage &target_side = (side == Side::Buy) ? (this->buy_set) : (this->sell_set);
+        if (price <= 0 || count == 0) return nullptr;
+        if (target_side.get(price) != nullptr) return nullptr;    // level exists
+
+        // chain all orders at once, metadata is updated after
+        this->note_level(side, price, nullptr);
+        Limit *const target_limit = target_side.create(price);
+        Order *prev_order = nullptr;
+        uint64_t level_volume = 0;
+        uint64_t level_hidden = 0;
+        for (size_t i = 0; i < count; i++) {
+            Order *const new_order = this->create_order(orders[i].order_id, side, price, orders[i].volume,
+                                                        orders[i].owner, orders[i].stp);
+            if (orders[i].peak != 0) {
+                new_order->set_reserve(orders[i].hidden, orders[i].peak);
+                level_hidden += orders[i].hidden;
+            }
+            new_order->limit = target_limit;
+            new_order->prev = prev_order;
+            if (prev_order != nullptr) {
+                prev_order->next = new_order;
+            } else {
+                target_limit->front_order = new_order;
+            }
+            prev_order = new_order;
+            level_volume += orders[i].volume;
+        }
+        target_limit->tail_order = prev_order;
+        target_limit->size = count;
+        target_limit->volume = level_volume;
+
+        this->order_count += count;
+        (side == Side::Buy) ? (this->buy_volume += (int64_t) level_volume) : (this->sell_volume += (int64_t) level_volume);
+        ((side == Side::Buy) ? this->hidden_buy_volume : this->hidden_sell_volume) += (int64_t) level_hidden;
+
+        // Adjust Best offer, same as insert
+        Limit *&best_limit = (side == Side::Buy) ? this->highest_buy : this->lowest_sell;
+        if (best_limit == nullptr || ((side == Side::Buy) ? best_limit->price < price : best_limit->price > price)) {
+            best_limit = target_limit;
+            target_side.recentre(price);
+        }
+        if (target_limit == best_limit) this->publish_touch(side);
+
+        return target_limit->front_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::get_best_offer_id(Side side) const {
+        const Order *best_offer = this->get_best_offer(side);
+        return best_offer != nullptr ? best_offer->order_id : 0;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    Order *BasicBook<TickPolicy, LevelStorage>::get_best_offer(Side side) const {
+        const Limit *best_limit = (side == Side::Buy) ? this->lowest_sell : this->highest_buy;
+        if (best_limit == nullptr) return nullptr;
+        return best_limit->front_order;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    vector<Order *> BasicBook<TickPolicy, LevelStorage>::get_orders() const {
+        vector<Order *> all_orders;
+        all_orders.reserve(this->order_count);
+
+        // Buy side highest first, then Sell side lowest first
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            for (auto curr_limit = this->get_best_limit(side); curr_limit != nullptr;
+                 curr_limit = this->get_next_limit(side, curr_limit->price)) {
+                for (Order *order = curr_limit->front_order; order != nullptr; order = order->next) {
+                    all_orders.push_back(order);
+                }
+            }
+        }
+
+        return all_orders;
+    }
+
+
+    template<typename TickPolicy, typename LevelStorage>
+    size_t BasicBook<TickPolicy, LevelStorage>::depth(const Side side, const size_t n, DepthLevel *const out) const {
+        size_t level = 0;
+        for (const Limit *limit = this->get_best_limit(side); limit != nullptr && level < n;
+             limit = this->get_next_limit(side, limit->price), level++) {
+            out[level] = DepthLevel{this->to_price(limit->price), (int64_t) limit->volume, limit->size};
+        }
+        return level;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::get_order_count() const {
+        return this->order_count;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    int64_t BasicBook<TickPolicy, LevelStorage>::get_buy_volume() const {
+        return this->buy_volume;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    int64_t BasicBook<TickPolicy, LevelStorage>::get_sell_volume() const {
+        return this->sell_volume;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    uint64_t BasicBook<TickPolicy, LevelStorage>::get_volume_by_limit(Side side, int64_t price) const {
+        const LevelStorage &target_set = (side == Side::Buy) ? this->buy_set : this->sell_set;
+        auto target_limit = target_set.get(price);
+        if (target_limit == nullptr) {
+            return 0;
+        } else {
+            return target_limit->volume;
+        }
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    int64_t BasicBook<TickPolicy, LevelStorage>::get_highest_price() const {
+        return this->highest_buy != nullptr ? this->highest_buy->price : 0;
+    }
+
+    template<typename TickPolicy, typename LevelStorage>
+    int64_t BasicBook<TickPolicy, LevelStorage>::get_lowest_price() const {
+        return this->lowest_sell != nullptr ? this->lowest_sell->price : 0;
+    }
+}
+
+#endif  // !CLOB_IMPL_H
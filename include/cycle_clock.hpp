@@ -0,0 +1,64 @@
+#ifndef CYCLE_CLOCK_H
+#define CYCLE_CLOCK_H
+
+#include <cstdint>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace TradeDS {
+/**
+ * A cheap monotonic timestamp source for latency measurement\n
+ * Reads the time stamp counter on x86, falls back to std::chrono::steady_clock nanoseconds elsewhere\n
+ * Ticks are converted to nanoseconds with a ratio calibrated once against steady_clock\n
+ * \n
+ * Assumes an invariant TSC, as on every x86 server CPU of the last decade\n
+ */
+    class CycleClock {
+    public:
+        /**
+         * get the current timestamp, in ticks
+         */
+        static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        /**
+         * get the length of one tick in nanoseconds, calibrated on first call (~10ms)
+         */
+        static double ns_per_tick() {
+            static const double ratio = calibrate();
+            return ratio;
+        }
+
+        /**
+         * convert a number of ticks to nanoseconds
+         */
+        static double to_ns(uint64_t ticks) { return (double) ticks * ns_per_tick(); }
+
+    private:
+        static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+            using std::chrono::steady_clock;
+            const auto start_time = steady_clock::now();
+            const uint64_t start_ticks = now();
+            while (steady_clock::now() - start_time < std::chrono::milliseconds(10)) {}
+            const uint64_t ticks = now() - start_ticks;
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start_time);
+            return ticks == 0 ? 1.0 : (double) elapsed.count() / (double) ticks;
+#else
+            return 1.0;
+#endif
+        }
+    };
+}
+
+#endif  // !CYCLE_CLOCK_H
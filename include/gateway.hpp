@@ -0,0 +1,198 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "matching_engine.hpp"
+#include "types.hpp"
+#include "wire_format.hpp"
+
+using std::string, std::unique_ptr, std::vector;
+
+/**
+ * configuration of a Gateway
+ */
+struct GatewayConfig {
+    string address = "0.0.0.0";         // IPv4 address to listen on
+    uint16_t port = 0;                  // 0 for any free port, see Gateway::get_port
+    size_t max_sessions = 64;
+    size_t receive_buffer = 1 << 16;    // bytes per session, raised to Wire::MAX_MESSAGE_SIZE at least
+    size_t max_pending = 1 << 22;       // bytes of reports a session may leave unsent before it is closed
+    size_t batch_capacity = 1024;       // commands per MatchingEngine::process_batch at most, at least 1
+};
+
+/**
+ * A TCP order entry gateway in front of a MatchingEngine, speaking the binary protocol of wire_format.hpp\n
+ * \n
+ * One thread, the one calling poll or run, drives an epoll loop and the engine; nothing else may use the engine
+ * meanwhile. Every round, everything readable is received, the messages are read in place in each session's
+ * receive buffer and turned into OrderCommand, no symbol, no string, and all commands of the round go to
+ * the engine as one MatchingEngine::process_batch\n
+ * Execution reports are encoded inside the fill sink, straight into the send buffers of both sessions of a trade;
+ * send buffers are written out once per round\n
+ * \n
+ * Each session is an OwnerId, OwnerIds 1 to max_sessions belong to the gateway: every order a session adds is owned
+ * by it, a session only amends and cancels its own orders, and all its resting orders are cancelled with
+ * MatchingEngine::mass_cancel when it disconnects; the gateway keeps no order index of its own, ownership and the
+ * session to report a resting order's fills to both come from the owner the engine tracks\n
+ * Orders added to the engine by others than the gateway trade with sessions' orders normally, without reports\n
+ */
+class Gateway {
+private:
+    /**
+     * bytes of reports waiting to be sent, messages stay 8-byte aligned in it
+     */
+    struct SendBuffer {
+        unique_ptr<uint64_t[]> words;
+        size_t capacity = 0;    // bytes
+        size_t size = 0;        // bytes appended
+        size_t sent = 0;        // bytes of size written to the socket
+
+        /**
+         * append bytes, growing the buffer if needed
+         * @param bytes a multiple of 8
+         * @return where to write them
+         */
+        char *claim(size_t bytes);
+
+        /**
+         * drop what was sent, keeping alignment
+         */
+        void compact();
+
+        size_t pending() const { return this->size - this->sent; }
+    };
+
+    struct Session {
+        int fd;
+        OwnerId owner;
+        unique_ptr<uint64_t[]> receive;     // 8-byte aligned, a message always starts at a multiple of 8
+        size_t received = 0;                // bytes in receive, from the start of the first undecoded message
+        SendBuffer send;
+        bool queued = false;                // in the flush list of this round
+        bool writable = true;               // False while waiting for EPOLLOUT
+        bool closing = false;               // in the closing list of this round
+
+        Session(int fd, OwnerId owner, size_t receive_buffer);
+    };
+
+    MatchingEngine &engine;
+    const GatewayConfig config;
+    int listener = -1;
+    int epoll = -1;
+    uint16_t port = 0;
+    std::atomic<bool> running{false};
+
+    vector<unique_ptr<Session>> sessions;           // indexed by slot, owner is slot + 1; nullptr for a free slot
+    size_t session_count = 0;
+    vector<uint32_t> flushing;                      // slots with reports to send this round
+    vector<uint32_t> closing;                       // slots to close at the end of this round
+
+    vector<OrderCommand> batch;
+    vector<uint32_t> batch_sessions;                // slot of the session of each batch command
+    unique_ptr<bool[]> accepted;
+    size_t executed = 0;                            // commands executed this round
+
+    /**
+     * accept every pending connection
+     */
+    void accept_sessions();
+
+    /**
+     * read what is available on a session and decode its whole messages
+     */
+    void receive(uint32_t slot);
+
+    /**
+     * turn a message read in place into a batch command, or reject it right away
+     * @return False on a protocol error
+     */
+    bool decode(uint32_t slot, const Wire::MessageHeader &header);
+
+    /**
+     * check a session owns a resting order, by the owner the engine keeps on it; runs the batch first if the order
+     * isn't the session's yet, a pending command may add it
+     */
+    bool owns(uint32_t slot, uint64_t order_id);
+
+    /**
+     * run the batch through the engine, report, then clear it
+     */
+    void execute();
+
+    /**
+     * append an ExecutionReport to a session's send buffer
+     */
+    void report(uint32_t slot, Wire::ExecutionReport::Type type, Wire::MessageType command, InstrumentId instrument,
+                uint64_t order_id, int64_t price, int64_t volume, int64_t remaining_volume);
+
+    /**
+     * write out the send buffers of every session reported to this round
+     */
+    void flush();
+
+    /**
+     * cancel a session's resting orders, close and free its slot
+     */
+    void close_session(uint32_t slot);
+
+public:
+    /**
+     * @param engine driven by the thread calling poll or run
+     * @param config
+     */
+    explicit Gateway(MatchingEngine &engine, GatewayConfig config = GatewayConfig());
+
+    /**
+     * close all sessions and stop listening
+     */
+    ~Gateway();
+
+    Gateway(Gateway const &rhs) = delete;
+
+    Gateway &operator=(Gateway const &rhs) = delete;
+
+    /**
+     * bind and listen
+     * @return False if already open or on socket error
+     */
+    bool open();
+
+    /**
+     * close all sessions, cancelling their resting orders, and stop listening; the gateway can be opened again
+     */
+    void close();
+
+    /**
+     * run one round: wait up to timeout_ms for socket events, receive, execute every command received and send
+     * the reports
+     * @param timeout_ms -1 to wait for an event, 0 not to wait
+     * @return number of commands executed by the engine
+     */
+    size_t poll(int timeout_ms);
+
+    /**
+     * poll until stop
+     */
+    void run();
+
+    /**
+     * make run return after its current round, any thread
+     */
+    void stop() { this->running.store(false, std::memory_order_release); }
+
+    /**
+     * get the port listened on, the one picked when configured with 0
+     */
+    uint16_t get_port() const { return this->port; }
+
+    size_t get_session_count() const { return this->session_count; }
+};
+
+#endif  // !GATEWAY_H
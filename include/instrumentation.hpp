@@ -0,0 +1,128 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+#include "cycle_clock.hpp"
+#include "latency_histogram.hpp"
+
+namespace TradeDS {
+/**
+ * Hot-path instrumentation of MatchingEngine and BasicBook, compiled in with MATCHING_ENGINE_INSTRUMENTATION\n
+ * (cmake -DMATCHING_ENGINE_INSTRUMENTATION=ON); without it every probe is an empty inline function and costs nothing\n
+ * \n
+ * Stages are CycleClock tick intervals between stage boundaries of one accepted command; counters are
+ * per-operation counts, such as orders touched by one match\n
+ * Every thread records into its own Histograms, registered on its first sample and kept after the thread exits;
+ * recording is wait-free, never allocates after the first sample, and shares no cache line with other threads\n
+ * scrape and dump read all threads' Histograms from any thread while they are being recorded\n
+ */
+    class Instrumentation {
+    public:
+        enum Stage : uint8_t {
+            VALIDATE,       // order id and argument checks, including the order index lookup
+            RESOLVE,        // book lookup, tick conversion and order type pre-checks
+            MATCH,          // matching against the opposite side, fills included
+            INSERT,         // allocating, linking and indexing the resting remainder
+            TRIGGER,        // matching and inserting the stop orders triggered by the match
+            PUBLISH,        // journaling and level deltas
+            BEST_PRICE,     // finding the next best Limit once the best one empties, nested in MATCH or a cancel
+            STAGE_COUNT
+        };
+
+        enum Counter : uint8_t {
+            LEVELS_PER_MATCH,       // Limits an incoming order traded against
+            ORDERS_PER_MATCH,       // resting Orders an incoming order traded against
+            COUNTER_COUNT
+        };
+
+#ifdef MATCHING_ENGINE_INSTRUMENTATION
+        static constexpr bool ENABLED = true;
+#else
+        static constexpr bool ENABLED = false;
+#endif
+
+        struct alignas(64) Histograms {
+            LatencyHistogram stages[STAGE_COUNT];       // in CycleClock ticks
+            LatencyHistogram counters[COUNTER_COUNT];
+        };
+
+        /**
+         * get the Histograms of the calling thread, registering them on first call
+         */
+        static Histograms &local() {
+            thread_local Histograms *const histograms = register_thread();
+            return *histograms;
+        }
+
+        /**
+         * record the length of a stage, calling thread; no-op unless ENABLED
+         * @param stage
+         * @param ticks CycleClock ticks
+         */
+        static void record(Stage stage, uint64_t ticks) {
+            if constexpr (ENABLED) local().stages[stage].record(ticks);
+        }
+
+        /**
+         * record the value of a counter for one operation, calling thread; no-op unless ENABLED
+         * @param counter
+         * @param value
+         */
+        static void count(Counter counter, uint64_t value) {
+            if constexpr (ENABLED) local().counters[counter].record(value);
+        }
+
+        /**
+         * merge the Histograms of all threads so far, any thread
+         * @param total caller-owned Histograms all samples are added to
+         * @return number of threads merged
+         */
+        static size_t scrape(Histograms &total);
+
+        /**
+         * format the Histograms of all threads so far as a table, stages in nanoseconds, any thread
+         * @return one line per stage and counter: count, mean, p50, p99, p99.9 and max
+         */
+        static std::string dump();
+
+        static const char *name(Stage stage);
+
+        static const char *name(Counter counter);
+
+    private:
+        /**
+         * allocate and register the Histograms of a new thread, once per thread
+         */
+        static Histograms *register_thread();
+    };
+
+/**
+ * Times consecutive stages of one operation: each lap records the time since the previous lap, or construction\n
+ * Without MATCHING_ENGINE_INSTRUMENTATION the clock is never read\n
+ */
+    class StageTimer {
+    private:
+        uint64_t last;
+
+    public:
+        StageTimer() : last(Instrumentation::ENABLED ? CycleClock::now() : 0) {}
+
+        /**
+         * record the stage ending now
+         * @param stage
+         */
+        void lap(Instrumentation::Stage stage) {
+            if constexpr (Instrumentation::ENABLED) {
+                const uint64_t now = CycleClock::now();
+                Instrumentation::record(stage, now - this->last);
+                this->last = now;
+            }
+        }
+    };
+}
+
+#endif  // !INSTRUMENTATION_H
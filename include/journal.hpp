@@ -0,0 +1,194 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <thread>
+
+#include "types.hpp"
+
+using std::string;
+
+/**
+ * one journaled engine command, exactly one cache line\n
+ * records are 64-byte aligned in the file, so a record never straddles a page or a disk sector\n
+ * every byte is a declared field, padding included, so the same commands always write the same bytes; build
+ * records value-initialized, JournalRecord record{}, so unused fields and union bytes are zero too
+ */
+struct alignas(64) JournalRecord {
+    enum Type : uint8_t { ADD, AMEND, PULL, CREATE_BOOK, MASS_CANCEL, ADD_STOP, SET_PHASE };
+
+    static constexpr size_t MAX_SYMBOL_LENGTH = 20;
+
+    uint64_t sequence = 0;          // 1 + sequence of the previous record, 0 marks an unused record
+    InstrumentId instrument = 0;    // 0 for AMEND and PULL, which are keyed by order_id alone
+    Side side = Side::Buy;          // ADD and ADD_STOP only
+    uint8_t reserved_side[3] = {};  // zero
+    uint64_t order_id = 0;          // order_capacity of a CREATE_BOOK
+    int64_t price = 0;              // in API unit, unit of a CREATE_BOOK, 0 for the limit of a stop-market ADD_STOP
+    int64_t volume = 0;             // limit_capacity of a CREATE_BOOK, TradingPhase of a SET_PHASE
+    Type type = ADD;
+    uint8_t symbol_length = 0;      // CREATE_BOOK only
+    OrderType order_type = OrderType::LIMIT;    // ADD only
+    uint8_t reserved_type = 0;      // zero
+
+    // the participant of an ADD or ADD_STOP and the symbol of a CREATE_BOOK are never both needed
+    union {
+        char symbol[MAX_SYMBOL_LENGTH] = {};    // CREATE_BOOK only
+        struct {
+            OwnerId owner;
+            StpMode stp;
+            union {
+                char peak[sizeof(int64_t)];         // ADD; unaligned, see get_peak
+                char stop_price[sizeof(int64_t)];   // ADD_STOP, in API unit; unaligned, see get_stop_price
+            };
+        } participant;                          // ADD and ADD_STOP, owner of a MASS_CANCEL
+    };
+
+    int64_t get_stop_price() const {
+        int64_t price;
+        std::memcpy(&price, this->participant.stop_price, sizeof(price));
+        return price;
+    }
+
+    void set_stop_price(int64_t price) { std::memcpy(this->participant.stop_price, &price, sizeof(price)); }
+
+    int64_t get_peak() const {
+        int64_t peak;
+        std::memcpy(&peak, this->participant.peak, sizeof(peak));
+        return peak;
+    }
+
+    void set_peak(int64_t peak) { std::memcpy(this->participant.peak, &peak, sizeof(peak)); }
+};
+
+static_assert(sizeof(JournalRecord) == 64, "JournalRecord must stay one cache line");
+static_assert(offsetof(JournalRecord, order_id) == 16 && offsetof(JournalRecord, symbol) == 44,
+              "JournalRecord has no implicit padding");
+
+/**
+ * A write-ahead journal of the commands a MatchingEngine accepted, see MatchingEngine::set_journal\n
+ * The file is preallocated and memory-mapped up front; appending a record, on the matching thread, is a copy of one
+ * cache line into the mapping and a release store, no system call\n
+ * A flusher thread does group commit: every flush_interval it msyncs everything appended since its last flush at
+ * once, then publishes the last durable sequence, so acknowledgements can be held back until durable_sequence()
+ * covers them\n
+ * On open, an existing journal is scanned up to its last consecutive record, anything after it is a torn tail
+ * of a crash and is erased; appending continues from there\n
+ * \n
+ * Time-Complexity\n
+ * - append O(1)\n
+ * - open O(capacity)\n
+ */
+class Journal {
+private:
+    int fd = -1;
+    JournalRecord *records = nullptr;   // the mapped file
+    size_t capacity = 0;
+    size_t count = 0;                   // records appended, written by the engine thread
+
+    alignas(64) std::atomic<size_t> written{0};         // records published to the flusher
+    alignas(64) std::atomic<uint64_t> durable{0};       // sequence of the last record on disk, written by flusher
+    std::atomic<bool> running{false};
+    std::chrono::microseconds flush_interval{0};
+    std::thread flusher;
+
+    /**
+     * flusher loop, until close
+     * @param flushed number of records on disk at open; records appended before the thread starts are still flushed
+     */
+    void run(size_t flushed);
+
+    /**
+     * msync records [from, to) and publish them as durable
+     * @return False if msync failed, nothing is published
+     */
+    bool flush(size_t from, size_t to);
+
+public:
+    Journal() = default;
+
+    /**
+     * flush, stop the flusher and unmap
+     */
+    ~Journal();
+
+    Journal(Journal const &rhs) = delete;
+
+    Journal &operator=(Journal const &rhs) = delete;
+
+    /**
+     * open, or create, a journal file and start its flusher thread
+     * @param path
+     * @param capacity number of records to preallocate; an existing larger file keeps its size
+     * @param flush_interval optional, time between two group commits when idle
+     * @return True on success
+     * @return False if already open, on I/O error, or if the file isn't a whole number of records
+     */
+    bool open(const string &path, size_t capacity,
+              std::chrono::microseconds flush_interval = std::chrono::microseconds(100));
+
+    /**
+     * flush everything appended, stop the flusher and unmap, waits up to one flush_interval; the journal can be
+     * opened again
+     */
+    void close();
+
+    bool is_open() const { return this->records != nullptr; }
+
+    /**
+     * check whether another record can be appended, engine thread
+     */
+    bool full() const { return this->count == this->capacity; }
+
+    /**
+     * append a record and hand it to the flusher, engine thread
+     * @param record sequence must be 1 + last_sequence(), or anything but 0 on an empty journal
+     * @return False if the journal is full
+     */
+    bool append(const JournalRecord &record) {
+        if (this->full()) return false;
+        JournalRecord &slot = this->records[this->count];
+        std::memcpy(reinterpret_cast<char *>(&slot) + sizeof(slot.sequence),
+                    reinterpret_cast<const char *>(&record) + sizeof(record.sequence),
+                    sizeof(JournalRecord) - sizeof(record.sequence));
+        // sequence last, the page cache never holds a record that looks complete but isn't
+        __atomic_store_n(&slot.sequence, record.sequence, __ATOMIC_RELEASE);
+        this->written.store(++this->count, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * get the number of records, engine thread
+     */
+    size_t size() const { return this->count; }
+
+    /**
+     * get a record, engine thread
+     * @param index < size()
+     */
+    const JournalRecord &operator[](size_t index) const { return this->records[index]; }
+
+    /**
+     * get the sequence of the last record appended, 0 if empty; engine thread
+     */
+    uint64_t last_sequence() const { return this->count > 0 ? this->records[this->count - 1].sequence : 0; }
+
+    /**
+     * get the sequence of the last record on disk, 0 if none yet; any thread
+     */
+    uint64_t durable_sequence() const { return this->durable.load(std::memory_order_acquire); }
+
+    /**
+     * block until a sequence is on disk, any thread but the flusher
+     * @param sequence
+     */
+    void wait_durable(uint64_t sequence) const;
+};
+
+#endif  // !JOURNAL_H
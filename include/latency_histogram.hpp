@@ -0,0 +1,129 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace TradeDS {
+/**
+ * A fixed-size log-linear histogram of latency samples, in the spirit of HdrHistogram\n
+ * Values below 64 are counted exactly, above that every power of 2 is split into 32 buckets,
+ * so any recorded value is reported within ~3% whatever its magnitude\n
+ * \n
+ * Single writer, any reader: record() is wait-free and never allocates, counts are relaxed atomics
+ * so another thread may read percentiles while samples are being recorded\n
+ * \n
+ * Time-Complexity\n
+ * - record O(1)\n
+ * - percentile / merge O(B); where B is the number of buckets, 1920\n
+ */
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 5;
+        static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;   // 2^64 - 1 lands in the last
+
+    private:
+        std::atomic<uint64_t> counts[BUCKETS] = {};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max_value{0};
+
+        static size_t bucket_of(uint64_t value) {
+            if (value < 2 * SUB_BUCKETS) return value;
+            const unsigned shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+            return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+        }
+
+        /**
+         * get the highest value counted in a bucket
+         */
+        static uint64_t value_of(size_t bucket) {
+            if (bucket < 2 * SUB_BUCKETS) return bucket;
+            const unsigned shift = bucket / SUB_BUCKETS - 1;
+            const uint64_t sub_bucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+            return (sub_bucket << shift) + ((1ull << shift) - 1);
+        }
+
+        static void bump(std::atomic<uint64_t> &counter, uint64_t delta) {
+            counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+    public:
+        LatencyHistogram() = default;
+
+        LatencyHistogram(LatencyHistogram const &rhs) = delete;
+
+        LatencyHistogram &operator=(LatencyHistogram const &rhs) = delete;
+
+        /**
+         * count one sample, writer side
+         * @param value any unit, ticks or nanoseconds
+         */
+        void record(uint64_t value) {
+            bump(this->counts[bucket_of(value)], 1);
+            bump(this->total, 1);
+            bump(this->sum, value);
+            if (value > this->max_value.load(std::memory_order_relaxed)) {
+                this->max_value.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * add all samples of another histogram into this one, writer side
+         * @param other
+         */
+        void merge(const LatencyHistogram &other) {
+            for (size_t i = 0; i < BUCKETS; i++) bump(this->counts[i], other.counts[i].load(std::memory_order_relaxed));
+            bump(this->total, other.count());
+            bump(this->sum, other.sum.load(std::memory_order_relaxed));
+            if (other.max() > this->max()) this->max_value.store(other.max(), std::memory_order_relaxed);
+        }
+
+        /**
+         * drop all samples, writer side
+         */
+        void reset() {
+            for (auto &count: this->counts) count.store(0, std::memory_order_relaxed);
+            this->total.store(0, std::memory_order_relaxed);
+            this->sum.store(0, std::memory_order_relaxed);
+            this->max_value.store(0, std::memory_order_relaxed);
+        }
+
+        uint64_t count() const { return this->total.load(std::memory_order_relaxed); }
+
+        uint64_t max() const { return this->max_value.load(std::memory_order_relaxed); }
+
+        double mean() const {
+            const uint64_t n = this->count();
+            return n == 0 ? 0.0 : (double) this->sum.load(std::memory_order_relaxed) / (double) n;
+        }
+
+        /**
+         * get the value below or at which a given fraction of samples fall
+         * @param quantile in [0, 1], e.g. 0.99 for p99
+         * @return upper bound of the bucket holding the quantile, never above max(); 0 if empty
+         */
+        uint64_t percentile(double quantile) const {
+            const uint64_t n = this->count();
+            if (n == 0) return 0;
+
+            uint64_t rank = (uint64_t) (quantile * (double) n + 0.5);
+            if (rank == 0) rank = 1;
+            if (rank > n) rank = n;
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                seen += this->counts[i].load(std::memory_order_relaxed);
+                if (seen >= rank) {
+                    const uint64_t value = value_of(i);
+                    return value < this->max() ? value : this->max();
+                }
+            }
+            return this->max();
+        }
+    };
+}
+
+#endif  // !LATENCY_HISTOGRAM_H
@@ -0,0 +1,100 @@
+#ifndef LEVEL_BITMAP_H
+#define LEVEL_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace TradeDS {
+/**
+ * A hierarchical occupancy bitmap over non-negative indexes\n
+ * Level 0 holds one bit per index, every upper level holds one bit per non-zero 64-bit word of the level below\n
+ * and the top level is a single word, so searching the next set index costs one ctz/clz per level\n
+ * Storage grows on demand, it never shrinks\n
+ * \n
+ * Time-Complexity\n
+ * - set / clear / test O(log64 n)\n
+ * - find_next / find_prev O(log64 n)\n
+ */
+    class LevelBitmap {
+    private:
+        vector<vector<uint64_t>> levels;   // levels[0] is the leaf level, levels.back() is a single word
+
+        /**
+         * grow storage so that index can be addressed, upper levels are rebuilt
+         * @param index
+         */
+        void grow(uint64_t index);
+
+    public:
+        static constexpr int64_t NONE = -1;
+
+        /**
+         * construct an empty LevelBitmap\n
+         * @param size optional, number of indexes addressable without growing
+         */
+        explicit LevelBitmap(size_t size = 4096);
+
+        /**
+         * number of indexes addressable without growing
+         */
+        size_t size() const { return this->levels[0].size() * 64; }
+
+        /**
+         * mark an index as occupied
+         */
+        void set(uint64_t index) {
+            if ((index >> 6) >= this->levels[0].size()) this->grow(index);
+
+            for (auto &level: this->levels) {
+                uint64_t &word = level[index >> 6];
+                const bool was_empty = (word == 0);
+                word |= (1ull << (index & 63));
+                if (!was_empty) break;  // upper levels already know about this word
+                index >>= 6;
+            }
+        }
+
+        /**
+         * mark an index as empty
+         */
+        void clear(uint64_t index) {
+            if ((index >> 6) >= this->levels[0].size()) return;
+
+            for (auto &level: this->levels) {
+                uint64_t &word = level[index >> 6];
+                word &= ~(1ull << (index & 63));
+                if (word != 0) break;   // word still occupied, upper levels unchanged
+                index >>= 6;
+            }
+        }
+
+        /**
+         * if an index is occupied
+         */
+        bool test(uint64_t index) const {
+            if ((index >> 6) >= this->levels[0].size()) return false;
+            return (this->levels[0][index >> 6] >> (index & 63)) & 1;
+        }
+
+        /**
+         * find the smallest occupied index greater or equal to a given index
+         * @param index
+         * @return occupied index, NONE if there is no such index
+         */
+        int64_t find_next(uint64_t index) const;
+
+        /**
+         * find the largest occupied index less or equal to a given index
+         * @param index
+         * @return occupied index, NONE if there is no such index
+         */
+        int64_t find_prev(uint64_t index) const;
+    };
+}
+
+#endif  // !LEVEL_BITMAP_H
@@ -0,0 +1,149 @@
+#ifndef LEVEL_STORAGE_H
+#define LEVEL_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <vector>
+
+#include "level_bitmap.hpp"
+#include "limit.hpp"
+#include "object_pool.hpp"
+#include "sparse_set.hpp"
+#include "types.hpp"
+
+using std::map, std::vector;
+
+namespace TradeDS {
+/**
+ * Level storage of one Side of a TradeDS::BasicBook, owning its non-empty Limits and indexing them by price in ticks\n
+ * Absolute price indexing: a SparseSet storing Limits inline, plus a LevelBitmap of occupied prices\n
+ * Memory is proportional to the price range in use, a lookup is one page indirection straight to the Limit\n
+ * With a MaxTick, both are sized for the whole band up front and never grow nor range-check, see TradeDS::FixedTick\n
+ * \n
+ * Every level storage provides the same interface:\n
+ * - get(price): Limit at price, nullptr if none\n
+ * - create(price): new empty Limit at price, its address is stable until removed\n
+ * - remove(price): retire the Limit at price\n
+ * - next(price): next non-empty Limit strictly after price moving away from the touch, nullptr if none\n
+ * - recentre(touch): hint that the best price of the Side moved to touch\n
+ * - reserve(count): preallocate room for count Limits where storage allows\n
+ *
+ * @tparam MaxTick optional, highest price in ticks ever stored, 0 for unbounded
+ */
+    template<uint64_t MaxTick = 0>
+    class BasicSparseLevels {
+    private:
+        const Side side;
+        SparseSet<Limit, 1024, MaxTick> limits{0};    // 64KB pages of 1024 inline Limits
+        LevelBitmap occupied{MaxTick > 0 ? MaxTick + 1 : 4096};
+
+    public:
+        /**
+         * construct an empty BasicSparseLevels
+         * @param side Side of the resting orders, decides what "away from the touch" means
+         */
+        explicit BasicSparseLevels(Side side) : side{side} {};
+
+        Limit *get(int64_t price) const { return this->occupied.test(price) ? this->limits.find(price) : nullptr; }
+
+        Limit *create(int64_t price) {
+            this->occupied.set(price);
+            return this->limits.emplace(price, price);
+        }
+
+        void remove(int64_t price) {
+            this->occupied.clear(price);
+            this->limits.erase(price);
+        }
+
+        Limit *next(int64_t price) const {
+            int64_t limit_idx;
+            if (this->side == Side::Buy) {
+                limit_idx = (price > 0) ? this->occupied.find_prev(price - 1) : LevelBitmap::NONE;
+            } else {
+                limit_idx = this->occupied.find_next(price + 1);
+            }
+            return (limit_idx == LevelBitmap::NONE) ? nullptr : this->limits.find(limit_idx);
+        }
+
+        void recentre(int64_t) {}
+
+        void reserve(size_t) {}     // pages are allocated per price range, on demand
+    };
+
+    using SparseLevels = BasicSparseLevels<>;
+
+/**
+ * Level storage of one Side of a TradeDS::BasicBook, indexing non-empty Limits by price in ticks\n
+ * Price-window indexing: a fixed-size circular array of Limits covering window_size consecutive prices around\n
+ * the touch, plus an ordered overflow map for Limits far away from it; Limits themselves come from a pool\n
+ * The working set of the levels that actually trade stays small and L1/L2 resident whatever the absolute price\n
+ * \n
+ * The window re-centres when the touch gets within 1/8 of window_size of either edge, placing it 1/4 from the edge\n
+ * on the improving side; Limits leaving the window move to the overflow map and vice versa\n
+ * a Limit never moves in memory, so Order::limit stays valid\n
+ * \n
+ * Time-Complexity\n
+ * - get / insert / remove O(1) in window, O(log M) in overflow; where M is the size of overflow\n
+ * - next O(log64 W + log M); where W is window_size\n
+ * - recentre O(W / 64 + K log M) when triggered; where K is the number of Limits changing place\n
+ */
+    class WindowLevels {
+    private:
+        const Side side;
+        const int64_t WINDOW_SIZE;
+        const int64_t WINDOW_MASK;
+        int64_t base = 0;           // lowest price covered by the window
+        size_t window_count = 0;    // number of Limits in the window
+        vector<Limit *> window;     // price p is stored at p & WINDOW_MASK
+        LevelBitmap occupied;       // occupancy of window slots
+        map<int64_t, Limit *> overflow;
+        ObjectPool<Limit> limit_pool;   // storage of all Limits of this side
+
+        bool in_window(int64_t price) const { return price >= this->base && price < this->base + this->WINDOW_SIZE; }
+
+        /**
+         * find non-empty window price in [low, high], the lowest one if ascending, the highest one otherwise
+         * @return price, LevelBitmap::NONE if there is none
+         */
+        int64_t find_in_window(int64_t low, int64_t high, bool ascending) const;
+
+        /**
+         * index a Limit at its price, in window or in overflow
+         */
+        void place(int64_t price, Limit *limit);
+
+    public:
+        /**
+         * construct an empty WindowLevels
+         * @param side Side of the resting orders, decides what "away from the touch" means
+         * @param window_size optional, number of consecutive prices held in the circular array, must be power of 2
+         */
+        explicit WindowLevels(Side side, size_t window_size = 1024);
+
+        Limit *get(int64_t price) const {
+            if (this->in_window(price)) return this->window[price & this->WINDOW_MASK];
+
+            auto it = this->overflow.find(price);
+            return it == this->overflow.end() ? nullptr : it->second;
+        }
+
+        Limit *create(int64_t price) {
+            Limit *const limit = this->limit_pool.acquire(price);
+            this->place(price, limit);
+            return limit;
+        }
+
+        void remove(int64_t price);
+
+        Limit *next(int64_t price) const;
+
+        void recentre(int64_t touch);
+
+        void reserve(size_t limit_capacity) { this->limit_pool.reserve(limit_capacity); }
+    };
+}
+
+#endif  // !LEVEL_STORAGE_H
@@ -0,0 +1,38 @@
+#ifndef LIMIT_H
+#define LIMIT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace TradeDS {
+    struct Order;
+
+    /**
+     * A Limit Price, containing all orders with respected price, chained in double linked list chronological order\n
+     * Exactly one cache line, so it can be stored inline in level arrays and reading a level's metadata costs one
+     * miss; price is not const so Limits can be stored by value
+     */
+    struct alignas(64) Limit {
+        int64_t price = 0;      // in ticks
+        size_t size = 0;
+        unsigned long long int volume = 0;
+
+        /**
+         * Order in this Limit price with highest priority
+         */
+        Order *front_order = nullptr;
+        /**
+         * Order in this Limit price with lowest priority
+        */
+        Order *tail_order = nullptr;
+
+        Limit() = default;
+
+        explicit Limit(int64_t limitPrice) : price{limitPrice} {};
+    };
+
+    // size budget, a regression here costs a cache miss per level
+    static_assert(sizeof(Limit) == 64, "a Limit must fit in exactly one cache line");
+}
+
+#endif  // !LIMIT_H
@@ -4,27 +4,134 @@
 #include <cstdint>
 
 #include "clob.hpp"
+#include "instrumentation.hpp"
+#include "journal.hpp"
+#include "order_index.hpp"
+#include "spsc_ring.hpp"
+#include <future>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-using std::string, std::unordered_map, std::vector, TradeDS::Book;
+using std::string, std::unordered_map, std::vector, TradeDS::Book, TradeDS::Order, TradeDS::OrderIndex;
+using TradeDS::Instrumentation, TradeDS::StageTimer;
 
 class MatchingEngine {
 private:
-    unordered_map<string, Book *> books;  // all books for all symbols
-    unordered_map<uint64_t, Book *> order_book_map;
+    unordered_map<string, InstrumentId> instrument_ids;     // symbol registry, symbol - instrument id
+    vector<Book *> books{nullptr};      // all books for all symbols, indexed by instrument id; 0 is invalid
+    OrderIndex orders;  // order_id - Order, the only order_id index for all books
+    OrderIndex stops;   // order_id - stop Order waiting for its trigger, apart so orders only ever holds resting ones
+    unordered_map<OwnerId, TradeDS::OwnerLink> owners;     // owner - head of the list of its resting and stop orders
+    vector<Book *> settling;        // books touched by the running mass_cancel
+    Journal *journal = nullptr;     // optional, see set_journal
+    uint64_t sequence = 0;          // number of state changing commands accepted so far
+
+    /**
+     * match an incoming order against a book, keeping the order index in sync with filled resting orders
+     * @param target_book
+     * @param side Side of the incoming order
+     * @param price limit price of the incoming order, in ticks
+     * @param volume volume of the incoming order
+     * @param aggressor_id order_id of the incoming order
+     * @param on_fill fill sink, self-trades are reported as Fill::SELF_TRADE_PREVENTED
+     * @param owner optional, owner of the incoming order
+     * @param stp optional, self-trade prevention of the incoming order
+     * @return volume left unmatched, and not cancelled
+     */
+    template<typename FillSink>
+    uint64_t match(Book *target_book, Side side, int64_t price, uint64_t volume, uint64_t aggressor_id,
+                   FillSink &on_fill, OwnerId owner = 0, StpMode stp = StpMode::NONE);
+
+    /**
+     * match and insert every stop order the last trades of a book triggered, until none is left; the trades of a
+     * triggered stop order may trigger more, see TradeDS::BasicBook::next_triggered\n
+     * a triggered stop order matches with its owner and self-trade prevention; a stop-limit order rests what's
+     * left at its limit price, a stop-market order drops it
+     * @param target_book
+     * @param on_fill fill sink
+     */
+    template<typename FillSink>
+    void trigger_stops(Book *target_book, FillSink &on_fill);
+
+    /**
+     * update a resting order, see amend_order
+     * @param target_order
+     * @param new_price
+     * @param new_active_volume
+     * @param on_fill fill sink
+     * @return True on successful update, False on invalid price or volume
+     */
+    template<typename FillSink>
+    bool amend(Order *target_order, int64_t new_price, int64_t new_active_volume, FillSink &on_fill);
+
+    /**
+     * destruct all books and forget all orders and symbols
+     */
+    void clear();
+
+    /**
+     * check whether an order_id is taken, by a resting order or by a stop order waiting for its trigger
+     */
+    bool order_exists(uint64_t order_id) const {
+        if (this->orders.find(order_id) != nullptr) return true;
+        return this->stops.size() > 0 && this->stops.find(order_id) != nullptr;
+    }
+
+    /**
+     * chain a new resting or stop order at the tail of its owner's list, if it has an owner
+     */
+    void link_owner(Order *order) {
+        if (order->owner == 0) return;
+        TradeDS::OwnerLink &head = this->owners[order->owner];
+        if (head.next == nullptr) head = {&head, &head, nullptr};   // first order of this owner
+        order->owner_link.link_before(&head);
+    }
+
+    /**
+     * check whether an attached journal has no room for another command, which is then rejected
+     */
+    bool journal_full() const { return this->journal != nullptr && this->journal->full(); }
+
+    /**
+     * count an accepted command, and append it to the journal if one is attached
+     * @param stop_price ADD_STOP only, in API unit
+     */
+    void commit(JournalRecord::Type type, InstrumentId instrument, Side side, uint64_t order_id, int64_t price,
+                int64_t volume, OrderType order_type = OrderType::LIMIT, OwnerId owner = 0,
+                StpMode stp = StpMode::NONE, int64_t peak = 0, int64_t stop_price = 0) {
+        this->sequence++;
+        if (this->journal != nullptr) {
+            JournalRecord record{};
+            record.sequence = this->sequence;
+            record.instrument = instrument;
+            record.side = side;
+            record.order_id = order_id;
+            record.price = price;
+            record.volume = volume;
+            record.type = type;
+            record.order_type = order_type;
+            record.participant.owner = owner;
+            record.participant.stp = stp;
+            (type == JournalRecord::ADD_STOP) ? record.set_stop_price(stop_price) : record.set_peak(peak);
+            this->journal->append(record);
+        }
+    }
 
 public:
     MatchingEngine() = default;
 
     /**
-     * Unused, importing existing TradeDS::Books and indexing all orders
+     * Unused, importing existing TradeDS::Books and indexing all orders\n
+     * the engine takes ownership of the books, each gets an instrument id in the given order
      * @param books existing order books
      */
     [[maybe_unused]] explicit MatchingEngine(vector<Book *> books);
 
-    ~MatchingEngine() = default;
+    /**
+     * destruct the engine and all of its books
+     */
+    ~MatchingEngine();
 
     MatchingEngine(MatchingEngine const &rhs) = delete;
 
@@ -34,6 +141,26 @@ public:
 
     MatchingEngine &operator=(MatchingEngine const &&rhs) = delete;
 
+    /**
+     * create the TradeDS::Book of a new symbol up front and register it\n
+     * books of unknown symbols are otherwise created on first add_order with a unit of 1
+     * @param symbol
+     * @param unit the API price increment of one tick
+     * @param order_capacity optional, number of Orders to preallocate
+     * @param limit_capacity optional, number of Limits to preallocate
+     * @return the instrument id of the new book
+     * @return 0 if symbol is empty, already registered or unit is not positive
+     * @return 0 if journaling, and the symbol is longer than JournalRecord::MAX_SYMBOL_LENGTH or the journal is full
+     */
+    InstrumentId create_book(const string &symbol, int64_t unit, size_t order_capacity = 0, size_t limit_capacity = 0);
+
+    /**
+     * get the instrument id of a registered symbol
+     * @param symbol
+     * @return instrument id, 0 if symbol isn't registered
+     */
+    InstrumentId get_instrument_id(const string &symbol) const;
+
     /**
      * get the reference of a TradeDS::Book with a given symbol
      * @param symbol
@@ -41,12 +168,29 @@ public:
      */
     Book *get_book(const string &symbol);
 
+    /**
+     * get the reference of a TradeDS::Book with a given instrument id
+     * @param instrument
+     * @return the reference of a TradeDS::Book, nullptr if instrument id is invalid
+     */
+    Book *get_book(InstrumentId instrument) const {
+        return instrument < this->books.size() ? this->books[instrument] : nullptr;
+    }
+
+    /**
+     * get the reference of a resting TradeDS::Order with a given order_id\n
+     * the Order knows which TradeDS::Book it belongs to
+     * @param order_id
+     * @return the reference of a TradeDS::Order, nullptr if order_id doesn't exist
+     */
+    const Order *get_order(uint64_t order_id) const;
+
     /**
      * Attempt to fill then add an new order into it's corresponding Book\n
      * \n
      * time-complexity depends on: \n
      * Book's orders distribution\n
-     * TradeDS::Book.insert, TradeDS::Book.amend, TradeDS::Book.remove\n
+     * TradeDS::Book.match, TradeDS::Book.insert\n
      * The denser Book's possible Limits are, the similar offer's volumes are
      * The closer it runs on O(1)
      *
@@ -56,17 +200,126 @@ public:
      * @param price
      * @param volume
      * @param fills an vector passed by reference, all filled order needs to be written in there
+     * @param type optional, see OrderType; only LIMIT and POST_ONLY orders rest their remainder
+     * @param owner optional, owner of the order, 0 for none
+     * @param stp optional, self-trade prevention against resting orders of the same owner, see StpMode;
+     * cancelled volume is reported as Fill::SELF_TRADE_PREVENTED
+     * @param peak optional, LIMIT only: makes the resting remainder an iceberg order displaying at most peak at a
+     * time, see TradeDS::Order; the order matches with its whole volume on arrival; 0 for a fully displayed order
      * @return True on successful (partial) fill or insertion
      * @return False on invalid order_id; 0, existing id
      * @return False on bad symbol
-     * @return False on negative price or volume
+     * @return False on negative price or volume, the price of a MARKET order is ignored
+     * @return False if price is not a multiple of the Book's unit
+     * @return False if a FOK order can't fill completely, from displayed and iceberg reserve volume, self-trade
+     * prevention included, or a POST_ONLY order would match; nothing is done
+     * @return False if not a LIMIT order while the Book is in TradingPhase::AUCTION, see set_phase
+     * @return False on negative peak, or a peak for another type than LIMIT
      */
     bool add_order(uint64_t order_id, string const &symbol, Side side,
-                   int64_t price, int64_t volume, vector<Fill> &fills);
+                   int64_t price, int64_t volume, vector<Fill> &fills, OrderType type = OrderType::LIMIT,
+                   OwnerId owner = 0, StpMode stp = StpMode::NONE, int64_t peak = 0);
+
+    /**
+     * Attempt to fill then add an new order into the Book of a given instrument id\n
+     * same as add_order with a symbol, without hashing the symbol
+     *
+     * @param order_id
+     * @param instrument instrument id returned by create_book or get_instrument_id
+     * @param side
+     * @param price
+     * @param volume
+     * @param fills an vector passed by reference, all filled order needs to be written in there
+     * @param type optional, see OrderType; only LIMIT and POST_ONLY orders rest their remainder
+     * @param owner optional, owner of the order, 0 for none
+     * @param stp optional, self-trade prevention against resting orders of the same owner, see StpMode;
+     * cancelled volume is reported as Fill::SELF_TRADE_PREVENTED
+     * @param peak optional, LIMIT only: makes the resting remainder an iceberg order displaying at most peak at a
+     * time, see TradeDS::Order; the order matches with its whole volume on arrival; 0 for a fully displayed order
+     * @return True on successful (partial) fill or insertion
+     * @return False on invalid order_id; 0, existing id
+     * @return False on invalid instrument id
+     * @return False on negative price or volume, the price of a MARKET order is ignored
+     * @return False if price is not a multiple of the Book's unit
+     * @return False if a FOK order can't fill completely, from displayed and iceberg reserve volume, self-trade
+     * prevention included, or a POST_ONLY order would match; nothing is done
+     * @return False if not a LIMIT order while the Book is in TradingPhase::AUCTION, see set_phase
+     * @return False on negative peak, or a peak for another type than LIMIT
+     */
+    bool add_order(uint64_t order_id, InstrumentId instrument, Side side,
+                   int64_t price, int64_t volume, vector<Fill> &fills, OrderType type = OrderType::LIMIT,
+                   OwnerId owner = 0, StpMode stp = StpMode::NONE, int64_t peak = 0);
+
+    /**
+     * Attempt to fill then add an new order into the Book of a given instrument id, reporting fills to a sink\n
+     * each Fill is handed to the sink as soon as it happens, inside the matching loop, so downstream consumers
+     * can be pipelined with the match and no heap memory is used for reporting\n
+     * a TradeDS::SpscRing<Fill> can be passed as sink, see also add_order with a vector of fills
+     *
+     * @tparam FillSink callable as void(const Fill &)
+     * @param order_id
+     * @param instrument instrument id returned by create_book or get_instrument_id
+     * @param side
+     * @param price
+     * @param volume
+     * @param on_fill fill sink
+     * @param type optional, see OrderType; only LIMIT and POST_ONLY orders rest their remainder
+     * @param owner optional, owner of the order, 0 for none
+     * @param stp optional, self-trade prevention against resting orders of the same owner, see StpMode;
+     * cancelled volume is reported as Fill::SELF_TRADE_PREVENTED
+     * @param peak optional, display volume of an iceberg order, see add_order with a vector of fills
+     * @return same as add_order with a vector of fills
+     */
+    template<typename FillSink>
+    bool add_order(uint64_t order_id, InstrumentId instrument, Side side,
+                   int64_t price, int64_t volume, FillSink &&on_fill, OrderType type = OrderType::LIMIT,
+                   OwnerId owner = 0, StpMode stp = StpMode::NONE, int64_t peak = 0);
+
+    /**
+     * add a stop or stop-limit order, waiting in the Book of a given instrument id until the last trade price
+     * reaches its stop price, see TradeDS::BasicBook::insert_stop\n
+     * a Buy stop triggers once a trade is at or above stop_price, a Sell stop once a trade is at or below it; it then
+     * enters as a LIMIT order at price, or as a MARKET order without price, under the same order_id\n
+     * triggered stops are matched right after the command whose trades triggered them, with their fills reported
+     * to that command's sink; a stop the last trade price is already through triggers right away\n
+     * a waiting stop order can be pulled, not amended; it counts among its owner's orders for mass_cancel\n
+     * \n
+     * time-complexity O(1) until triggered
+     *
+     * @tparam FillSink callable as void(const Fill &)
+     * @param order_id
+     * @param instrument instrument id returned by create_book or get_instrument_id
+     * @param side
+     * @param stop_price trigger price
+     * @param price limit price once triggered, 0 for a stop-market order
+     * @param volume
+     * @param on_fill fill sink
+     * @param owner optional, see add_order
+     * @param stp optional, self-trade prevention once triggered, see add_order
+     * @return True on success
+     * @return False on invalid order_id; 0, existing id
+     * @return False on invalid instrument id
+     * @return False on non positive stop_price or volume, negative price
+     * @return False if stop_price or price is not a multiple of the Book's unit
+     */
+    template<typename FillSink>
+    bool add_stop_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t stop_price, int64_t price,
+                        int64_t volume, FillSink &&on_fill, OwnerId owner = 0, StpMode stp = StpMode::NONE);
+
+    /**
+     * add a stop or stop-limit order, see add_stop_order with a sink
+     * @param fills an vector passed by reference, fills of a stop triggered right away are written in there
+     */
+    bool add_stop_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t stop_price, int64_t price,
+                        int64_t volume, vector<Fill> &fills, OwnerId owner = 0, StpMode stp = StpMode::NONE);
 
     /**
      * update an existing order, then only attempt to fill it if price changed\n
      * if price changed, or volume is increased, order loses it's priority position; it will be re-evaluated\n
+     * a repriced order matches with the owner and self-trade prevention of its add_order\n
+     * in TradingPhase::AUCTION, it is re-inserted without matching\n
+     * new_active_volume is the displayed volume of an iceberg order, its reserve is kept; once repriced, it matches
+     * with both and displays at most its peak again\n
      *
      * @param order_id
      * @param new_price
@@ -75,24 +328,528 @@ public:
      * @return True on successful update
      * @return False if order_id doesn't exist
      * @return False on invalid price or volume (<=0)
+     * @return False if new_price is not a multiple of the Book's unit
      */
     bool amend_order(uint64_t order_id, int64_t new_price, int64_t new_active_volume,
                      vector<Fill> &fills);
 
+    /**
+     * update an existing order, reporting fills to a sink, see amend_order and add_order with a sink
+     *
+     * @tparam FillSink callable as void(const Fill &)
+     * @param order_id
+     * @param new_price
+     * @param new_active_volume
+     * @param on_fill fill sink
+     * @return same as amend_order with a vector of fills
+     */
+    template<typename FillSink>
+    bool amend_order(uint64_t order_id, int64_t new_price, int64_t new_active_volume, FillSink &&on_fill);
+
+    /**
+     * update an existing order of a given instrument id, see amend_order\n
+     *
+     * @param instrument instrument id the order belongs to
+     * @param order_id
+     * @param new_price
+     * @param new_active_volume
+     * @param fills
+     * @return True on successful update
+     * @return False if order_id doesn't exist in the Book of instrument
+     * @return False on invalid price or volume (<=0)
+     * @return False if new_price is not a multiple of the Book's unit
+     */
+    bool amend_order(InstrumentId instrument, uint64_t order_id, int64_t new_price, int64_t new_active_volume,
+                     vector<Fill> &fills);
+
+    /**
+     * update an existing order of a given instrument id, reporting fills to a sink, see amend_order
+     *
+     * @tparam FillSink callable as void(const Fill &)
+     * @param instrument instrument id the order belongs to
+     * @param order_id
+     * @param new_price
+     * @param new_active_volume
+     * @param on_fill fill sink
+     * @return same as amend_order with an instrument id and a vector of fills
+     */
+    template<typename FillSink>
+    bool amend_order(InstrumentId instrument, uint64_t order_id, int64_t new_price, int64_t new_active_volume,
+                     FillSink &&on_fill);
+
     /**
      * remove an existing order given an order_id, Order will also be destructed\n
+     * a stop order waiting for its trigger is removed the same way\n
      * @param order_id
      * @return True on successful removal
      * @return False if order_id doesn't exist
      */
     bool pull_order(uint64_t order_id);
 
+    /**
+     * remove an existing order of a given instrument id, see pull_order\n
+     * @param instrument instrument id the order belongs to
+     * @param order_id
+     * @return True on successful removal
+     * @return False if order_id doesn't exist in the Book of instrument
+     */
+    bool pull_order(InstrumentId instrument, uint64_t order_id);
+
+    /**
+     * remove all resting and waiting stop orders of an owner, of one instrument or of all, as on a disconnect\n
+     * the owner's orders are reached through its intrusive order list, each is unlinked and destructed without
+     * replacing an emptied best Limit; every touched Book then looks up its best prices once, see
+     * TradeDS::BasicBook::withdraw; a stop order leaves the trigger book, see TradeDS::BasicBook::remove_stop\n
+     * journaled as one command, level deltas are published per Book\n
+     * \n
+     * time-complexity O(K + B log B); where K is the number of resting and stop orders of the owner, on all
+     * instruments, and B the number of Books touched
+     *
+     * @param owner
+     * @param instrument optional, instrument id of the only Book to cancel in, 0 for all
+     * @return number of orders cancelled
+     * @return 0 if owner is 0, instrument is invalid or an attached journal is full
+     */
+    size_t mass_cancel(OwnerId owner, InstrumentId instrument = 0);
+
+    /**
+     * remove all resting and waiting stop orders of an owner in the Book of a symbol, see mass_cancel
+     * @return number of orders cancelled, 0 if symbol isn't registered
+     */
+    size_t mass_cancel(OwnerId owner, const string &symbol);
+
+    /**
+     * switch the trading phase of an instrument, as for an opening or closing cross\n
+     * in TradingPhase::AUCTION, LIMIT orders accumulate without matching and may leave the Book crossed, other
+     * order types are rejected and stop orders don't trigger; switching back to CONTINUOUS uncrosses the Book:
+     * every crossed order executes at one equilibrium price, in bulk, see TradeDS::BasicBook::uncross; stop orders
+     * triggered by it are then matched\n
+     * uncross fills are reported as Fill::UNCROSS, the Buy order as aggressor\n
+     * \n
+     * time-complexity O(1) into AUCTION, that of TradeDS::BasicBook::uncross out of it
+     *
+     * @tparam FillSink callable as void(const Fill &)
+     * @param instrument
+     * @param phase
+     * @param on_fill fill sink
+     * @return True on success
+     * @return False if instrument id is invalid, the instrument is in phase already, or an attached journal is full
+     */
+    template<typename FillSink>
+    bool set_phase(InstrumentId instrument, TradingPhase phase, FillSink &&on_fill);
+
+    /**
+     * switch the trading phase of an instrument, see set_phase with a sink
+     * @param fills an vector passed by reference, uncross fills are written in there
+     */
+    bool set_phase(InstrumentId instrument, TradingPhase phase, vector<Fill> &fills);
+
+    /**
+     * get the trading phase of an instrument, CONTINUOUS for an invalid instrument id
+     */
+    TradingPhase get_phase(InstrumentId instrument) const;
+
+    /**
+     * process a burst of order commands in sequence, same semantics as one add_order, amend_order or pull_order
+     * call per command, all keyed by instrument id\n
+     * the order index slots and resting Orders of upcoming commands are prefetched while earlier ones execute,
+     * so a burst pays for its cache misses in parallel rather than one after another\n
+     * \n
+     * time-complexity that of the individual calls
+     *
+     * @param commands first command of the batch
+     * @param count number of commands
+     * @param fills an vector passed by reference, fills of all commands are appended, tagged with the command index
+     * @param accepted optional, array of count results written with what the individual call would have returned
+     * @return number of commands accepted
+     */
+    size_t process_batch(const OrderCommand *commands, size_t count, vector<CommandFill> &fills,
+                         bool *accepted = nullptr);
+
+    /**
+     * process a burst of order commands in sequence, reporting fills to a sink, see process_batch with a vector of
+     * fills and add_order with a sink
+     *
+     * @tparam FillSink callable as void(size_t command_index, const Fill &)
+     * @param commands first command of the batch
+     * @param count number of commands
+     * @param on_fill fill sink, called with the index of the command that caused the fill
+     * @param accepted optional, array of count results written with what the individual call would have returned
+     * @return number of commands accepted
+     */
+    template<typename FillSink>
+    size_t process_batch(const OrderCommand *commands, size_t count, FillSink &&on_fill, bool *accepted = nullptr);
+
+    /**
+     * serialise all books into a compact binary image, see snapshot_format.hpp\n
+     * taken at a consistent point: call it from the thread driving the engine, between two commands\n
+     * time-complexity O(N + L); where N is the number of orders and L the number of non-empty Limits
+     * @param image overwritten with the snapshot
+     */
+    void snapshot(vector<char> &image) const;
+
+    /**
+     * write a snapshot to a file, atomically replacing it via a temporary file
+     * @param path
+     * @return True on success, False on I/O error
+     */
+    bool save_snapshot(const string &path) const;
+
+    /**
+     * take a snapshot now and write it to a file in the background, the engine can be used again right away\n
+     * the returned future blocks on destruction until the file is written
+     * @param path
+     * @return future of the result of save_snapshot
+     */
+    std::future<bool> save_snapshot_async(const string &path) const;
+
+    /**
+     * rebuild all books, and the order index, from a snapshot image\n
+     * levels are bulk-constructed with TradeDS::Book::restore_level, instrument ids are the same as when it was
+     * taken; only an engine without books can be loaded\n
+     * time-complexity O(N + L)
+     * @param image 8-byte aligned snapshot image
+     * @param size bytes of image
+     * @return True on success
+     * @return False if the engine already has books or a journal, or on a malformed image; the engine is left
+     * without books
+     */
+    bool load_snapshot(const char *image, size_t size);
+
+    /**
+     * rebuild all books from a snapshot file, memory-mapped and read in place, see load_snapshot of an image
+     * @param path
+     * @return True on success, False if the file can't be read or see load_snapshot of an image
+     */
+    bool load_snapshot(const string &path);
+
+    /**
+     * get the aggregated depth of up to n levels of one side of a book, see TradeDS::BasicBook::depth
+     * @param instrument
+     * @param side Side of the resting orders, Buy for bids and Sell for asks
+     * @param n maximum number of levels
+     * @param out caller-provided array of at least n levels
+     * @return number of levels written, 0 if instrument id is invalid
+     */
+    size_t get_depth(InstrumentId instrument, Side side, size_t n, DepthLevel *out) const;
+
+    /**
+     * publish the L2 level deltas of a book into a ring, coalesced per add_order, amend_order or pull_order call,
+     * see TradeDS::BasicBook::set_delta_feed; several books may share one ring, deltas are tagged with the
+     * instrument id
+     * @param instrument
+     * @param feed ring drained by one consumer thread, nullptr to stop publishing
+     * @return False if instrument id is invalid
+     */
+    bool set_delta_feed(InstrumentId instrument, TradeDS::SpscRing<LevelDelta> *feed);
+
+    /**
+     * attach a journal; from now on every accepted command, book creation included, is appended to it before the
+     * call returns, and a command is rejected while the journal is full\n
+     * to recover: load_snapshot, open the journal, replay_journal, then set_journal to carry on appending
+     * @param journal an open Journal, nullptr to detach
+     * @return True on success
+     * @return False if the journal isn't open, or doesn't end at get_sequence() and isn't empty
+     */
+    bool set_journal(Journal *journal);
+
+    /**
+     * get the number of state changing commands accepted so far, the sequence of the last one journaled
+     */
+    uint64_t get_sequence() const { return this->sequence; }
+
+    /**
+     * rebuild state by re-executing the journaled commands after get_sequence(), deterministically, fills are
+     * discarded; must not have a journal attached\n
+     * time-complexity that of the individual calls
+     * @param journal
+     * @return True if the engine is now at the last sequence of the journal
+     * @return False if a journal is attached, if the journal starts after get_sequence() + 1, or if a command is
+     * rejected, which means the journal doesn't belong to this state
+     */
+    bool replay_journal(const Journal &journal);
+
     /**
      * get the best offer information from both side, at a given symbol book\n
      * @param symbol
      * @return an BestBidOffer struct with best offer information, if offer doesn't exists, the field will be set to 0
      */
     BestBidOffer get_top_of_book(string const &symbol) const;
+
+    /**
+     * get the best offer information from both side, at a given instrument id book\n
+     * @param instrument
+     * @return an BestBidOffer struct with best offer information, if offer doesn't exists, the field will be set to 0
+     */
+    BestBidOffer get_top_of_book(InstrumentId instrument) const;
 };
 
+template<typename FillSink>
+bool MatchingEngine::add_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t price, int64_t volume,
+                               FillSink &&on_fill, OrderType type, OwnerId owner, StpMode stp, int64_t peak) {
+    StageTimer timer;
+    if (order_id == 0) return false;
+    if (this->order_exists(order_id)) return false;
+    if (price <= 0 && type != OrderType::MARKET) return false;
+    if (volume <= 0) return false;
+    if (peak < 0 || (peak > 0 && type != OrderType::LIMIT)) return false;
+    if (this->journal_full()) return false;
+    timer.lap(Instrumentation::VALIDATE);
+
+    Book *target_book = this->get_book(instrument);
+    if (target_book == nullptr) return false;   // bad instrument
+
+    // API edge: price is converted into ticks once, everything below works in ticks
+    // a market order takes any price, a limit beyond every possible tick
+    const int64_t ticks = (type != OrderType::MARKET) ? target_book->to_ticks(price)
+                                                      : (side == Side::Buy ? INT64_MAX : 0);
+    if (ticks == 0 && type != OrderType::MARKET) return false;   // price in wrong unit
+
+    // pre-checks read Limits only, a rejected order never touches a resting Order
+    if (type == OrderType::POST_ONLY && target_book->crosses(side, ticks)) return false;
+    if (type == OrderType::FOK && target_book->matchable_volume(side, ticks, volume, owner, stp) < (uint64_t) volume) {
+        return false;
+    }
+    const bool auction = target_book->in_auction();
+    if (auction && type != OrderType::LIMIT) return false;  // nothing executes before the uncross
+    timer.lap(Instrumentation::RESOLVE);
+
+    // attempt to exhaust the new order volume, only resting types insert what's left
+    const uint64_t remaining = (type != OrderType::POST_ONLY && !auction)
+                               ? this->match(target_book, side, ticks, volume, order_id, on_fill, owner, stp) : volume;
+    timer.lap(Instrumentation::MATCH);
+    if (remaining > 0 && (type == OrderType::LIMIT || type == OrderType::POST_ONLY)) {
+        Order *new_order;
+        if (peak > 0 && remaining > (uint64_t) peak) {
+            // iceberg, display one peak and keep the rest in reserve
+            new_order = target_book->create_order(order_id, side, ticks, peak, owner, stp);
+            new_order->set_reserve(remaining - peak, peak);
+            target_book->insert(new_order);
+        } else {
+            new_order = target_book->insert(target_book->create_order(order_id, side, ticks, remaining, owner, stp));
+        }
+        this->orders.insert(order_id, new_order);
+        this->link_owner(new_order);
+    }
+    timer.lap(Instrumentation::INSERT);
+
+    this->trigger_stops(target_book, on_fill);
+    timer.lap(Instrumentation::TRIGGER);
+
+    this->commit(JournalRecord::ADD, instrument, side, order_id, price, volume, type, owner, stp, peak);
+    target_book->publish_deltas();
+    timer.lap(Instrumentation::PUBLISH);
+    return true;
+}
+
+template<typename FillSink>
+bool MatchingEngine::amend_order(uint64_t order_id, int64_t new_price, int64_t new_active_volume,
+                                 FillSink &&on_fill) {
+    Order *const target_order = this->orders.find(order_id);
+    if (target_order == nullptr) return false; // no such order
+
+    return this->amend(target_order, new_price, new_active_volume, on_fill);
+}
+
+template<typename FillSink>
+bool MatchingEngine::amend_order(InstrumentId instrument, uint64_t order_id, int64_t new_price,
+                                 int64_t new_active_volume, FillSink &&on_fill) {
+    Order *const target_order = this->orders.find(order_id);
+    if (target_order == nullptr) return false; // no such order
+    if (target_order->book != this->get_book(instrument)) return false;  // order of another instrument
+
+    return this->amend(target_order, new_price, new_active_volume, on_fill);
+}
+
+template<typename FillSink>
+uint64_t MatchingEngine::match(Book *const target_book, const Side side, const int64_t price, const uint64_t volume,
+                               const uint64_t aggressor_id, FillSink &on_fill, const OwnerId owner,
+                               const StpMode stp) {
+    uint64_t remaining = volume;
+    auto on_trade = [&](const Order &resting, uint64_t traded) {
+        remaining -= traded;
+        on_fill(Fill{resting.order_id, target_book->to_price(resting.price), static_cast<int64_t>(traded),
+                     aggressor_id, static_cast<int64_t>(remaining), static_cast<int64_t>(resting.volume), Fill::TRADE,
+                     resting.owner});
+        // resting order is fully filled and about to be destructed
+        if (resting.volume == 0) this->orders.erase(resting.order_id);
+    };
+    auto on_prevented = [&](const Order &resting, uint64_t resting_cancelled, uint64_t aggressor_cancelled) {
+        remaining -= aggressor_cancelled;
+        on_fill(Fill{resting.order_id, target_book->to_price(resting.price), static_cast<int64_t>(resting_cancelled),
+                     aggressor_id, static_cast<int64_t>(remaining), static_cast<int64_t>(resting.volume),
+                     Fill::SELF_TRADE_PREVENTED, resting.owner});
+        if (resting.volume == 0) this->orders.erase(resting.order_id);
+    };
+    return target_book->match(side, price, volume, owner, stp, on_trade, on_prevented);
+}
+
+template<typename FillSink>
+bool MatchingEngine::add_stop_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t stop_price,
+                                    int64_t price, int64_t volume, FillSink &&on_fill, OwnerId owner,
+                                    StpMode stp) {
+    if (order_id == 0) return false;
+    if (this->order_exists(order_id)) return false;
+    if (stop_price <= 0 || price < 0 || volume <= 0) return false;
+    if (this->journal_full()) return false;
+
+    Book *target_book = this->get_book(instrument);
+    if (target_book == nullptr) return false;   // bad instrument
+    const int64_t stop_ticks = target_book->to_ticks(stop_price);
+    const int64_t ticks = (price != 0) ? target_book->to_ticks(price) : 0;
+    if (stop_ticks == 0 || (price != 0 && ticks == 0)) return false;   // price in wrong unit
+
+    Order *const stop = target_book->create_order(order_id, side, ticks, volume, owner, stp);
+    target_book->insert_stop(stop, stop_ticks);
+    this->stops.insert(order_id, stop);
+    this->link_owner(stop);
+
+    this->commit(JournalRecord::ADD_STOP, instrument, side, order_id, price, volume, OrderType::LIMIT, owner, stp, 0,
+                 stop_price);
+
+    this->trigger_stops(target_book, on_fill);
+    target_book->publish_deltas();
+    return true;
+}
+
+template<typename FillSink>
+void MatchingEngine::trigger_stops(Book *const target_book, FillSink &on_fill) {
+    if (target_book->get_stop_count() == 0 || target_book->in_auction()) return;
+
+    for (Order *stop = target_book->next_triggered(); stop != nullptr; stop = target_book->next_triggered()) {
+        this->stops.erase(stop->order_id);
+        // a stop-market order takes any price, as a MARKET order
+        const int64_t ticks = (stop->price != 0) ? stop->price : (stop->side == Side::Buy ? INT64_MAX : 0);
+        const uint64_t remaining = this->match(target_book, stop->side, ticks, stop->volume, stop->order_id, on_fill,
+                                               stop->owner, stop->owner != 0 ? stop->stp : StpMode::NONE);
+        if (remaining > 0 && stop->price != 0) {
+            stop->volume = remaining;
+            target_book->insert(stop);
+            this->orders.insert(stop->order_id, stop);
+        } else {
+            target_book->destroy_order(stop);
+        }
+    }
+}
+
+template<typename FillSink>
+bool MatchingEngine::set_phase(InstrumentId instrument, TradingPhase phase, FillSink &&on_fill) {
+    Book *const target_book = this->get_book(instrument);
+    if (target_book == nullptr) return false;   // bad instrument
+    if (target_book->in_auction() == (phase == TradingPhase::AUCTION)) return false;    // in phase already
+    if (this->journal_full()) return false;
+
+    target_book->set_auction(phase == TradingPhase::AUCTION);
+    if (phase == TradingPhase::CONTINUOUS) {
+        target_book->uncross([&](const Order &buy, const Order &sell, int64_t price, uint64_t traded) {
+            on_fill(Fill{sell.order_id, target_book->to_price(price), static_cast<int64_t>(traded), buy.order_id,
+                         static_cast<int64_t>(buy.volume), static_cast<int64_t>(sell.volume), Fill::UNCROSS,
+                         sell.owner});
+            // fully filled orders are about to be destructed
+            if (buy.volume == 0) this->orders.erase(buy.order_id);
+            if (sell.volume == 0) this->orders.erase(sell.order_id);
+        });
+        this->trigger_stops(target_book, on_fill);
+    }
+
+    this->commit(JournalRecord::SET_PHASE, instrument, Side::Buy, 0, 0, (int64_t) phase);
+    target_book->publish_deltas();
+    return true;
+}
+
+template<typename FillSink>
+size_t MatchingEngine::process_batch(const OrderCommand *commands, size_t count, FillSink &&on_fill,
+                                     bool *accepted) {
+    // two stage prefetch: index slots far ahead, then the resting Orders those slots point at
+    const size_t INDEX_PREFETCH_DISTANCE = 8;
+    const size_t ORDER_PREFETCH_DISTANCE = 4;
+
+    size_t command_index = 0;
+    size_t accepted_count = 0;
+    auto on_command_fill = [&on_fill, &command_index](const Fill &fill) { on_fill(command_index, fill); };
+
+    for (size_t i = 0; i < count && i < INDEX_PREFETCH_DISTANCE; i++) this->orders.prefetch(commands[i].order_id);
+
+    for (; command_index < count; command_index++) {
+        if (command_index + INDEX_PREFETCH_DISTANCE < count) {
+            this->orders.prefetch(commands[command_index + INDEX_PREFETCH_DISTANCE].order_id);
+        }
+        if (command_index + ORDER_PREFETCH_DISTANCE < count) {
+            const OrderCommand &upcoming = commands[command_index + ORDER_PREFETCH_DISTANCE];
+            if (upcoming.type != OrderCommand::ADD) {
+                const Order *upcoming_order = this->orders.find(upcoming.order_id);
+                if (upcoming_order != nullptr) __builtin_prefetch(upcoming_order);
+            }
+        }
+
+        const OrderCommand &command = commands[command_index];
+        bool result = false;
+        switch (command.type) {
+            case OrderCommand::ADD:
+                result = this->add_order(command.order_id, command.instrument, command.side, command.price,
+                                         command.volume, on_command_fill, command.order_type, command.owner,
+                                         command.stp, command.peak);
+                break;
+            case OrderCommand::AMEND:
+                result = this->amend_order(command.instrument, command.order_id, command.price, command.volume,
+                                           on_command_fill);
+                break;
+            case OrderCommand::PULL:
+                result = this->pull_order(command.instrument, command.order_id);
+                break;
+        }
+
+        if (accepted != nullptr) accepted[command_index] = result;
+        if (result) accepted_count++;
+    }
+
+    return accepted_count;
+}
+
+template<typename FillSink>
+bool MatchingEngine::amend(Order *const target_order, int64_t new_price, int64_t new_active_volume,
+                           FillSink &on_fill) {
+    if (new_price <= 0) return false;
+    if (new_active_volume <= 0) return false;
+    if (this->journal_full()) return false;
+
+    auto target_book = static_cast<Book *>(target_order->book);  // all books of the engine are TradeDS::Book
+    const int64_t new_ticks = target_book->to_ticks(new_price);
+    if (new_ticks == 0) return false;   // price in wrong unit
+    const uint64_t target_order_id = target_order->order_id;    // the Order may be destructed below
+
+    // order only lose priority on 1.price change or 2.increase volume;
+    if (target_order->price == new_ticks && target_order->volume >= (uint64_t) new_active_volume) {
+        target_book->amend(target_order, new_ticks, new_active_volume);
+    } else {
+        // else, take the order out and re-evaluate it as a new one, reusing the same Order and index slot
+        target_book->detach(target_order);
+
+        // an iceberg order is re-evaluated with its reserve
+        const uint64_t volume = new_active_volume + (target_order->iceberg ? target_order->hidden : 0);
+        const uint64_t remaining = !target_book->in_auction()
+                                   ? this->match(target_book, target_order->side, new_ticks, volume, target_order_id,
+                                                 on_fill, target_order->owner,
+                                                 target_order->owner != 0 ? target_order->stp : StpMode::NONE)
+                                   : volume;
+        if (remaining > 0) {
+            target_order->price = new_ticks;
+            target_order->volume = remaining;
+            if (target_order->iceberg) {
+                target_order->volume = (remaining < target_order->peak) ? remaining : target_order->peak;
+                target_order->hidden = remaining - target_order->volume;
+            }
+            target_book->insert(target_order);
+        } else {
+            this->orders.erase(target_order_id);
+            target_book->destroy_order(target_order);
+        }
+        this->trigger_stops(target_book, on_fill);
+    }
+
+    this->commit(JournalRecord::AMEND, 0, Side::Buy, target_order_id, new_price, new_active_volume);
+    target_book->publish_deltas();
+    return true;
+}
+
 #endif  // MATCHING_ENGINE_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <new>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace TradeDS {
+/**
+ * A fixed-size object pool handing out T from preallocated slabs\n
+ * Released objects are kept in an intrusive free list threaded through their own storage\n
+ * so acquire and release never touch the global allocator once capacity is reserved\n
+ * \n
+ * Time-Complexity\n
+ * - acquire O(1), worst case O(slab_size) if a new slab needs to be allocated\n
+ * - release O(1)\n
+ * \n
+ * Objects still in use when the pool is destructed are NOT destructed, only their storage is freed
+ *
+ * @tparam T Any type of element to be pooled
+ */
+    template<typename T>
+    class ObjectPool {
+    private:
+        /**
+         * ObjectPool internal storage unit, either a free list link or a live T
+         */
+        union Slot {
+            Slot *next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        const size_t SLAB_SIZE;
+        vector<Slot *> slabs;
+        Slot *free_list = nullptr;
+        size_t in_use_count = 0;
+
+        /**
+         * allocate one more slab and thread all of its slots onto the free list
+         */
+        void grow();
+
+    public:
+        /**
+         * construct an ObjectPool\n
+         * @param capacity optional, number of objects to preallocate
+         * @param slab_size optional, number of objects allocated at once whenever the pool runs dry
+         */
+        explicit ObjectPool(size_t capacity = 0, size_t slab_size = 1024);
+
+        /**
+         * destruct ObjectPool and free all slabs
+         */
+        ~ObjectPool();
+
+        ObjectPool(ObjectPool const &rhs) = delete;
+
+        ObjectPool &operator=(ObjectPool const &rhs) = delete;
+
+        /**
+         * make sure at least capacity objects can be acquired without allocating\n
+         * @param capacity total number of objects the pool should be able to hold
+         */
+        void reserve(size_t capacity);
+
+        /**
+         * construct a T in a free slot\n
+         * @param args arguments forwarded to T's constructor
+         * @return reference to newly constructed T
+         */
+        template<typename... Args>
+        T *acquire(Args &&... args);
+
+        /**
+         * destruct a T and return its slot to the free list\n
+         * @param object reference previously returned by acquire of this pool
+         */
+        void release(T *object);
+
+        /**
+         * get the number of objects the pool can hold without allocating
+         */
+        size_t capacity() const { return this->SLAB_SIZE * this->slabs.size(); }
+
+        /**
+         * get the number of objects currently acquired
+         */
+        size_t in_use() const { return this->in_use_count; }
+    };
+
+
+    template<typename T>
+    ObjectPool<T>::ObjectPool(size_t capacity, size_t slab_size) : SLAB_SIZE{slab_size > 0 ? slab_size : 1} {
+        this->reserve(capacity);
+    }
+
+    template<typename T>
+    ObjectPool<T>::~ObjectPool() {
+        for (auto slab: this->slabs) delete[] slab;
+    }
+
+    template<typename T>
+    void ObjectPool<T>::grow() {
+        auto slab = new Slot[this->SLAB_SIZE];
+        this->slabs.push_back(slab);
+
+        // thread back to front, so slots are handed out in address order
+        for (size_t i = this->SLAB_SIZE; i > 0; i--) {
+            slab[i - 1].next = this->free_list;
+            this->free_list = &slab[i - 1];
+        }
+    }
+
+    template<typename T>
+    void ObjectPool<T>::reserve(size_t capacity) {
+        while (this->capacity() < capacity) this->grow();
+    }
+
+    template<typename T>
+    template<typename... Args>
+    T *ObjectPool<T>::acquire(Args &&... args) {
+        if (this->free_list == nullptr) this->grow();
+
+        Slot *slot = this->free_list;
+        this->free_list = slot->next;
+        this->in_use_count++;
+
+        return new(slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    void ObjectPool<T>::release(T *const object) {
+        object->~T();
+
+        auto slot = reinterpret_cast<Slot *>(object);
+        slot->next = this->free_list;
+        this->free_list = slot;
+        this->in_use_count--;
+    }
+}
+
+#endif  // !OBJECT_POOL_H
@@ -0,0 +1,109 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+using std::vector;
+
+namespace TradeDS {
+    struct Order;
+
+/**
+ * An open-addressing hash index from order_id to TradeDS::Order\n
+ * Slots are stored in one flat power-of-2 sized array and probed linearly, so a lookup is usually one cache line\n
+ * Erasing uses backward-shift deletion, meaning there are no tombstones and probe chains stay short\n
+ * order_id 0 is reserved as the empty slot marker\n
+ * \n
+ * Time-Complexity\n
+ * - find O(1)\n
+ * - insert O(1), worst case O(n) if the slot array needs to grow\n
+ * - erase O(1)\n
+ */
+    class OrderIndex {
+    private:
+        /**
+         * OrderIndex internal storage unit
+         */
+        struct Slot {
+            uint64_t order_id = 0;
+            Order *order = nullptr;
+        };
+
+        vector<Slot> slots;
+        size_t mask = 0;
+        unsigned shift = 64;
+        size_t count = 0;
+
+        /**
+         * get the home slot of an order_id
+         */
+        size_t home(uint64_t order_id) const {
+            // fibonacci hashing, top bits of the product spread sequential ids across the whole array
+            return (size_t) ((order_id * 0x9E3779B97F4A7C15ull) >> this->shift);
+        }
+
+        /**
+         * double slot array and re-insert all elements
+         */
+        void grow();
+
+    public:
+        /**
+         * construct an empty OrderIndex\n
+         * @param capacity optional, number of orders the index should hold without growing
+         */
+        explicit OrderIndex(size_t capacity = 1024);
+
+        /**
+         * make sure at least capacity orders can be indexed without growing\n
+         * @param capacity number of orders
+         */
+        void reserve(size_t capacity);
+
+        /**
+         * find the TradeDS::Order indexed under a given order_id\n
+         * @param order_id
+         * @return reference to TradeDS::Order
+         * @return nullptr if order_id isn't indexed
+         */
+        Order *find(uint64_t order_id) const {
+            for (size_t i = this->home(order_id);; i = (i + 1) & this->mask) {
+                const Slot &slot = this->slots[i];
+                if (slot.order_id == order_id) return slot.order;
+                if (slot.order_id == 0) return nullptr;
+            }
+        }
+
+        /**
+         * hint the home slot of an order_id into cache ahead of a find, insert or erase
+         * @param order_id
+         */
+        void prefetch(uint64_t order_id) const { __builtin_prefetch(&this->slots[this->home(order_id)]); }
+
+        /**
+         * index a TradeDS::Order under a given order_id\n
+         * @param order_id must not be 0
+         * @param order
+         * @return True on success, False if order_id is already indexed
+         */
+        bool insert(uint64_t order_id, Order *order);
+
+        /**
+         * remove an order_id from the index\n
+         * @param order_id
+         * @return reference to the TradeDS::Order that was indexed
+         * @return nullptr if order_id isn't indexed
+         */
+        Order *erase(uint64_t order_id);
+
+        /**
+         * get the number of indexed orders
+         */
+        size_t size() const { return this->count; }
+    };
+}
+
+#endif  // !ORDER_INDEX_H
@@ -0,0 +1,153 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace TradeDS {
+/**
+ * Hardware event counters of the calling thread, through perf_event_open, to explain latencies: instructions,
+ * cycles, branch mispredicts, L1D, last level cache and dTLB misses\n
+ * Every event is its own counter, so a PMU short of counters multiplexes them instead of dropping a group; counts
+ * are scaled by the time each event was actually counting\n
+ * Counting is off until start and only covers user space, the kernel's own share is excluded, which also keeps it
+ * within reach of perf_event_paranoid 2\n
+ * \n
+ * start and stop toggle every counter of the process with one prctl each, ~100ns apiece: bracket what is measured,
+ * not the timestamps around it\n
+ */
+    class PerfCounters {
+    public:
+        enum Event { INSTRUCTIONS, CYCLES, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES, EVENTS };
+
+        static constexpr const char *NAMES[EVENTS] = {"instructions", "cycles", "branch_misses", "l1d_misses",
+                                                      "llc_misses", "dtlb_misses"};
+
+    private:
+        int fds[EVENTS] = {-1, -1, -1, -1, -1, -1};
+        uint64_t baselines[EVENTS][3] = {};     // raw values at the last reset: count, time enabled, time running
+
+        bool read_raw(Event event, uint64_t values[3]) const {
+#if defined(__linux__)
+            return this->fds[event] >= 0 && ::read(this->fds[event], values, 3 * sizeof(uint64_t)) ==
+                                             (ssize_t) (3 * sizeof(uint64_t));
+#else
+            (void) event;
+            (void) values;
+            return false;
+#endif
+        }
+
+#if defined(__linux__)
+        static int open_event(uint32_t type, uint64_t config) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+
+        static constexpr uint64_t cache_miss(uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+#endif
+
+    public:
+        /**
+         * open every event, an event the CPU or the kernel doesn't offer is left out, see available
+         */
+        PerfCounters() {
+#if defined(__linux__)
+            this->fds[INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            this->fds[CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            this->fds[BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+            this->fds[L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+            this->fds[LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+            this->fds[DTLB_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+        }
+
+        ~PerfCounters() {
+#if defined(__linux__)
+            for (int fd: this->fds) {
+                if (fd >= 0) close(fd);
+            }
+#endif
+        }
+
+        PerfCounters(PerfCounters const &rhs) = delete;
+
+        PerfCounters &operator=(PerfCounters const &rhs) = delete;
+
+        /**
+         * check whether an event is counted
+         */
+        bool available(Event event) const { return this->fds[event] >= 0; }
+
+        /**
+         * check whether any event is counted
+         */
+        bool available() const {
+            for (int fd: this->fds) {
+                if (fd >= 0) return true;
+            }
+            return false;
+        }
+
+        /**
+         * start counting, every counter of the process
+         */
+        static void start() {
+#if defined(__linux__)
+            prctl(PR_TASK_PERF_EVENTS_ENABLE);
+#endif
+        }
+
+        /**
+         * stop counting, every counter of the process
+         */
+        static void stop() {
+#if defined(__linux__)
+            prctl(PR_TASK_PERF_EVENTS_DISABLE);
+#endif
+        }
+
+        /**
+         * get the count of an event since the last reset, scaled up if it was multiplexed meanwhile
+         * @param event
+         * @return 0 if the event isn't available or didn't count
+         */
+        double read(Event event) const {
+            uint64_t values[3];
+            if (!this->read_raw(event, values)) return 0;
+            const uint64_t *const baseline = this->baselines[event];
+            const uint64_t running = values[2] - baseline[2];
+            if (running == 0) return 0;
+            return (double) (values[0] - baseline[0]) * ((double) (values[1] - baseline[1]) / (double) running);
+        }
+
+        /**
+         * zero every count, and the times its scaling is based on
+         */
+        void reset() {
+            for (int event = 0; event < EVENTS; event++) {
+                if (!this->read_raw((Event) event, this->baselines[event])) {
+                    this->baselines[event][0] = this->baselines[event][1] = this->baselines[event][2] = 0;
+                }
+            }
+        }
+    };
+}
+
+#endif  // !PERF_COUNTERS_H
@@ -0,0 +1,83 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <type_traits>
+
+namespace TradeDS {
+/**
+ * A single-writer sequence lock publishing a small trivially copyable value to any number of reader threads\n
+ * The writer never waits; readers never write shared memory, they copy the value and retry if a store overlapped\n
+ * The value lives in relaxed atomic words so a torn read is a retry, not a data race\n
+ * Aligned to a cache line of its own so publishing doesn't false-share with the writer's other data\n
+ * \n
+ * Time-Complexity\n
+ * - store O(sizeof(T))\n
+ * - load O(sizeof(T)), retried while a store is in progress\n
+ *
+ * @tparam T trivially copyable type of the published value
+ */
+    template<typename T>
+    class alignas(64) Seqlock {
+        static_assert(std::is_trivially_copyable_v<T>, "Seqlock value must be trivially copyable");
+
+    private:
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        std::atomic<uint64_t> sequence{0};      // odd while a store is in progress
+        std::atomic<uint64_t> words[WORDS] = {};
+
+    public:
+        Seqlock() = default;
+
+        explicit Seqlock(const T &value) { this->store(value); }
+
+        Seqlock(Seqlock const &rhs) = delete;
+
+        Seqlock &operator=(Seqlock const &rhs) = delete;
+
+        /**
+         * publish a new value, writer side
+         * @param value
+         */
+        void store(const T &value) {
+            uint64_t buffer[WORDS] = {};
+            std::memcpy(buffer, &value, sizeof(T));
+
+            const uint64_t curr_sequence = this->sequence.load(std::memory_order_relaxed);
+            this->sequence.store(curr_sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++) this->words[i].store(buffer[i], std::memory_order_relaxed);
+            this->sequence.store(curr_sequence + 2, std::memory_order_release);
+        }
+
+        /**
+         * read a consistent copy of the last published value, any thread
+         */
+        T load() const {
+            uint64_t buffer[WORDS];
+            uint64_t before, after;
+            do {
+                before = this->sequence.load(std::memory_order_acquire);
+                for (size_t i = 0; i < WORDS; i++) buffer[i] = this->words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = this->sequence.load(std::memory_order_relaxed);
+            } while (before != after || (before & 1));
+
+            T value;
+            std::memcpy(&value, buffer, sizeof(T));
+            return value;
+        }
+
+        /**
+         * get the number of stores so far, any thread; a reader polling for changes can compare it to the last one
+         */
+        uint64_t version() const { return this->sequence.load(std::memory_order_acquire) / 2; }
+    };
+}
+
+#endif  // !SEQLOCK_H
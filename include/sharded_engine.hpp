@@ -0,0 +1,225 @@
+#ifndef SHARDED_ENGINE_H
+#define SHARDED_ENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "matching_engine.hpp"
+#include "spsc_ring.hpp"
+#include "types.hpp"
+
+using std::string, std::unique_ptr, std::unordered_map, std::vector, TradeDS::SpscRing;
+
+/**
+ * configuration of a ShardedEngine
+ */
+struct ShardedEngineConfig {
+    size_t shards = 1;                  // number of worker threads, each owning a partition of the symbols
+    size_t producers = 1;               // number of threads submitting commands, each gets its own producer slot
+    size_t queue_capacity = 1 << 16;    // per inbound queue and per shard outbound queue, must be power of 2
+    vector<int> cpus;                   // cpu of shard i is cpus[i]; shards beyond cpus.size() or given -1 float
+};
+
+/**
+ * what a shard reports back: a fill, or an order command it rejected
+ */
+struct ShardEvent {
+    enum Type : uint8_t { FILL, REJECTED };
+
+    Type type = FILL;
+    InstrumentId instrument = 0;
+    uint64_t order_id = 0;      // order_id of the rejected command, aggressor order_id of a fill
+    Fill fill;                  // only valid for FILL
+};
+
+/**
+ * A multi-threaded MatchingEngine: symbols are partitioned across N shards, each shard is a worker thread owning a
+ * MatchingEngine, and with it its Books and order index, exclusively; matching never takes a lock\n
+ * \n
+ * Inbound, every shard has one SpscRing of commands per producer slot, together an MPSC queue without CAS; a producer
+ * slot must only ever be used by one thread at a time\n
+ * Outbound, every shard publishes fills and rejects to its own SpscRing, drained together by one consumer thread
+ * through poll_events; a shard waits for room rather than dropping an event, keep polling; events are ordered per
+ * shard, not across shards, see poll_events\n
+ * \n
+ * Routing is a read-only table, instrument id - shard, built by create_book before start; commands carry their
+ * instrument id so amends and cancels go to the shard of the order without any shared order index\n
+ * order_ids must be unique across the whole engine, uniqueness is only checked within a shard\n
+ */
+class ShardedEngine {
+private:
+    struct Shard {
+        MatchingEngine engine;
+        vector<unique_ptr<SpscRing<OrderCommand>>> inbound;  // one per producer slot
+        SpscRing<ShardEvent> outbound;
+        std::thread worker;
+        int cpu;
+
+        Shard(size_t producers, size_t queue_capacity, int cpu);
+    };
+
+    struct Route {
+        size_t shard;
+        InstrumentId local_instrument;  // instrument id within the shard's MatchingEngine
+    };
+
+    const size_t PRODUCERS;
+    vector<unique_ptr<Shard>> shards;
+    vector<Route> routes{{0, 0}};       // global instrument id - shard, 0 is invalid
+    unordered_map<string, InstrumentId> instrument_ids;
+    std::atomic<bool> running{false};
+    bool started = false;
+
+    /**
+     * worker loop of one shard, until stop is called and all of its inbound queues are empty
+     */
+    void run(Shard &shard);
+
+    /**
+     * hand a command to the inbound queue of its instrument's shard
+     * @return False if producer or instrument is invalid or the queue is full
+     */
+    bool submit(size_t producer, const OrderCommand &command);
+
+public:
+    /**
+     * construct a stopped ShardedEngine without books
+     * @param config
+     */
+    explicit ShardedEngine(const ShardedEngineConfig &config);
+
+    /**
+     * stop the workers and destruct all books
+     */
+    ~ShardedEngine();
+
+    ShardedEngine(ShardedEngine const &rhs) = delete;
+
+    ShardedEngine &operator=(ShardedEngine const &rhs) = delete;
+
+    /**
+     * create the book of a new symbol on the shard chosen by hashing the symbol, before start only
+     * @param symbol
+     * @param unit the API price increment of one tick
+     * @param order_capacity optional, number of Orders to preallocate
+     * @param limit_capacity optional, number of Limits to preallocate
+     * @return the instrument id of the new book
+     * @return 0 if already started, or see MatchingEngine::create_book
+     */
+    InstrumentId create_book(const string &symbol, int64_t unit, size_t order_capacity = 0, size_t limit_capacity = 0);
+
+    /**
+     * create the book of a new symbol on a given shard, before start only, see create_book
+     * @return 0 if shard is out of range, or see create_book
+     */
+    InstrumentId create_book(size_t shard, const string &symbol, int64_t unit, size_t order_capacity = 0,
+                             size_t limit_capacity = 0);
+
+    /**
+     * get the instrument id of a registered symbol
+     * @return instrument id, 0 if symbol isn't registered
+     */
+    InstrumentId get_instrument_id(const string &symbol) const;
+
+    /**
+     * get the shard owning an instrument
+     * @return shard index, shard_count() if instrument id is invalid
+     */
+    size_t get_shard(InstrumentId instrument) const;
+
+    size_t shard_count() const { return this->shards.size(); }
+
+    /**
+     * get the Book of an instrument, only safe to read while stopped
+     * @return the reference of a TradeDS::Book, nullptr if instrument id is invalid
+     */
+    const Book *get_book(InstrumentId instrument) const;
+
+    /**
+     * get the best bid and offer of an instrument, safe to call from any thread while the shards are running\n
+     * reads the seqlock-protected top of book the owning shard publishes, see TradeDS::BasicBook::get_top_of_book
+     * @return an BestBidOffer struct, all fields 0 if instrument id is invalid
+     */
+    BestBidOffer get_top_of_book(InstrumentId instrument) const;
+
+    /**
+     * start one worker thread per shard, pinned as configured
+     */
+    void start();
+
+    /**
+     * let the workers finish every command submitted so far, then join them\n
+     * call once all producers are done submitting; a worker waiting on a full outbound queue only finishes
+     * if the consumer keeps polling meanwhile
+     */
+    void stop();
+
+    /**
+     * queue a new order, see MatchingEngine::add_order; fills and a possible reject arrive through poll_events
+     * @param producer producer slot of the calling thread
+     * @param type optional, see OrderType
+     * @param owner optional, owner of the order, 0 for none
+     * @param stp optional, self-trade prevention, see StpMode
+     * @param peak optional, display volume of an iceberg order, 0 for a fully displayed order
+     * @return True if queued, False if producer or instrument is invalid or the queue is full
+     */
+    bool add_order(size_t producer, uint64_t order_id, InstrumentId instrument, Side side, int64_t price,
+                   int64_t volume, OrderType type = OrderType::LIMIT, OwnerId owner = 0, StpMode stp = StpMode::NONE,
+                   int64_t peak = 0);
+
+    /**
+     * queue an amend of a resting order of an instrument, see MatchingEngine::amend_order
+     * @return True if queued, False if producer or instrument is invalid or the queue is full
+     */
+    bool amend_order(size_t producer, InstrumentId instrument, uint64_t order_id, int64_t new_price,
+                     int64_t new_active_volume);
+
+    /**
+     * queue a cancel of a resting order of an instrument, see MatchingEngine::pull_order
+     * @return True if queued, False if producer or instrument is invalid or the queue is full
+     */
+    bool pull_order(size_t producer, InstrumentId instrument, uint64_t order_id);
+
+    /**
+     * drain the outbound queues of all shards, from the single consumer thread\n
+     * the events of one shard arrive in the order it produced them: commands of one producer slot execute in the
+     * order they were queued, the fills of a command arrive in matching order, and all events of a command before
+     * any of a later one; so the events of one instrument arrive in the order its commands executed\n
+     * there is no order across shards, their events are interleaved one per shard per pass; nor across producer
+     * slots, whose queues a shard drains in turn
+     * @tparam EventHandler callable as void(const ShardEvent &)
+     * @param on_event
+     * @param max_events optional, stop after this many events
+     * @return number of events handled
+     */
+    template<typename EventHandler>
+    size_t poll_events(EventHandler &&on_event, size_t max_events = SIZE_MAX);
+};
+
+template<typename EventHandler>
+size_t ShardedEngine::poll_events(EventHandler &&on_event, size_t max_events) {
+    size_t handled = 0;
+    ShardEvent event;
+    bool progress = true;
+    // round robin, one event per shard per pass, so no shard starves the others
+    while (progress && handled < max_events) {
+        progress = false;
+        for (auto &shard: this->shards) {
+            if (handled == max_events || !shard->outbound.pop(event)) continue;
+            on_event(event);
+            handled++;
+            progress = true;
+        }
+    }
+    return handled;
+}
+
+#endif  // !SHARDED_ENGINE_H
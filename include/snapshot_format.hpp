@@ -0,0 +1,85 @@
+#ifndef SNAPSHOT_FORMAT_H
+#define SNAPSHOT_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+/**
+ * The binary snapshot of a MatchingEngine, written by MatchingEngine::snapshot, read by load_snapshot\n
+ * \n
+ * FileHeader, then for every book in instrument id order:\n
+ * BookHeader, symbol padded to a multiple of 8 bytes, LevelRecord[buy_level_count + sell_level_count],
+ * OrderRecord[order_count] and StopRecord[stop_count]\n
+ * Levels are Buy side first, each side from the touch outward; the orders of a level are contiguous, in priority
+ * order, and follow the orders of the previous level\n
+ * Stop orders waiting for their trigger are Buy side first, each side in trigger order\n
+ * Every record is 8-byte aligned, so an mmap'ed snapshot is read in place; fields are in host byte order; records
+ * have no implicit padding and reserved fields are written as zero, so a state always writes the same image\n
+ */
+namespace Snapshot {
+    constexpr char MAGIC[8] = {'M', 'E', 'S', 'N', 'A', 'P', 'S', 'H'};
+    constexpr uint32_t VERSION = 8;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t book_count;
+        uint64_t order_count;   // over all books
+        uint64_t sequence;      // last journal sequence applied, see MatchingEngine::replay_journal
+    };
+
+    struct BookHeader {
+        int64_t unit;
+        uint64_t order_count;
+        uint32_t buy_level_count;
+        uint32_t sell_level_count;
+        uint32_t symbol_length;
+        uint32_t stop_count;
+        int64_t last_price;     // in ticks, stop orders trigger against it
+        uint32_t phase;         // TradingPhase
+        uint32_t reserved;
+    };
+
+    struct LevelRecord {
+        int64_t price;          // in ticks
+        uint64_t order_count;
+    };
+
+    struct OrderRecord {
+        uint64_t order_id;
+        uint64_t volume;
+        OwnerId owner;
+        StpMode stp;            // NONE without an owner
+        uint8_t reserved[3];    // zero
+        uint64_t hidden;        // reserve of an iceberg order
+        uint64_t peak;          // 0 unless an iceberg order
+    };
+
+    struct StopRecord {
+        uint64_t order_id;
+        uint64_t volume;
+        int64_t stop_price;     // in ticks
+        int64_t price;          // in ticks, 0 for a stop-market order
+        Side side;
+        StpMode stp;            // NONE without an owner
+        uint8_t reserved[2];    // zero
+        OwnerId owner;
+    };
+
+    static_assert(sizeof(FileHeader) == 32 && sizeof(BookHeader) == 48, "snapshot headers must stay 8-byte sized");
+    static_assert(sizeof(LevelRecord) == 16 && sizeof(OrderRecord) == 40 && sizeof(StopRecord) == 40,
+                  "snapshot records must stay 8-byte sized");
+    // no implicit padding anywhere, so the same state always writes the same bytes
+    static_assert(offsetof(BookHeader, reserved) + sizeof(uint32_t) == sizeof(BookHeader) &&
+                  offsetof(OrderRecord, peak) + sizeof(uint64_t) == sizeof(OrderRecord) &&
+                  offsetof(StopRecord, owner) + sizeof(OwnerId) == sizeof(StopRecord), "snapshot records have no padding");
+
+    /**
+     * get the number of bytes a symbol takes in a snapshot, padded to 8
+     */
+    inline size_t padded(size_t length) { return (length + 7) & ~(size_t) 7; }
+}
+
+#endif  // !SNAPSHOT_FORMAT_H
@@ -1,22 +1,26 @@
 #ifndef SPARSE_SET_H
 #define SPARSE_SET_H
 
+#include <cstddef>
 #include <cstdint>
 
-#include <cmath>
 #include <string>
+#include <utility>
 #include <vector>
-#include <iostream>
-#include <cstring>
 
 
-using std::string, std::vector, std::cout, std::endl;
+using std::string, std::vector;
 
 namespace TradeDS {
 /**
  * A SparseSet can hold arbitrary value with self-increasing size\n
  * Internal storage is organised in term of Pages for improved space-complexity\n
- * Page is a static array with customizable size that must be power of 2\n
+ * Page is a static array of a compile-time size that must be power of 2, so indexing is a shift and a mask\n
+ * A Page that becomes empty is taken out of the index, up to max_spare_pages of them are kept aside and handed\n
+ * out again before any new Page is allocated, so a level oscillating around a Page boundary never hits the allocator\n
+ * The index of Pages only grows, geometrically, it never shrinks\n
+ * With a MaxIndex, the index of Pages is sized for [0, MaxIndex] up front: it never grows and accesses skip the\n
+ * out-of-range check, indexes beyond MaxIndex must not be used\n
  * \n
  * Time-Complexity\n
  * - retrieve O(1)\n
@@ -24,9 +28,12 @@ namespace TradeDS {
  * - remove O(1)\n
  *
  * @tparam T Any type of element to be stored
+ * @tparam PageSize optional, number of elements per Page, 4096 by default, must be power of 2
+ * @tparam MaxIndex optional, highest index ever used, 0 for unbounded
  */
-    template<typename T>
+    template<typename T, size_t PageSize = 4096, uint64_t MaxIndex = 0>
     class SparseSet {
+        static_assert(PageSize > 0 && (PageSize & (PageSize - 1)) == 0, "SparseSet page size must be power of 2");
     private:
         /**
          * SparseSet internal storage unit\n
@@ -34,27 +41,42 @@ namespace TradeDS {
          */
         struct Page {
             T *container;
+            size_t count = 0;   // number of non 0-Equivalent elements
 
             explicit Page(size_t size) {
-                container = new T[size];
-                memset(container, 0, size);
+                container = new T[size]();
             };
 
-            ~Page() { delete container; };
+            ~Page() { delete[] container; };
         };
 
-        const uint64_t PAGE_IDX_SHIFTER;
-        // const uint64_t PAGE_IDX_MASK;
-        const size_t PAGE_SIZE;
+        static constexpr size_t PAGE_SIZE = PageSize;
+        static constexpr uint64_t PAGE_IDX_SHIFTER = __builtin_ctzll(PageSize);
+        static constexpr uint64_t INPAGE_IDX_MASK = PageSize - 1;
+        static constexpr bool BOUNDED = MaxIndex > 0;
+        static constexpr size_t BOUNDED_PAGE_COUNT = BOUNDED ? (MaxIndex >> PAGE_IDX_SHIFTER) + 1 : 0;
+
+        const size_t MAX_SPARE_PAGES;
         vector<Page *> pages;
+        vector<Page *> spare_pages;     // empty Pages kept for reuse
+
+        /**
+         * get the Page of a given page index, resizing the index and creating the Page if needed
+         */
+        Page *acquire_page(size_t page_idx);
+
+        /**
+         * take an empty Page out of the index, keeping it as spare or freeing it
+         */
+        void reclaim_page(size_t page_idx);
 
     public:
         /**
          * construct a empty SparseSet\n
          * @param size the size of initial SparseSet
-         * @param page_size optional, 4096 by default, must be power of 2
+         * @param max_spare_pages optional, number of empty Pages kept for reuse instead of being freed
          */
-        explicit SparseSet(size_t size, size_t page_size = 4096);
+        explicit SparseSet(size_t size, size_t max_spare_pages = 4);
 
         /**
          * destruct SparseSet and free all Page\n
@@ -72,12 +94,38 @@ namespace TradeDS {
         T insert(uint64_t index, T element);
 
         /**
-         * Remove an element at a given index and free inactive Page if necessary
-         * \todo Implement element removing and inactive Page freeing behaviour
+         * Remove an element at a given index and reclaim its Page if it becomes empty\n
+         * the reclaimed Page is kept as spare, or freed if there are already enough spare Pages
          * @param index position to remove element at
          * @return element removed
+         * @return 0-Equivalent value if there is no element at index
+         */
+        T remove(uint64_t index);
+
+        /**
+         * Construct an element in place at a given empty index, for elements updated through their address\n
+         * If necessary, SparseSet will resize and create new corresponding page\n
+         * @param index target position in SparseSet
+         * @param args arguments forwarded to T's constructor
+         * @return address of the element, stable until it is erased
+         */
+        template<typename... Args>
+        T *emplace(uint64_t index, Args &&... args);
+
+        /**
+         * get the address of the element at a given index\n
+         * @param index position of desired element
+         * @return address of the element, 0-Equivalent if nothing was emplaced there
+         * @return nullptr if index has no Page
          */
-        __attribute__((unused)) T remove(uint64_t index);
+        T *find(uint64_t index) const;
+
+        /**
+         * Reset an element previously emplaced at a given index and reclaim its Page if it becomes empty\n
+         * see remove
+         * @param index position of an emplaced element
+         */
+        void erase(uint64_t index);
 
         /**
          * return the size of SparseSet (Not the count of element inserted)\n
@@ -93,72 +141,158 @@ namespace TradeDS {
          * @return 0-Equivalent value on on uninitialised value
          * @return 0-Equivalent value on out-of-bound access
          */
-        T operator[](uint64_t);
+        T operator[](uint64_t) const;
 
         // tester
         __attribute__((unused)) vector<Page *> getPages() { return this->pages; }
     };
 
 
-    template<typename T>
-    SparseSet<T>::SparseSet(size_t size, size_t page_size)
-            : PAGE_SIZE{page_size}, PAGE_IDX_SHIFTER{static_cast<uint64_t>(log2(page_size))} {
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    SparseSet<T, PageSize, MaxIndex>::SparseSet(size_t size, size_t max_spare_pages)
+            : MAX_SPARE_PAGES{max_spare_pages} {
         // create at least 1 SparseSet Page
-        const uint64_t page_count = (size / page_size) + 1;
+        const uint64_t page_count = (size / PAGE_SIZE) + 1;
         for (size_t i = 0; i < page_count; i++) {
-            this->pages.push_back(new Page(page_size));
+            this->pages.push_back(new Page(PAGE_SIZE));
         }
+        // a bounded index covers every Page up front, Pages themselves are still created on demand
+        if (this->pages.size() < BOUNDED_PAGE_COUNT) this->pages.resize(BOUNDED_PAGE_COUNT);
     }
 
-    template<typename T>
-    SparseSet<T>::~SparseSet() {
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    SparseSet<T, PageSize, MaxIndex>::~SparseSet() {
         // remove all existing pages
         for (auto page: pages) delete page;
+        for (auto page: spare_pages) delete page;
     }
 
-    template<typename T>
-    T SparseSet<T>::insert(uint64_t index, T element) {
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    T SparseSet<T, PageSize, MaxIndex>::insert(uint64_t index, T element) {
         // essentially (index / page_size) but faster
         const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
-        const size_t INPAGE_IDX = index % this->PAGE_SIZE;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
+
+        // insert
+        Page *const page = this->acquire_page(PAGE_IDX);
+        const bool was_empty = page->container[INPAGE_IDX] == T{};
+        const bool is_empty = element == T{};
+        page->container[INPAGE_IDX] = element;
+        if (was_empty && !is_empty) page->count++;
+        if (!was_empty && is_empty) page->count--;
 
-        //const size_t INPAGE_IDX = index & this->PAGE_IDX_MASK;    // todo: using bit-mask
+        return element;
+    }
 
-        // expand page space if needed
-        if (PAGE_IDX >= this->pages.size()) {
-            this->pages.resize(PAGE_IDX * 2);
-            cout << "Resized SparseSet Pages to " << this->pages.size() << endl;
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    T SparseSet<T, PageSize, MaxIndex>::operator[](uint64_t index) const {
+        // essentially (index / page_size) but faster
+        const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
+
+        if constexpr (!BOUNDED) {
+            if (PAGE_IDX >= this->pages.size()) return 0;
         }
+        if (this->pages[PAGE_IDX] == nullptr) return 0;
 
-        // create page if needed
-        if (this->pages[PAGE_IDX] == nullptr) {
-            cout << "Creating New Page\n";
-            this->pages[PAGE_IDX] = new Page(this->PAGE_SIZE);
+        return this->pages[PAGE_IDX]->container[INPAGE_IDX];
+    }
+
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    T SparseSet<T, PageSize, MaxIndex>::remove(uint64_t index) {
+        const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
+
+        if constexpr (!BOUNDED) {
+            if (PAGE_IDX >= this->pages.size()) return T{};
         }
+        Page *const page = this->pages[PAGE_IDX];
+        if (page == nullptr) return T{};
 
-        // insert
-        this->pages[PAGE_IDX]->container[INPAGE_IDX] = element;
+        const T element = page->container[INPAGE_IDX];
+        if (element == T{}) return element;
+
+        page->container[INPAGE_IDX] = T{};
+        page->count--;
+        if (page->count == 0) this->reclaim_page(PAGE_IDX);
 
         return element;
     }
 
-    template<typename T>
-    T SparseSet<T>::operator[](uint64_t index) {
-        // essentially (index / page_size) but faster
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    template<typename... Args>
+    T *SparseSet<T, PageSize, MaxIndex>::emplace(uint64_t index, Args &&... args) {
         const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
-        const size_t INPAGE_IDX = index % this->PAGE_SIZE;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
 
-        //const size_t INPAGE_IDX = index & this->PAGE_IDX_MASK;    // todo: using bit-mask
+        Page *const page = this->acquire_page(PAGE_IDX);
+        page->container[INPAGE_IDX] = T(std::forward<Args>(args)...);
+        page->count++;
 
-        if (PAGE_IDX >= this->pages.size()) return 0;
-        if (this->pages[PAGE_IDX] == nullptr) return 0;
+        return &page->container[INPAGE_IDX];
+    }
 
-        return this->pages[PAGE_IDX]->container[INPAGE_IDX];
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    T *SparseSet<T, PageSize, MaxIndex>::find(uint64_t index) const {
+        const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
+
+        if constexpr (!BOUNDED) {
+            if (PAGE_IDX >= this->pages.size()) return nullptr;
+        }
+        if (this->pages[PAGE_IDX] == nullptr) return nullptr;
+
+        return &this->pages[PAGE_IDX]->container[INPAGE_IDX];
     }
 
-    template<typename T>
-    __attribute__((unused)) T SparseSet<T>::remove(uint64_t index) {
-        return nullptr;
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    void SparseSet<T, PageSize, MaxIndex>::erase(uint64_t index) {
+        const size_t PAGE_IDX = index >> this->PAGE_IDX_SHIFTER;
+        const size_t INPAGE_IDX = index & this->INPAGE_IDX_MASK;
+
+        if constexpr (!BOUNDED) {
+            if (PAGE_IDX >= this->pages.size()) return;
+        }
+        Page *const page = this->pages[PAGE_IDX];
+        if (page == nullptr) return;
+
+        page->container[INPAGE_IDX] = T{};
+        page->count--;
+        if (page->count == 0) this->reclaim_page(PAGE_IDX);
+    }
+
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    typename SparseSet<T, PageSize, MaxIndex>::Page *SparseSet<T, PageSize, MaxIndex>::acquire_page(size_t page_idx) {
+        // expand page space if needed, at least doubling so growth stays amortised
+        if constexpr (!BOUNDED) {
+            if (page_idx >= this->pages.size()) {
+                this->pages.resize(page_idx + 1 > this->pages.size() * 2 ? page_idx + 1 : this->pages.size() * 2);
+            }
+        }
+
+        // create page if needed, spare pages first
+        if (this->pages[page_idx] == nullptr) {
+            if (!this->spare_pages.empty()) {
+                this->pages[page_idx] = this->spare_pages.back();
+                this->spare_pages.pop_back();
+            } else {
+                this->pages[page_idx] = new Page(this->PAGE_SIZE);
+            }
+        }
+
+        return this->pages[page_idx];
+    }
+
+    template<typename T, size_t PageSize, uint64_t MaxIndex>
+    void SparseSet<T, PageSize, MaxIndex>::reclaim_page(size_t page_idx) {
+        // every element is already 0-Equivalent so the page can be reused as is
+        Page *const page = this->pages[page_idx];
+        this->pages[page_idx] = nullptr;
+        if (this->spare_pages.size() < this->MAX_SPARE_PAGES) {
+            this->spare_pages.push_back(page);
+        } else {
+            delete page;
+        }
     }
 }
 
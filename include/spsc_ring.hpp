@@ -0,0 +1,102 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+using std::vector;
+
+namespace TradeDS {
+/**
+ * A fixed-capacity, preallocated, lock-free single-producer single-consumer ring buffer\n
+ * One thread may push while another pops, neither ever blocks nor allocates\n
+ * head and tail live on separate cache lines so producer and consumer don't false-share\n
+ * \n
+ * A SpscRing can be used directly as a MatchingEngine fill sink; fills that don't fit are counted as dropped,
+ * size the ring for the largest burst or drain it concurrently\n
+ * \n
+ * Time-Complexity\n
+ * - push O(1)\n
+ * - pop O(1)\n
+ *
+ * @tparam T Any copyable type of element
+ */
+    template<typename T>
+    class SpscRing {
+    private:
+        const size_t MASK;
+        vector<T> buffer;
+
+        alignas(64) std::atomic<size_t> head{0};   // next slot to pop, written by consumer
+        alignas(64) std::atomic<size_t> tail{0};   // next slot to push, written by producer
+        size_t dropped_count = 0;                  // written by producer
+
+    public:
+        /**
+         * construct an empty SpscRing
+         * @param capacity must be power of 2
+         */
+        explicit SpscRing(size_t capacity) : MASK{capacity - 1}, buffer(capacity) {};
+
+        SpscRing(SpscRing const &rhs) = delete;
+
+        SpscRing &operator=(SpscRing const &rhs) = delete;
+
+        /**
+         * append an element, producer side
+         * @param value
+         * @return True on success, False if ring is full
+         */
+        bool push(const T &value) {
+            const size_t curr_tail = this->tail.load(std::memory_order_relaxed);
+            if (curr_tail - this->head.load(std::memory_order_acquire) > this->MASK) return false;
+
+            this->buffer[curr_tail & this->MASK] = value;
+            this->tail.store(curr_tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * take the oldest element, consumer side
+         * @param value written with the element on success
+         * @return True on success, False if ring is empty
+         */
+        bool pop(T &value) {
+            const size_t curr_head = this->head.load(std::memory_order_relaxed);
+            if (curr_head == this->tail.load(std::memory_order_acquire)) return false;
+
+            value = this->buffer[curr_head & this->MASK];
+            this->head.store(curr_head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * push as a sink, counting the element as dropped if ring is full
+         * @param value
+         */
+        void operator()(const T &value) {
+            if (!this->push(value)) this->dropped_count++;
+        }
+
+        /**
+         * get the number of elements currently in ring, exact only when called from producer or consumer thread
+         */
+        size_t size() const {
+            return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+        }
+
+        bool empty() const { return this->size() == 0; }
+
+        size_t capacity() const { return this->MASK + 1; }
+
+        /**
+         * get the number of elements rejected by operator() because ring was full, producer side
+         */
+        size_t dropped() const { return this->dropped_count; }
+    };
+}
+
+#endif  // !SPSC_RING_H
@@ -0,0 +1,63 @@
+#ifndef TICK_POLICY_H
+#define TICK_POLICY_H
+
+#include <cstdint>
+
+namespace TradeDS {
+/**
+ * Tick policy of a TradeDS::BasicBook: how API prices convert into ticks, and which ticks may exist\n
+ * Every tick policy provides the same interface:\n
+ * - FIXED: whether the tick size is a compile-time constant\n
+ * - MAX_TICK: highest tick a Book of this policy can hold, 0 for unbounded; level storages size themselves by it\n
+ * - unit(requested): the tick size of a new Book, given the one requested at construction\n
+ * - to_ticks(price, unit): price in ticks, 0 if price is not a valid price of the Book\n
+ * - to_price(ticks, unit): API price of a tick\n
+ */
+
+/**
+ * Tick size chosen per Book at runtime, any positive price is valid
+ */
+    struct RuntimeTick {
+        static constexpr bool FIXED = false;
+        static constexpr uint64_t MAX_TICK = 0;
+
+        static constexpr int64_t unit(int64_t requested) { return requested; }
+
+        static int64_t to_ticks(int64_t price, int64_t unit) {
+            if (price <= 0 || price % unit != 0) return 0;
+            return price / unit;
+        }
+
+        static int64_t to_price(int64_t ticks, int64_t unit) { return ticks * unit; }
+    };
+
+/**
+ * Tick size and price band known at compile time, for listed instruments configured up front\n
+ * The division by the tick size is by a constant, a shift for a power of 2, and prices outside the band are\n
+ * rejected at the API edge, so level storage can be sized for the band once and never range-check\n
+ *
+ * @tparam Unit API price increment of one tick, the unit a Book requests at construction is ignored
+ * @tparam MinPrice lowest valid price, in API unit, multiple of Unit
+ * @tparam MaxPrice highest valid price, in API unit, multiple of Unit
+ */
+    template<int64_t Unit, int64_t MinPrice, int64_t MaxPrice>
+    struct FixedTick {
+        static_assert(Unit > 0, "tick size must be positive");
+        static_assert(MinPrice > 0 && MinPrice <= MaxPrice, "price band must be positive and not empty");
+        static_assert(MinPrice % Unit == 0 && MaxPrice % Unit == 0, "price band must be on the tick grid");
+
+        static constexpr bool FIXED = true;
+        static constexpr uint64_t MAX_TICK = MaxPrice / Unit;
+
+        static constexpr int64_t unit(int64_t) { return Unit; }
+
+        static int64_t to_ticks(int64_t price, int64_t) {
+            if (price < MinPrice || price > MaxPrice || price % Unit != 0) return 0;
+            return price / Unit;
+        }
+
+        static int64_t to_price(int64_t ticks, int64_t) { return ticks * Unit; }
+    };
+}
+
+#endif  // !TICK_POLICY_H
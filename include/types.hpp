@@ -1,14 +1,123 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <cstddef>
 #include <cstdint>
 
-enum class Side { Buy, Sell };
+enum class Side : uint8_t { Buy, Sell };
 
+/**
+ * how an incoming order executes against the book, see MatchingEngine::add_order
+ */
+enum class OrderType : uint8_t {
+    LIMIT,          // match up to its price, rest the remainder
+    IOC,            // immediate or cancel: match up to its price, drop the remainder
+    FOK,            // fill or kill: match up to its price only if the whole volume fills at once
+    MARKET,         // match at any price, drop the remainder
+    POST_ONLY,      // rest without matching, rejected if it would cross
+};
+
+/**
+ * dense integer id of an instrument, handed out by MatchingEngine::create_book\n
+ * 0 is never a valid instrument id
+ */
+using InstrumentId = uint32_t;
+
+/**
+ * integer id of the participant owning an order, used by self-trade prevention\n
+ * 0 is no owner, an order without owner never self-trades
+ */
+using OwnerId = uint32_t;
+
+/**
+ * self-trade prevention: what happens when an incoming order meets a resting order of the same owner,
+ * see MatchingEngine::add_order
+ */
+enum class StpMode : uint8_t {
+    NONE,               // trade as with any other owner
+    CANCEL_RESTING,     // cancel the resting order, keep matching
+    CANCEL_AGGRESSOR,   // cancel what is left of the incoming order, stop matching
+    DECREMENT_BOTH,     // cancel the smaller of both volumes off both orders, keep matching what is left
+};
+
+/**
+ * how the orders of an instrument execute, see MatchingEngine::set_phase
+ */
+enum class TradingPhase : uint8_t {
+    CONTINUOUS,     // every incoming order matches on arrival
+    AUCTION,        // orders accumulate without matching, until an uncross executes them all at one price
+};
+
+/**
+ * one trade between an incoming (aggressor) order and a resting (other) order\n
+ * or, as SELF_TRADE_PREVENTED, volume cancelled instead of traded because both orders have the same owner;
+ * trade_volume is then the volume cancelled off the resting order\n
+ * or, as UNCROSS, one trade of an auction uncross at the equilibrium price, between a Buy order, as aggressor,
+ * and a Sell order, as other
+ */
 struct Fill {
+    enum Type : uint8_t { TRADE, SELF_TRADE_PREVENTED, UNCROSS };
+
     uint64_t other_order_id = 0;
     int64_t trade_price = 0;
     int64_t trade_volume = 0;
+
+    uint64_t aggressor_order_id = 0;
+    int64_t aggressor_remaining_volume = 0;     // aggressor volume still unmatched after this fill
+    int64_t other_remaining_volume = 0;         // resting volume left after this fill, 0 once fully filled
+    Type type = TRADE;
+    OwnerId other_owner = 0;                    // owner of the resting (other) order, 0 for none
+};
+
+/**
+ * one order message of a batch, see MatchingEngine::process_batch
+ */
+struct OrderCommand {
+    enum Type : uint8_t { ADD, AMEND, PULL };
+
+    Type type = ADD;
+    OrderType order_type = OrderType::LIMIT;    // ADD only
+    Side side = Side::Buy;          // ADD only
+    InstrumentId instrument = 0;
+    uint64_t order_id = 0;
+    int64_t price = 0;              // ADD and AMEND, in API unit
+    int64_t volume = 0;             // ADD and AMEND
+    OwnerId owner = 0;              // ADD only
+    StpMode stp = StpMode::NONE;    // ADD only
+    int64_t peak = 0;               // ADD only, display volume of an iceberg order, 0 for a fully displayed order
+};
+
+/**
+ * a Fill tagged with the index of the batch command that caused it
+ */
+struct CommandFill {
+    size_t command_index = 0;
+    Fill fill;
+};
+
+/**
+ * one aggregated price level, see TradeDS::BasicBook::depth
+ */
+struct DepthLevel {
+    int64_t price = 0;              // in API unit
+    int64_t volume = 0;
+    uint64_t order_count = 0;
+};
+
+/**
+ * one change of an aggregated price level, see TradeDS::BasicBook::set_delta_feed\n
+ * the deltas of one incoming message are coalesced, a level appears at most once per message
+ */
+struct LevelDelta {
+    enum Type : uint8_t { ADDED, CHANGED, REMOVED };
+
+    InstrumentId instrument = 0;
+    Side side = Side::Buy;          // Side of the resting orders, Buy for bids and Sell for asks
+    int64_t price = 0;              // in API unit
+    int64_t volume = 0;             // aggregate volume after the message, 0 if REMOVED
+    uint32_t order_count = 0;       // after the message, 0 if REMOVED
+    Type type = ADDED;
+    bool end_of_message = false;    // last delta of its message, the book is consistent after applying it
 };
 
 struct BestBidOffer {
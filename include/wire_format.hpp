@@ -0,0 +1,87 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+/**
+ * The binary order entry protocol of a Gateway, one TCP stream of back to back messages each way\n
+ * \n
+ * Every message starts with a MessageHeader whose length covers the whole message; lengths are multiples of 8
+ * and every field is naturally aligned, so a message is read in place in the receive buffer, no decoding copy\n
+ * All fields are little-endian, prices are in API units, not ticks; instruments are instrument ids as handed out
+ * by MatchingEngine::create_book\n
+ * Client to gateway: NewOrderMessage, AmendMessage, CancelMessage; a longer message than its type is read up to
+ * its own fields, a message of an unknown type is skipped by its length; a NewOrderMessage without peak, as sent
+ * before it was added, is read with a peak of 0\n
+ * Gateway to client: ExecutionReport, one per fill of an order of the session, then one per command, in command
+ * order, accepting or rejecting it; the fills of a command come before its status report\n
+ */
+namespace Wire {
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the wire format is read in place, little-endian only");
+
+    enum MessageType : char {
+        NEW_ORDER = 'N',        // add_order
+        AMEND = 'M',            // amend_order of an order of the session
+        CANCEL = 'X',           // pull_order of an order of the session
+        EXECUTION_REPORT = 'E', // gateway to client
+    };
+
+    constexpr size_t MAX_MESSAGE_SIZE = 1024;   // longer messages are a protocol error, the session is closed
+
+    struct MessageHeader {
+        uint16_t length;            // bytes of the whole message, header included, a multiple of 8
+        MessageType type;
+        uint8_t reserved;
+        InstrumentId instrument;
+    };
+
+    struct NewOrderMessage {
+        MessageHeader header;
+        uint64_t order_id;          // unique over all sessions
+        int64_t price;              // ignored for a MARKET order
+        int64_t volume;
+        Side side;
+        OrderType order_type;
+        StpMode stp;                // against the session's own resting orders
+        uint8_t reserved[5];
+        int64_t peak;               // LIMIT only, display volume of an iceberg order, 0 for a fully displayed order
+    };
+
+    struct AmendMessage {
+        MessageHeader header;
+        uint64_t order_id;
+        int64_t price;
+        int64_t volume;
+    };
+
+    struct CancelMessage {
+        MessageHeader header;
+        uint64_t order_id;
+    };
+
+    struct ExecutionReport {
+        enum Type : uint8_t {
+            ACCEPTED,               // the command was executed
+            REJECTED,               // the command was not executed, see the return values of MatchingEngine
+            FILL,                   // a trade of an order of the session
+            CANCELLED,              // volume of a resting order of the session cancelled by self-trade prevention
+        };
+
+        MessageHeader header;       // instrument of the order
+        uint64_t order_id;
+        int64_t price;              // trade price of a FILL, price of the command otherwise
+        int64_t volume;             // traded volume of a FILL, cancelled volume of a CANCELLED, command volume
+        int64_t remaining_volume;   // volume of the order left after a FILL or CANCELLED, 0 otherwise
+        Type report;
+        MessageType command;        // type of the command of an ACCEPTED or REJECTED, 0 otherwise
+        uint8_t reserved[6];
+    };
+
+    static_assert(sizeof(MessageHeader) == 8 && sizeof(NewOrderMessage) == 48 && sizeof(AmendMessage) == 32 &&
+                  sizeof(CancelMessage) == 16 && sizeof(ExecutionReport) == 48, "the wire layout is fixed");
+}
+
+#endif  // !WIRE_FORMAT_H
@@ -2,40 +2,35 @@
 
 #include "matching_engine.hpp"
 
+// a small walk through the engine API, latency benchmarks live in bench/
 int main() {
-    // prep
-    auto matching_engine = new MatchingEngine();
-    auto fills = std::vector<Fill>();
-    auto symbol = std::string("webb");
-    matching_engine->add_order(1, symbol, Side::Buy, 1, 1, fills);
-
-    double total_time = 0;
-    for (int i = 2; i < 10002; ++i) {
-        // operation starts
-        clock_t start_time = clock();
-
-        matching_engine->add_order(2, symbol, Side::Buy, 1, 1, fills);
-
-        // end work here
-        double elapsed_time = (double) (clock() - start_time) / CLOCKS_PER_SEC * 1000;
-        total_time += elapsed_time;
+    MatchingEngine matching_engine;
+    vector<Fill> fills;
+
+    const InstrumentId webb = matching_engine.create_book("webb", 1);
+
+    // rest a few orders on both sides
+    matching_engine.add_order(1, webb, Side::Buy, 99, 10, fills);
+    matching_engine.add_order(2, webb, Side::Buy, 98, 20, fills);
+    matching_engine.add_order(3, webb, Side::Sell, 101, 10, fills);
+    matching_engine.add_order(4, webb, Side::Sell, 102, 30, fills);
+    std::cout << *matching_engine.get_book(webb) << std::endl;
+
+    // an aggressive buy takes out the best offer and part of the next one
+    matching_engine.add_order(5, webb, Side::Buy, 102, 15, fills);
+    for (const auto &fill: fills) {
+        std::cout << "fill " << fill.aggressor_order_id << " x " << fill.other_order_id
+                  << " " << fill.trade_volume << " @ " << fill.trade_price << std::endl;
     }
-    printf("Inserting done in %f ms\n", total_time / 10000);
 
-    total_time = 0;
-    for (int i = 10003; i < 20003; ++i) {
-        // operation starts
-        clock_t start_time = clock();
-
-        matching_engine->add_order(i, symbol, Side::Sell, 1, 1, fills);
-
-        // end work here
-        double elapsed_time = (double) (clock() - start_time) / CLOCKS_PER_SEC * 1000;
-        total_time += elapsed_time;
-    }
-
-    printf("Matched in %f ms\n", total_time / 10000);
+    // amend, then pull, what's left
+    fills.clear();
+    matching_engine.amend_order(4, 102, 5, fills);
+    matching_engine.pull_order(2);
 
+    const BestBidOffer top = matching_engine.get_top_of_book(webb);
+    std::cout << "top of book " << top.bid_volume << " @ " << top.bid_price << " / "
+              << top.ask_volume << " @ " << top.ask_price << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
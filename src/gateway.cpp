@@ -0,0 +1,397 @@
+#include "gateway.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+    const int MAX_EVENTS = 64;
+
+    GatewayConfig sanitise(GatewayConfig config) {
+        config.receive_buffer = (std::max(config.receive_buffer, Wire::MAX_MESSAGE_SIZE) + 7) & ~(size_t) 7;
+        config.batch_capacity = std::max(config.batch_capacity, (size_t) 1);
+        return config;
+    }
+
+    Wire::MessageType message_type(OrderCommand::Type type) {
+        switch (type) {
+            case OrderCommand::ADD:
+                return Wire::NEW_ORDER;
+            case OrderCommand::AMEND:
+                return Wire::AMEND;
+            default:
+                return Wire::CANCEL;
+        }
+    }
+}
+
+char *Gateway::SendBuffer::claim(size_t bytes) {
+    if (this->size + bytes > this->capacity) {
+        const size_t grown = std::max({this->capacity * 2, this->size + bytes, (size_t) 4096});
+        unique_ptr<uint64_t[]> grown_words(new uint64_t[grown / sizeof(uint64_t)]);
+        if (this->size > 0) std::memcpy(grown_words.get(), this->words.get(), this->size);
+        this->words = std::move(grown_words);
+        this->capacity = grown;
+    }
+    char *const slot = reinterpret_cast<char *>(this->words.get()) + this->size;
+    this->size += bytes;
+    return slot;
+}
+
+void Gateway::SendBuffer::compact() {
+    if (this->sent == this->size) {
+        this->size = this->sent = 0;
+        return;
+    }
+    // move from the start of the partly sent word, what follows stays 8-byte aligned
+    const size_t start = this->sent & ~(size_t) 7;
+    if (start == 0) return;
+    char *const bytes = reinterpret_cast<char *>(this->words.get());
+    std::memmove(bytes, bytes + start, this->size - start);
+    this->size -= start;
+    this->sent -= start;
+}
+
+Gateway::Session::Session(int fd, OwnerId owner, size_t receive_buffer)
+        : fd{fd}, owner{owner}, receive{new uint64_t[receive_buffer / sizeof(uint64_t)]} {}
+
+Gateway::Gateway(MatchingEngine &engine, GatewayConfig config)
+        : engine{engine}, config{sanitise(std::move(config))}, accepted{new bool[this->config.batch_capacity]} {
+    this->batch.reserve(this->config.batch_capacity);
+    this->batch_sessions.reserve(this->config.batch_capacity);
+}
+
+Gateway::~Gateway() {
+    this->close();
+}
+
+bool Gateway::open() {
+    if (this->listener >= 0) return false;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(this->config.port);
+    if (inet_pton(AF_INET, this->config.address.c_str(), &address.sin_addr) != 1) return false;
+
+    const int socket_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) return false;
+    const int one = 1;
+    socklen_t length = sizeof(address);
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(socket_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(socket_fd, SOMAXCONN) != 0 ||
+        getsockname(socket_fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        ::close(socket_fd);
+        return false;
+    }
+
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;     // the listener, sessions are slot + 1
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_fd, &event) != 0) {
+        if (epoll_fd >= 0) ::close(epoll_fd);
+        ::close(socket_fd);
+        return false;
+    }
+
+    this->listener = socket_fd;
+    this->epoll = epoll_fd;
+    this->port = ntohs(address.sin_port);
+    return true;
+}
+
+void Gateway::close() {
+    for (uint32_t slot = 0; slot < this->sessions.size(); slot++) {
+        if (this->sessions[slot] != nullptr) this->close_session(slot);
+    }
+    this->flushing.clear();
+    this->closing.clear();
+    if (this->epoll >= 0) ::close(this->epoll);
+    if (this->listener >= 0) ::close(this->listener);
+    this->epoll = this->listener = -1;
+    this->port = 0;
+}
+
+size_t Gateway::poll(int timeout_ms) {
+    if (this->epoll < 0) return 0;
+    this->executed = 0;
+
+    epoll_event events[MAX_EVENTS];
+    const int ready = epoll_wait(this->epoll, events, MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < ready; i++) {
+        if (events[i].data.u64 == 0) {
+            this->accept_sessions();
+            continue;
+        }
+        const auto slot = (uint32_t) (events[i].data.u64 - 1);
+        Session *const session = this->sessions[slot].get();
+        if (session == nullptr || session->closing) continue;
+
+        if (events[i].events & EPOLLOUT) {
+            // the socket drained, stop watching it and send the rest with this round
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = slot + 1;
+            epoll_ctl(this->epoll, EPOLL_CTL_MOD, session->fd, &event);
+            session->writable = true;
+            if (!session->queued) {
+                session->queued = true;
+                this->flushing.push_back(slot);
+            }
+        }
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) this->receive(slot);
+    }
+
+    this->execute();
+    this->flush();
+    for (uint32_t slot: this->closing) {
+        if (this->sessions[slot] != nullptr) this->close_session(slot);
+    }
+    this->closing.clear();
+    return this->executed;
+}
+
+void Gateway::run() {
+    this->running.store(true, std::memory_order_release);
+    while (this->running.load(std::memory_order_acquire)) this->poll(100);
+}
+
+void Gateway::accept_sessions() {
+    for (;;) {
+        const int fd = accept4(this->listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;     // EAGAIN, none left
+        }
+
+        uint32_t slot = 0;
+        while (slot < this->sessions.size() && this->sessions[slot] != nullptr) slot++;
+        if (slot == this->config.max_sessions) {
+            ::close(fd);    // full
+            continue;
+        }
+        if (slot == this->sessions.size()) this->sessions.emplace_back();
+
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = slot + 1;
+        if (epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        this->sessions[slot] = std::make_unique<Session>(fd, (OwnerId) (slot + 1), this->config.receive_buffer);
+        this->session_count++;
+    }
+}
+
+void Gateway::receive(uint32_t slot) {
+    Session &session = *this->sessions[slot];
+    char *const buffer = reinterpret_cast<char *>(session.receive.get());
+    const ssize_t bytes = read(session.fd, buffer + session.received, this->config.receive_buffer - session.received);
+    if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (bytes <= 0) {
+        // closed by the client, or broken
+        session.closing = true;
+        this->closing.push_back(slot);
+        return;
+    }
+    session.received += bytes;
+
+    // whole messages, in place; a message always starts 8-byte aligned
+    size_t offset = 0;
+    while (session.received - offset >= sizeof(Wire::MessageHeader)) {
+        const auto &header = *reinterpret_cast<const Wire::MessageHeader *>(buffer + offset);
+        const bool framed = header.length >= sizeof(header) && header.length % 8 == 0 &&
+                            header.length <= Wire::MAX_MESSAGE_SIZE;
+        if (framed && session.received - offset < header.length) break;    // partial, the rest is on the way
+        if (!framed || !this->decode(slot, header)) {
+            session.closing = true;
+            this->closing.push_back(slot);
+            return;
+        }
+        offset += header.length;
+    }
+    std::memmove(buffer, buffer + offset, session.received - offset);
+    session.received -= offset;
+}
+
+bool Gateway::decode(uint32_t slot, const Wire::MessageHeader &header) {
+    OrderCommand command;
+    command.instrument = header.instrument;
+
+    switch (header.type) {
+        case Wire::NEW_ORDER: {
+            if (header.length < offsetof(Wire::NewOrderMessage, peak)) return false;
+            const auto &message = reinterpret_cast<const Wire::NewOrderMessage &>(header);
+            // enums out of range never reach the engine, an order_id already taken is rejected by it
+            if ((uint8_t) message.side > (uint8_t) Side::Sell ||
+                (uint8_t) message.order_type > (uint8_t) OrderType::POST_ONLY ||
+                (uint8_t) message.stp > (uint8_t) StpMode::DECREMENT_BOTH) {
+                this->report(slot, Wire::ExecutionReport::REJECTED, Wire::NEW_ORDER, header.instrument,
+                             message.order_id, message.price, message.volume, 0);
+                return true;
+            }
+            command.type = OrderCommand::ADD;
+            command.order_type = message.order_type;
+            command.side = message.side;
+            command.order_id = message.order_id;
+            command.price = message.price;
+            command.volume = message.volume;
+            command.owner = this->sessions[slot]->owner;
+            command.stp = message.stp;
+            command.peak = (header.length >= sizeof(Wire::NewOrderMessage)) ? message.peak : 0;
+            break;
+        }
+        case Wire::AMEND: {
+            if (header.length < sizeof(Wire::AmendMessage)) return false;
+            const auto &message = reinterpret_cast<const Wire::AmendMessage &>(header);
+            if (!this->owns(slot, message.order_id)) {
+                this->report(slot, Wire::ExecutionReport::REJECTED, Wire::AMEND, header.instrument, message.order_id,
+                             message.price, message.volume, 0);
+                return true;
+            }
+            command.type = OrderCommand::AMEND;
+            command.order_id = message.order_id;
+            command.price = message.price;
+            command.volume = message.volume;
+            break;
+        }
+        case Wire::CANCEL: {
+            if (header.length < sizeof(Wire::CancelMessage)) return false;
+            const auto &message = reinterpret_cast<const Wire::CancelMessage &>(header);
+            if (!this->owns(slot, message.order_id)) {
+                this->report(slot, Wire::ExecutionReport::REJECTED, Wire::CANCEL, header.instrument, message.order_id,
+                             0, 0, 0);
+                return true;
+            }
+            command.type = OrderCommand::PULL;
+            command.order_id = message.order_id;
+            break;
+        }
+        default:
+            return true;    // unknown type, skipped
+    }
+
+    this->batch.push_back(command);
+    this->batch_sessions.push_back(slot);
+    if (this->batch.size() == this->config.batch_capacity) this->execute();
+    return true;
+}
+
+bool Gateway::owns(uint32_t slot, uint64_t order_id) {
+    const OwnerId owner = this->sessions[slot]->owner;
+    const Order *order = this->engine.get_order(order_id);
+    if ((order == nullptr || order->owner != owner) && !this->batch.empty()) {
+        // may be added, or taken out, by a command of the batch still pending
+        this->execute();
+        order = this->engine.get_order(order_id);
+    }
+    return order != nullptr && order->owner == owner;
+}
+
+void Gateway::execute() {
+    if (this->batch.empty()) return;
+
+    // both sides of a trade are reported from inside the matching loop, each only if a session's: the aggressor by
+    // the command it came in with, stop orders it triggered aren't, the resting side by the owner the engine tracks
+    auto on_fill = [this](size_t command_index, const Fill &fill) {
+        const OrderCommand &command = this->batch[command_index];
+        const bool prevented = (fill.type == Fill::SELF_TRADE_PREVENTED);
+        if (!prevented && fill.aggressor_order_id == command.order_id) {
+            this->report(this->batch_sessions[command_index], Wire::ExecutionReport::FILL, (Wire::MessageType) 0,
+                         command.instrument, fill.aggressor_order_id, fill.trade_price, fill.trade_volume,
+                         fill.aggressor_remaining_volume);
+        }
+        if (fill.other_owner == 0 || fill.other_owner > this->sessions.size() ||
+            this->sessions[fill.other_owner - 1] == nullptr) {
+            return;
+        }
+        this->report(fill.other_owner - 1, prevented ? Wire::ExecutionReport::CANCELLED : Wire::ExecutionReport::FILL,
+                     (Wire::MessageType) 0, command.instrument, fill.other_order_id, fill.trade_price,
+                     fill.trade_volume, fill.other_remaining_volume);
+    };
+    const size_t count = this->batch.size();
+    this->engine.process_batch(this->batch.data(), count, on_fill, this->accepted.get());
+    this->executed += count;
+
+    for (size_t i = 0; i < count; i++) {
+        const OrderCommand &command = this->batch[i];
+        this->report(this->batch_sessions[i], this->accepted[i] ? Wire::ExecutionReport::ACCEPTED
+                                                                : Wire::ExecutionReport::REJECTED,
+                     message_type(command.type), command.instrument, command.order_id, command.price, command.volume,
+                     0);
+    }
+    this->batch.clear();
+    this->batch_sessions.clear();
+}
+
+void Gateway::report(uint32_t slot, Wire::ExecutionReport::Type type, Wire::MessageType command,
+                     InstrumentId instrument, uint64_t order_id, int64_t price, int64_t volume,
+                     int64_t remaining_volume) {
+    Session &session = *this->sessions[slot];
+    // encoded in place, the send buffer is the only copy
+    new(session.send.claim(sizeof(Wire::ExecutionReport))) Wire::ExecutionReport{
+            {sizeof(Wire::ExecutionReport), Wire::EXECUTION_REPORT, 0, instrument}, order_id, price, volume,
+            remaining_volume, type, command, {}};
+    if (!session.queued) {
+        session.queued = true;
+        this->flushing.push_back(slot);
+    }
+}
+
+void Gateway::flush() {
+    for (uint32_t slot: this->flushing) {
+        Session *const session = this->sessions[slot].get();
+        if (session == nullptr || !session->queued) continue;
+        session->queued = false;
+        if (session->closing || !session->writable) continue;
+
+        SendBuffer &send = session->send;
+        const char *const bytes = reinterpret_cast<const char *>(send.words.get());
+        while (send.pending() > 0) {
+            const ssize_t written = ::send(session->fd, bytes + send.sent, send.pending(), MSG_NOSIGNAL);
+            if (written > 0) {
+                send.sent += written;
+            } else if (written < 0 && errno == EINTR) {
+                continue;
+            } else if (written < 0 && errno == EAGAIN) {
+                // socket full, wait until it drains
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLOUT;
+                event.data.u64 = slot + 1;
+                epoll_ctl(this->epoll, EPOLL_CTL_MOD, session->fd, &event);
+                session->writable = false;
+                break;
+            } else {
+                session->closing = true;
+                break;
+            }
+        }
+        send.compact();
+        if (send.pending() > this->config.max_pending) session->closing = true;     // too slow a consumer
+        if (session->closing) this->closing.push_back(slot);
+    }
+    this->flushing.clear();
+}
+
+void Gateway::close_session(uint32_t slot) {
+    Session &session = *this->sessions[slot];
+    this->engine.mass_cancel(session.owner);
+    epoll_ctl(this->epoll, EPOLL_CTL_DEL, session.fd, nullptr);
+    ::close(session.fd);
+    this->sessions[slot].reset();
+    this->session_count--;
+}
@@ -0,0 +1,80 @@
+#include "instrumentation.hpp"
+
+#include <cstdio>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using TradeDS::Instrumentation;
+
+namespace {
+    /**
+     * Histograms of every thread that recorded a sample, never freed: a scrape after a thread exited still sees it
+     */
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Instrumentation::Histograms>> threads;
+    };
+
+    Registry &registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    void append_line(std::string &out, const char *name, const TradeDS::LatencyHistogram &histogram, double scale) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-18s %12llu %10.1f %10.1f %10.1f %10.1f %12.1f\n", name,
+                      (unsigned long long) histogram.count(), histogram.mean() * scale,
+                      (double) histogram.percentile(0.50) * scale, (double) histogram.percentile(0.99) * scale,
+                      (double) histogram.percentile(0.999) * scale, (double) histogram.max() * scale);
+        out += line;
+    }
+}
+
+Instrumentation::Histograms *Instrumentation::register_thread() {
+    Registry &target = registry();
+    std::lock_guard<std::mutex> lock(target.mutex);
+    target.threads.emplace_back(new Histograms());
+    return target.threads.back().get();
+}
+
+size_t Instrumentation::scrape(Histograms &total) {
+    Registry &target = registry();
+    std::lock_guard<std::mutex> lock(target.mutex);
+    for (const auto &histograms: target.threads) {
+        for (size_t i = 0; i < STAGE_COUNT; i++) total.stages[i].merge(histograms->stages[i]);
+        for (size_t i = 0; i < COUNTER_COUNT; i++) total.counters[i].merge(histograms->counters[i]);
+    }
+    return target.threads.size();
+}
+
+std::string Instrumentation::dump() {
+    std::unique_ptr<Histograms> total(new Histograms());    // ~100KB, kept off the stack
+    const size_t threads = scrape(*total);
+
+    char header[160];
+    std::snprintf(header, sizeof(header), "%zu thread(s)\n%-18s %12s %10s %10s %10s %10s %12s\n", threads, "stage",
+                  "count", "mean_ns", "p50_ns", "p99_ns", "p99.9_ns", "max_ns");
+    std::string out = header;
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        append_line(out, name((Stage) i), total->stages[i], CycleClock::ns_per_tick());
+    }
+
+    std::snprintf(header, sizeof(header), "%-18s %12s %10s %10s %10s %10s %12s\n", "counter", "count", "mean", "p50",
+                  "p99", "p99.9", "max");
+    out += header;
+    for (size_t i = 0; i < COUNTER_COUNT; i++) append_line(out, name((Counter) i), total->counters[i], 1.0);
+    return out;
+}
+
+const char *Instrumentation::name(Stage stage) {
+    static const char *const NAMES[STAGE_COUNT] = {"validate", "resolve", "match", "insert", "trigger", "publish",
+                                                   "best_price"};
+    return stage < STAGE_COUNT ? NAMES[stage] : "unknown";
+}
+
+const char *Instrumentation::name(Counter counter) {
+    static const char *const NAMES[COUNTER_COUNT] = {"levels_per_match", "orders_per_match"};
+    return counter < COUNTER_COUNT ? NAMES[counter] : "unknown";
+}
@@ -0,0 +1,116 @@
+#include "journal.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+    const size_t PAGE_SIZE = (size_t) sysconf(_SC_PAGESIZE);
+}
+
+Journal::~Journal() {
+    this->close();
+}
+
+bool Journal::open(const string &path, size_t capacity, std::chrono::microseconds flush_interval) {
+    if (this->is_open()) return false;
+
+    const int file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0) return false;
+    struct stat info{};
+    if (fstat(file, &info) != 0 || info.st_size % sizeof(JournalRecord) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    // preallocate the blocks too, a flush must never wait on the file system growing the file
+    const size_t file_capacity = std::max(capacity, (size_t) info.st_size / sizeof(JournalRecord));
+    const size_t bytes = file_capacity * sizeof(JournalRecord);
+    if (bytes == 0 || posix_fallocate(file, 0, (off_t) bytes) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    // prefault every page, appending must never take a page fault on the matching thread
+    void *const mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(file);
+        return false;
+    }
+
+    this->fd = file;
+    this->records = static_cast<JournalRecord *>(mapping);
+    this->capacity = file_capacity;
+
+    // recover the tail: the last of the consecutive records from the start
+    size_t tail = 0;
+    if (this->records[0].sequence != 0) {
+        for (tail = 1; tail < this->capacity; tail++) {
+            if (this->records[tail].sequence != this->records[tail - 1].sequence + 1) break;
+        }
+    }
+    // erase whatever a crash left behind it, or a later append could line up with a stale record
+    bool erased = false;
+    for (size_t i = tail; i < this->capacity; i++) {
+        if (this->records[i].sequence == 0) continue;
+        this->records[i] = JournalRecord{};
+        erased = true;
+    }
+    if (erased) msync(this->records, bytes, MS_SYNC);
+
+    this->count = tail;
+    this->written.store(tail, std::memory_order_relaxed);
+    this->durable.store(this->last_sequence(), std::memory_order_relaxed);
+    this->flush_interval = flush_interval;
+    this->running.store(true, std::memory_order_release);
+    this->flusher = std::thread([this, tail] { this->run(tail); });
+    return true;
+}
+
+void Journal::close() {
+    if (!this->is_open()) return;
+    this->running.store(false, std::memory_order_release);
+    if (this->flusher.joinable()) this->flusher.join();
+
+    munmap(this->records, this->capacity * sizeof(JournalRecord));
+    ::close(this->fd);
+    this->fd = -1;
+    this->records = nullptr;
+    this->capacity = 0;
+    this->count = 0;
+    this->written.store(0, std::memory_order_relaxed);
+    this->durable.store(0, std::memory_order_relaxed);
+}
+
+void Journal::run(size_t flushed) {
+    for (;;) {
+        // read the flag before the records, so everything appended before close is still flushed
+        const bool stopping = !this->running.load(std::memory_order_acquire);
+
+        const size_t appended = this->written.load(std::memory_order_acquire);
+        if (appended > flushed && this->flush(flushed, appended)) {
+            flushed = appended;
+        } else if (stopping) {
+            return;
+        } else {
+            std::this_thread::sleep_for(this->flush_interval);
+        }
+    }
+}
+
+bool Journal::flush(size_t from, size_t to) {
+    // one msync for the whole group, from the page holding the first unflushed record
+    const uintptr_t first = reinterpret_cast<uintptr_t>(&this->records[from]) & ~(uintptr_t) (PAGE_SIZE - 1);
+    const uintptr_t last = reinterpret_cast<uintptr_t>(&this->records[to]);
+    if (msync(reinterpret_cast<void *>(first), last - first, MS_SYNC) != 0) return false;   // retried next round
+
+    this->durable.store(this->records[to - 1].sequence, std::memory_order_release);
+    return true;
+}
+
+void Journal::wait_durable(uint64_t sequence) const {
+    while (this->durable.load(std::memory_order_acquire) < sequence) std::this_thread::yield();
+}
@@ -0,0 +1,89 @@
+#include "level_bitmap.hpp"
+
+using TradeDS::LevelBitmap;
+
+LevelBitmap::LevelBitmap(size_t size) {
+    this->levels.emplace_back((size + 63) / 64 > 0 ? (size + 63) / 64 : 1, 0);
+    this->grow(0);
+}
+
+void LevelBitmap::grow(uint64_t index) {
+    // double leaf level until index fits
+    size_t leaf_words = this->levels[0].size();
+    while (leaf_words <= (index >> 6)) leaf_words *= 2;
+    this->levels[0].resize(leaf_words, 0);
+    this->levels.resize(1);
+
+    // rebuild upper levels, until the top level is a single word
+    while (this->levels.back().size() > 1) {
+        const vector<uint64_t> &lower = this->levels.back();
+        vector<uint64_t> upper((lower.size() + 63) / 64, 0);
+        for (size_t i = 0; i < lower.size(); i++) {
+            if (lower[i] != 0) upper[i >> 6] |= (1ull << (i & 63));
+        }
+        this->levels.push_back(std::move(upper));
+    }
+}
+
+int64_t LevelBitmap::find_next(uint64_t index) const {
+    const size_t level_count = this->levels.size();
+
+    // ascend until a word with a set bit at or after index is found
+    size_t level = 0;
+    while (true) {
+        const vector<uint64_t> &words = this->levels[level];
+        const uint64_t word_idx = index >> 6;
+        if (word_idx >= words.size()) return NONE;
+
+        const uint64_t masked = words[word_idx] & (~0ull << (index & 63));
+        if (masked != 0) {
+            index = (word_idx << 6) | __builtin_ctzll(masked);
+            break;
+        }
+
+        // nothing left in this word, continue from the next word one level up
+        level++;
+        if (level == level_count) return NONE;
+        index = word_idx + 1;
+    }
+
+    // descend to the lowest set bit of each level
+    while (level > 0) {
+        level--;
+        index = (index << 6) | __builtin_ctzll(this->levels[level][index]);
+    }
+
+    return (int64_t) index;
+}
+
+int64_t LevelBitmap::find_prev(uint64_t index) const {
+    const size_t level_count = this->levels.size();
+    if (index >= this->size()) index = this->size() - 1;
+
+    // ascend until a word with a set bit at or before index is found
+    size_t level = 0;
+    while (true) {
+        const vector<uint64_t> &words = this->levels[level];
+        const uint64_t word_idx = index >> 6;
+        const unsigned bit = index & 63;
+
+        const uint64_t masked = words[word_idx] & ((bit == 63) ? ~0ull : ((1ull << (bit + 1)) - 1));
+        if (masked != 0) {
+            index = (word_idx << 6) | (63 - __builtin_clzll(masked));
+            break;
+        }
+
+        // nothing left in this word, continue from the previous word one level up
+        level++;
+        if (level == level_count || word_idx == 0) return NONE;
+        index = word_idx - 1;
+    }
+
+    // descend to the highest set bit of each level
+    while (level > 0) {
+        level--;
+        index = (index << 6) | (63 - __builtin_clzll(this->levels[level][index]));
+    }
+
+    return (int64_t) index;
+}
@@ -0,0 +1,123 @@
+#include "level_storage.hpp"
+
+using TradeDS::WindowLevels, TradeDS::Limit, TradeDS::LevelBitmap;
+
+WindowLevels::WindowLevels(Side side, size_t window_size)
+        : side{side}, WINDOW_SIZE{(int64_t) window_size}, WINDOW_MASK{(int64_t) window_size - 1},
+          window(window_size, nullptr), occupied{window_size} {}
+
+void WindowLevels::place(int64_t price, Limit *limit) {
+    // an empty window can simply jump to wherever the first Limit is
+    if (this->window_count == 0 && !this->in_window(price)) this->recentre(price);
+
+    if (this->in_window(price)) {
+        this->window[price & this->WINDOW_MASK] = limit;
+        this->occupied.set(price & this->WINDOW_MASK);
+        this->window_count++;
+    } else {
+        this->overflow[price] = limit;
+    }
+}
+
+void WindowLevels::remove(int64_t price) {
+    Limit *limit;
+    if (this->in_window(price)) {
+        limit = this->window[price & this->WINDOW_MASK];
+        if (limit == nullptr) return;
+        this->window[price & this->WINDOW_MASK] = nullptr;
+        this->occupied.clear(price & this->WINDOW_MASK);
+        this->window_count--;
+    } else {
+        auto it = this->overflow.find(price);
+        if (it == this->overflow.end()) return;
+        limit = it->second;
+        this->overflow.erase(it);
+    }
+    this->limit_pool.release(limit);
+}
+
+int64_t WindowLevels::find_in_window(int64_t low, int64_t high, bool ascending) const {
+    if (low < this->base) low = this->base;
+    if (high > this->base + this->WINDOW_SIZE - 1) high = this->base + this->WINDOW_SIZE - 1;
+    if (low > high || this->window_count == 0) return LevelBitmap::NONE;
+
+    // [low, high] is at most one window long, so in slot space it wraps at most once
+    const int64_t low_slot = low & this->WINDOW_MASK;
+    const int64_t high_slot = high & this->WINDOW_MASK;
+    int64_t slot;
+    if (low_slot <= high_slot) {
+        slot = ascending ? this->occupied.find_next(low_slot) : this->occupied.find_prev(high_slot);
+        if (slot != LevelBitmap::NONE && (slot < low_slot || slot > high_slot)) slot = LevelBitmap::NONE;
+    } else if (ascending) {
+        slot = this->occupied.find_next(low_slot);
+        if (slot == LevelBitmap::NONE) {
+            slot = this->occupied.find_next(0);
+            if (slot != LevelBitmap::NONE && slot > high_slot) slot = LevelBitmap::NONE;
+        }
+    } else {
+        slot = this->occupied.find_prev(high_slot);
+        if (slot == LevelBitmap::NONE) {
+            slot = this->occupied.find_prev(this->WINDOW_SIZE - 1);
+            if (slot != LevelBitmap::NONE && slot < low_slot) slot = LevelBitmap::NONE;
+        }
+    }
+    if (slot == LevelBitmap::NONE) return LevelBitmap::NONE;
+
+    return low + ((slot - low_slot) & this->WINDOW_MASK);
+}
+
+Limit *WindowLevels::next(int64_t price) const {
+    if (this->side == Side::Buy) {
+        // highest price below, either in window or in overflow
+        int64_t candidate = this->find_in_window(this->base, price - 1, false);
+        auto it = this->overflow.lower_bound(price);
+        if (it != this->overflow.begin()) {
+            --it;
+            if (candidate == LevelBitmap::NONE || it->first > candidate) return it->second;
+        }
+        return candidate == LevelBitmap::NONE ? nullptr : this->window[candidate & this->WINDOW_MASK];
+    } else {
+        // lowest price above, either in window or in overflow
+        int64_t candidate = this->find_in_window(price + 1, this->base + this->WINDOW_SIZE - 1, true);
+        auto it = this->overflow.upper_bound(price);
+        if (it != this->overflow.end()) {
+            if (candidate == LevelBitmap::NONE || it->first < candidate) return it->second;
+        }
+        return candidate == LevelBitmap::NONE ? nullptr : this->window[candidate & this->WINDOW_MASK];
+    }
+}
+
+void WindowLevels::recentre(int64_t touch) {
+    const int64_t MARGIN = this->WINDOW_SIZE / 8;
+    if (touch >= this->base + MARGIN && touch < this->base + this->WINDOW_SIZE - MARGIN) return;
+
+    // keep a quarter of the window on the improving side of the touch, the rest behind it
+    int64_t new_base = (this->side == Side::Buy) ? touch - 3 * (this->WINDOW_SIZE / 4) : touch - this->WINDOW_SIZE / 4;
+    if (new_base < 0) new_base = 0;
+    if (new_base == this->base) return;
+    const int64_t new_end = new_base + this->WINDOW_SIZE;
+
+    // 1. move Limits falling out of the new window into overflow
+    for (int64_t slot = this->window_count > 0 ? this->occupied.find_next(0) : LevelBitmap::NONE;
+         slot != LevelBitmap::NONE; slot = this->occupied.find_next(slot + 1)) {
+        const int64_t price = this->base + ((slot - this->base) & this->WINDOW_MASK);
+        if (price >= new_base && price < new_end) continue;     // same slot in both windows
+
+        this->overflow[price] = this->window[slot];
+        this->window[slot] = nullptr;
+        this->occupied.clear(slot);
+        this->window_count--;
+    }
+
+    // 2. move overflow Limits covered by the new window into it
+    auto it = this->overflow.lower_bound(new_base);
+    while (it != this->overflow.end() && it->first < new_end) {
+        const int64_t slot = it->first & this->WINDOW_MASK;
+        this->window[slot] = it->second;
+        this->occupied.set(slot);
+        this->window_count++;
+        it = this->overflow.erase(it);
+    }
+
+    this->base = new_base;
+}
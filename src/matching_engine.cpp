@@ -1,139 +1,526 @@
 #include "matching_engine.hpp"
 
-using TradeDS::Order;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using TradeDS::Limit, TradeDS::OwnerLink;
+
+namespace {
+    /**
+     * append the bytes of a record to a snapshot image
+     */
+    template<typename Record>
+    void append(vector<char> &image, const Record &record) {
+        const char *bytes = reinterpret_cast<const char *>(&record);
+        image.insert(image.end(), bytes, bytes + sizeof(Record));
+    }
+
+    bool write_image(const string &path, const vector<char> &image) {
+        const string temporary_path = path + ".tmp";
+        {
+            std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+            out.write(image.data(), (std::streamsize) image.size());
+            if (!out.flush()) return false;
+        }
+        return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+    }
+}
 
 [[maybe_unused]] MatchingEngine::MatchingEngine(const vector<Book *> books) {
     // initialisation indexing
     for (auto const book: books) {
-        // symbol - Book
-        this->books[book->symbol] = book;
+        // symbol - instrument id - Book
+        this->instrument_ids[book->symbol] = (InstrumentId) this->books.size();
+        this->books.push_back(book);
 
-        // order_id - Book
-        auto orders = book->get_orders();
-        for (auto it: orders) {
-            this->order_book_map[it.second->order_id] = book;
+        // order_id - Order, walking the levels in place
+        this->orders.reserve(this->orders.size() + book->get_order_count());
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            for (const Limit *limit = book->get_best_limit(side); limit != nullptr;
+                 limit = book->get_next_limit(side, limit->price)) {
+                for (Order *order = limit->front_order; order != nullptr; order = order->next) {
+                    this->orders.insert(order->order_id, order);
+                    this->link_owner(order);
+                }
+            }
         }
     }
 }
 
+MatchingEngine::~MatchingEngine() {
+    for (auto book: this->books) delete book;
+}
+
+void MatchingEngine::clear() {
+    for (auto book: this->books) delete book;
+    this->books.assign(1, nullptr);
+    this->instrument_ids.clear();
+    this->orders = OrderIndex();
+    this->stops = OrderIndex();
+    this->owners.clear();   // the orders are gone with their books
+    this->sequence = 0;
+}
+
+InstrumentId MatchingEngine::create_book(const string &symbol, int64_t unit, size_t order_capacity,
+                                         size_t limit_capacity) {
+    if (symbol.empty()) return 0;
+    if (unit <= 0) return 0;
+    if (this->instrument_ids.find(symbol) != this->instrument_ids.end()) return 0;  // symbol exists
+    if (this->journal != nullptr && (symbol.size() > JournalRecord::MAX_SYMBOL_LENGTH || this->journal->full())) {
+        return 0;
+    }
+
+    const auto instrument = (InstrumentId) this->books.size();
+    this->books.push_back(new Book(symbol, unit, order_capacity, limit_capacity));
+    this->instrument_ids[symbol] = instrument;
+    this->orders.reserve(this->orders.size() + order_capacity);
+
+    if (this->journal != nullptr) {
+        JournalRecord record{};
+        record.sequence = this->sequence + 1;
+        record.instrument = instrument;
+        record.order_id = order_capacity;
+        record.price = unit;
+        record.volume = (int64_t) limit_capacity;
+        record.type = JournalRecord::CREATE_BOOK;
+        record.symbol_length = (uint8_t) symbol.size();
+        std::memcpy(record.symbol, symbol.data(), symbol.size());
+        this->journal->append(record);
+    }
+    this->sequence++;
+    return instrument;
+}
+
+InstrumentId MatchingEngine::get_instrument_id(const string &symbol) const {
+    auto it = this->instrument_ids.find(symbol);
+    return it != this->instrument_ids.end() ? it->second : 0;
+}
 
 bool MatchingEngine::add_order(uint64_t order_id, const string &symbol, Side side, int64_t price, int64_t volume,
-                               vector<Fill> &fills) {
-    if (order_id == 0) return false;
-    if (this->order_book_map.find(order_id) != this->order_book_map.end()) return false; // order exists
+                               vector<Fill> &fills, OrderType type, OwnerId owner, StpMode stp, int64_t peak) {
     if (symbol.empty()) return false;
-    if (price <= 0) return false;
-    if (volume <= 0) return false;
 
-    if (this->books.find(symbol) == this->books.end()) {
+    InstrumentId instrument = this->get_instrument_id(symbol);
+    if (instrument == 0) {
         /**
-         * book doesn't exist: creat book and insert order right away
+         * book doesn't exist: creat book, the order will rest right away
          */
-        auto new_book = new Book(symbol, 1);    // unit is hard-coded here for now
-        this->books[symbol] = new_book;
-        new_book->insert(new Order(order_id, side, (double) price, volume));
-        this->order_book_map[order_id] = new_book;
-        return true;
-    } else {
-        /**
-        * Book exists, attempt to exhaust the new order volume and insert what's left
-        */
-        Book *target_book = this->books[symbol];
-        while (volume > 0) {
-            const Order best_match_copy = target_book->get_order_by_id(target_book->get_best_offer_id(side));
-            if (best_match_copy.order_id == 0) break;   // no counter orders exists
-
-            bool buySatisfy = (side == Side::Buy) && (best_match_copy.price <= (double) price);
-            bool sellSatisfy = (side == Side::Sell) && (best_match_copy.price >= (double) price);
-
-            if (buySatisfy || sellSatisfy) {
-                const uint64_t best_id = best_match_copy.order_id;
-                const auto best_price = (uint64_t) best_match_copy.price;
-                uint64_t best_volume = best_match_copy.volume;
-
-                if (best_match_copy.volume > volume) {
-                    // fulfill with single counter order
-                    target_book->amend(best_id, (double) best_price, best_volume - volume);
-                    fills.push_back(Fill{best_id, static_cast<int64_t>(best_price), volume});
-                    volume = 0;
-                } else {
-                    // multiple orders needed to fulfill
-                    volume -= (int64_t) best_volume;
-                    target_book->remove(best_id);
-                    fills.push_back(Fill{best_id, static_cast<int64_t>(best_price), static_cast<int64_t>(best_volume)});
-                }
-            } else break;
-        }
-
-        if (volume > 0) {
-            // best offer can not satisfy, insert new_order into book and quit
-            target_book->insert(new Order(order_id, side, (double) price, volume));
-            this->order_book_map[order_id] = target_book;
-        }
+        if (order_id == 0 || this->order_exists(order_id)) return false;
+        if ((price <= 0 && type != OrderType::MARKET) || volume <= 0) return false;
+        instrument = this->create_book(symbol, 1);    // unit defaults to 1, use create_book to specify
     }
 
-    return true;
+    return this->add_order(order_id, instrument, side, price, volume, fills, type, owner, stp, peak);
 }
 
-bool MatchingEngine::amend_order(uint64_t order_id, int64_t new_price, int64_t new_active_volume,
-                                 vector<Fill> &fills) {
-    if (this->order_book_map.find(order_id) == this->order_book_map.end()) return false; // no such order
-    if (new_price <= 0) return false;
-    if (new_price <= 0) return false;
+bool MatchingEngine::add_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t price, int64_t volume,
+                               vector<Fill> &fills, OrderType type, OwnerId owner, StpMode stp, int64_t peak) {
+    return this->add_order(order_id, instrument, side, price, volume, [&fills](const Fill &fill) {
+        fills.push_back(fill);
+    }, type, owner, stp, peak);
+}
 
-    Book *target_book = this->order_book_map[order_id];
-    Order target_order_copy = target_book->get_order_by_id(order_id);
+bool MatchingEngine::add_stop_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t stop_price,
+                                    int64_t price, int64_t volume, vector<Fill> &fills, OwnerId owner,
+                                    StpMode stp) {
+    return this->add_stop_order(order_id, instrument, side, stop_price, price, volume, [&fills](const Fill &fill) {
+        fills.push_back(fill);
+    }, owner, stp);
+}
 
-    // order only lose priority on 1.price change or 2.increase volume;
-    if (target_order_copy.price == (double) new_price && target_order_copy.volume >= new_active_volume) {
-        target_book->amend(order_id, (double) new_price, new_active_volume);
-    } else {
-        // else, remove the order and reinsert one
-        const string symbol = target_book->symbol;
-        const Side side = target_order_copy.side;
+bool MatchingEngine::set_phase(InstrumentId instrument, TradingPhase phase, vector<Fill> &fills) {
+    return this->set_phase(instrument, phase, [&fills](const Fill &fill) { fills.push_back(fill); });
+}
 
-        this->pull_order(order_id);
-        this->add_order(order_id, symbol, side, new_price, new_active_volume, fills);
-    }
+TradingPhase MatchingEngine::get_phase(InstrumentId instrument) const {
+    const Book *target_book = this->get_book(instrument);
+    return (target_book != nullptr && target_book->in_auction()) ? TradingPhase::AUCTION : TradingPhase::CONTINUOUS;
+}
 
-    return true;
+bool MatchingEngine::amend_order(uint64_t order_id, int64_t new_price, int64_t new_active_volume,
+                                 vector<Fill> &fills) {
+    return this->amend_order(order_id, new_price, new_active_volume, [&fills](const Fill &fill) {
+        fills.push_back(fill);
+    });
+}
+
+bool MatchingEngine::amend_order(InstrumentId instrument, uint64_t order_id, int64_t new_price,
+                                 int64_t new_active_volume, vector<Fill> &fills) {
+    return this->amend_order(instrument, order_id, new_price, new_active_volume, [&fills](const Fill &fill) {
+        fills.push_back(fill);
+    });
 }
 
 bool MatchingEngine::pull_order(uint64_t order_id) {
-    Book *target_book = (this->order_book_map.find(order_id) != this->order_book_map.end()
-                         ? this->order_book_map[order_id] : nullptr);
+    if (this->journal_full()) return false;
 
-    if (target_book == nullptr) {
+    // single probe: find and un-index at once
+    Order *target_order = this->orders.erase(order_id);
+    bool waiting = false;
+    if (target_order == nullptr && this->stops.size() > 0) {
+        target_order = this->stops.erase(order_id);     // may be a stop order waiting for its trigger
+        waiting = true;
+    }
+
+    if (target_order == nullptr) {
         return false;
     } else {
-        this->order_book_map.erase(order_id);
-        target_book->remove(order_id);
+        auto target_book = static_cast<Book *>(target_order->book);
+        waiting ? target_book->remove_stop(target_order) : target_book->remove(target_order);
+        this->commit(JournalRecord::PULL, 0, Side::Buy, order_id, 0, 0);
+        target_book->publish_deltas();
         return true;
     }
 
 }
 
+bool MatchingEngine::pull_order(InstrumentId instrument, uint64_t order_id) {
+    const Order *target_order = this->orders.find(order_id);
+    if (target_order == nullptr && this->stops.size() > 0) target_order = this->stops.find(order_id);
+    if (target_order == nullptr) return false; // no such order
+    if (target_order->book != this->get_book(instrument)) return false;  // order of another instrument
+
+    return this->pull_order(order_id);
+}
+
+size_t MatchingEngine::mass_cancel(OwnerId owner, InstrumentId instrument) {
+    if (owner == 0) return 0;
+    if (this->journal_full()) return 0;
+    const Book *only_book = nullptr;
+    if (instrument != 0) {
+        only_book = this->get_book(instrument);
+        if (only_book == nullptr) return 0;     // bad instrument
+    }
+    auto it = this->owners.find(owner);
+    if (it == this->owners.end()) return 0;
+
+    // withdraw every order, best prices of the touched books are looked up once at the end
+    OwnerLink *const head = &it->second;
+    size_t cancelled = 0;
+    for (OwnerLink *link = head->next; link != head;) {
+        Order *const target_order = link->order;
+        link = link->next;  // the order leaves the list as it is destructed
+        if (only_book != nullptr && target_order->book != only_book) continue;
+
+        auto target_book = static_cast<Book *>(target_order->book);
+        if (this->orders.erase(target_order->order_id) != nullptr) {
+            if (this->settling.empty() || this->settling.back() != target_book) this->settling.push_back(target_book);
+            target_book->withdraw(target_order);
+        } else {
+            // a stop order waiting for its trigger, no level changes
+            this->stops.erase(target_order->order_id);
+            target_book->remove_stop(target_order);
+        }
+        cancelled++;
+    }
+    if (cancelled == 0) return 0;
+
+    std::sort(this->settling.begin(), this->settling.end());
+    this->settling.erase(std::unique(this->settling.begin(), this->settling.end()), this->settling.end());
+    for (Book *target_book: this->settling) target_book->settle();
+    this->commit(JournalRecord::MASS_CANCEL, instrument, Side::Buy, 0, 0, 0, OrderType::LIMIT, owner);
+    for (Book *target_book: this->settling) target_book->publish_deltas();
+    this->settling.clear();
+    return cancelled;
+}
+
+size_t MatchingEngine::mass_cancel(OwnerId owner, const string &symbol) {
+    const InstrumentId instrument = this->get_instrument_id(symbol);
+    if (instrument == 0) return 0;     // bad symbol
+
+    return this->mass_cancel(owner, instrument);
+}
+
+size_t MatchingEngine::process_batch(const OrderCommand *commands, size_t count, vector<CommandFill> &fills,
+                                     bool *accepted) {
+    return this->process_batch(commands, count, [&fills](size_t command_index, const Fill &fill) {
+        fills.push_back(CommandFill{command_index, fill});
+    }, accepted);
+}
+
 Book *MatchingEngine::get_book(string const &symbol) {
-    return (this->books.find(symbol) != this->books.end() ? this->books[symbol] : nullptr);
+    return this->get_book(this->get_instrument_id(symbol));
 }
 
-BestBidOffer MatchingEngine::get_top_of_book(const string &symbol) const {
-    auto it = this->books.find(symbol);
-    if (it == this->books.end()) {
-        return BestBidOffer{0, 0, 0, 0};
+const Order *MatchingEngine::get_order(uint64_t order_id) const {
+    return this->orders.find(order_id);
+}
+
+void MatchingEngine::snapshot(vector<char> &image) const {
+    image.clear();
+    image.reserve(sizeof(Snapshot::FileHeader) + this->orders.size() * sizeof(Snapshot::OrderRecord));
+
+    Snapshot::FileHeader file_header{};
+    std::memcpy(file_header.magic, Snapshot::MAGIC, sizeof(Snapshot::MAGIC));
+    file_header.version = Snapshot::VERSION;
+    file_header.book_count = (uint32_t) (this->books.size() - 1);
+    file_header.order_count = this->orders.size();
+    file_header.sequence = this->sequence;
+    append(image, file_header);
+
+    for (size_t instrument = 1; instrument < this->books.size(); instrument++) {
+        const Book *const book = this->books[instrument];
+
+        Snapshot::BookHeader book_header{};
+        book_header.unit = book->unit;
+        book_header.order_count = book->get_order_count();
+        book_header.symbol_length = (uint32_t) book->symbol.size();
+        book_header.stop_count = (uint32_t) book->get_stop_count();
+        book_header.last_price = book->get_last_price();
+        book_header.phase = (uint32_t) (book->in_auction() ? TradingPhase::AUCTION : TradingPhase::CONTINUOUS);
+        const size_t header_offset = image.size();
+        append(image, book_header);
+        image.insert(image.end(), book->symbol.begin(), book->symbol.end());
+        image.resize(image.size() + Snapshot::padded(book->symbol.size()) - book->symbol.size(), 0);
+
+        // all levels first, then all orders, both in priority order
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            uint32_t &level_count = (side == Side::Buy) ? book_header.buy_level_count : book_header.sell_level_count;
+            for (const Limit *limit = book->get_best_limit(side); limit != nullptr;
+                 limit = book->get_next_limit(side, limit->price)) {
+                append(image, Snapshot::LevelRecord{limit->price, limit->size});
+                level_count++;
+            }
+        }
+        std::memcpy(image.data() + header_offset, &book_header, sizeof(book_header));
+
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            for (const Limit *limit = book->get_best_limit(side); limit != nullptr;
+                 limit = book->get_next_limit(side, limit->price)) {
+                for (const Order *order = limit->front_order; order != nullptr; order = order->next) {
+                    append(image, Snapshot::OrderRecord{order->order_id, order->volume, order->owner,
+                                                        order->owner != 0 ? order->stp : StpMode::NONE, {},
+                                                        order->iceberg ? order->hidden : 0,
+                                                        order->iceberg ? order->peak : 0});
+                }
+            }
+        }
+
+        // stop orders last, in trigger order
+        for (const Side side: {Side::Buy, Side::Sell}) {
+            for (const Limit *limit = book->get_first_stop(side); limit != nullptr;
+                 limit = book->get_next_stop(side, limit->price)) {
+                for (const Order *order = limit->front_order; order != nullptr; order = order->next) {
+                    append(image, Snapshot::StopRecord{order->order_id, order->volume, limit->price, order->price,
+                                                       side, order->owner != 0 ? order->stp : StpMode::NONE, {},
+                                                       order->owner});
+                }
+            }
+        }
     }
+}
 
-    auto target_book = it->second;
+bool MatchingEngine::save_snapshot(const string &path) const {
+    vector<char> image;
+    this->snapshot(image);
+    return write_image(path, image);
+}
 
-    auto best_bid_price = (double) target_book->get_highest_price();
-    auto best_ask_price = (double) target_book->get_lowest_price();
+std::future<bool> MatchingEngine::save_snapshot_async(const string &path) const {
+    // the consistent point is now, only the I/O is left to the background thread
+    vector<char> image;
+    this->snapshot(image);
+    return std::async(std::launch::async, [image = std::move(image), path] { return write_image(path, image); });
+}
 
-    return BestBidOffer{
-            static_cast<int64_t>(target_book->get_volume_by_limit(Side::Buy, best_bid_price)),
-            static_cast<int64_t>(best_bid_price),
-            static_cast<int64_t>(target_book->get_volume_by_limit(Side::Sell, best_ask_price)),
-            static_cast<int64_t>(best_ask_price)
+bool MatchingEngine::load_snapshot(const char *const image, const size_t size) {
+    if (this->books.size() > 1) return false;   // only an engine without books can be loaded
+    if (this->journal != nullptr) return false; // the books created would be journaled
+    if (reinterpret_cast<uintptr_t>(image) % alignof(Snapshot::OrderRecord) != 0) return false;
+
+    const char *cursor = image;
+    const char *const end = image + size;
+    auto take = [&cursor, end](size_t bytes) -> const char * {
+        if ((size_t) (end - cursor) < bytes) return nullptr;
+        const char *taken = cursor;
+        cursor += bytes;
+        return taken;
     };
+
+    const char *const file_header_bytes = take(sizeof(Snapshot::FileHeader));
+    if (file_header_bytes == nullptr) return false;
+    const auto &file_header = *reinterpret_cast<const Snapshot::FileHeader *>(file_header_bytes);
+    if (std::memcmp(file_header.magic, Snapshot::MAGIC, sizeof(Snapshot::MAGIC)) != 0) return false;
+    if (file_header.version != Snapshot::VERSION) return false;
+    this->orders.reserve(file_header.order_count);
+
+    bool valid = true;
+    for (uint32_t b = 0; b < file_header.book_count && valid; b++) {
+        valid = false;
+        const char *const book_header_bytes = take(sizeof(Snapshot::BookHeader));
+        if (book_header_bytes == nullptr) break;
+        const auto &book_header = *reinterpret_cast<const Snapshot::BookHeader *>(book_header_bytes);
+
+        const size_t level_count = (size_t) book_header.buy_level_count + book_header.sell_level_count;
+        const char *const symbol = take(Snapshot::padded(book_header.symbol_length));
+        const char *const level_bytes = symbol ? take(level_count * sizeof(Snapshot::LevelRecord)) : nullptr;
+        const char *const order_bytes = level_bytes ? take(book_header.order_count * sizeof(Snapshot::OrderRecord))
+                                                    : nullptr;
+        const char *const stop_bytes = order_bytes ? take(book_header.stop_count * sizeof(Snapshot::StopRecord))
+                                                   : nullptr;
+        if (stop_bytes == nullptr) break;   // truncated
+
+        const InstrumentId instrument = this->create_book(string(symbol, book_header.symbol_length), book_header.unit,
+                                                          book_header.order_count, level_count);
+        if (instrument == 0) break;
+        Book *const target_book = this->books[instrument];
+
+        const auto *levels = reinterpret_cast<const Snapshot::LevelRecord *>(level_bytes);
+        const auto *records = reinterpret_cast<const Snapshot::OrderRecord *>(order_bytes);
+        uint64_t remaining = book_header.order_count;
+        valid = true;
+        for (size_t l = 0; l < level_count && valid; l++) {
+            const Side side = (l < book_header.buy_level_count) ? Side::Buy : Side::Sell;
+            if (levels[l].order_count > remaining) {
+                valid = false;
+                break;
+            }
+
+            // bulk build the level, then index its orders walking the new chain
+            Order *order = target_book->restore_level(side, levels[l].price, records, levels[l].order_count);
+            valid = (order != nullptr);
+            for (; order != nullptr && valid; order = order->next) {
+                valid = order->volume > 0 &&
+                        (order->owner == 0 || (uint8_t) order->stp <= (uint8_t) StpMode::DECREMENT_BOTH) &&
+                        this->orders.insert(order->order_id, order);
+                if (valid) this->link_owner(order);
+            }
+            records += levels[l].order_count;
+            remaining -= levels[l].order_count;
+        }
+        valid = valid && remaining == 0;
+
+        // inserted in trigger order, so they keep their priority
+        const auto *stops = reinterpret_cast<const Snapshot::StopRecord *>(stop_bytes);
+        for (uint32_t i = 0; i < book_header.stop_count && valid; i++) {
+            valid = stops[i].order_id != 0 && stops[i].volume > 0 && stops[i].stop_price > 0 && stops[i].price >= 0 &&
+                    (stops[i].side == Side::Buy || stops[i].side == Side::Sell) &&
+                    (stops[i].owner == 0 || (uint8_t) stops[i].stp <= (uint8_t) StpMode::DECREMENT_BOTH);
+            if (!valid) break;
+            Order *const stop = target_book->create_order(stops[i].order_id, stops[i].side, stops[i].price,
+                                                          stops[i].volume, stops[i].owner, stops[i].stp);
+            target_book->insert_stop(stop, stops[i].stop_price);
+            valid = !this->order_exists(stops[i].order_id) && this->stops.insert(stops[i].order_id, stop);
+            if (valid) this->link_owner(stop);
+        }
+        target_book->restore_last_price(book_header.last_price);
+        target_book->set_auction(book_header.phase == (uint32_t) TradingPhase::AUCTION);
+    }
+    if (valid && cursor == end && this->orders.size() == file_header.order_count) {
+        this->sequence = file_header.sequence;
+        return true;
+    }
+
+    // corrupt or truncated, drop whatever was restored so far
+    this->clear();
+    return false;
+}
+
+bool MatchingEngine::load_snapshot(const string &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    const auto size = (size_t) info.st_size;
+    void *const mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const bool loaded = this->load_snapshot(static_cast<const char *>(mapping), size);
+    munmap(mapping, size);
+    return loaded;
+}
+
+size_t MatchingEngine::get_depth(InstrumentId instrument, Side side, size_t n, DepthLevel *out) const {
+    const Book *target_book = this->get_book(instrument);
+    return target_book != nullptr ? target_book->depth(side, n, out) : 0;
+}
+
+bool MatchingEngine::set_delta_feed(InstrumentId instrument, TradeDS::SpscRing<LevelDelta> *const feed) {
+    Book *const target_book = this->get_book(instrument);
+    if (target_book == nullptr) return false;   // bad instrument
+
+    target_book->set_delta_feed(feed, instrument);
+    return true;
+}
+
+bool MatchingEngine::set_journal(Journal *const journal) {
+    if (journal != nullptr) {
+        if (!journal->is_open()) return false;
+        if (journal->size() > 0 && journal->last_sequence() != this->sequence) return false;   // replay it first
+    }
+    this->journal = journal;
+    return true;
+}
+
+bool MatchingEngine::replay_journal(const Journal &journal) {
+    if (this->journal != nullptr) return false;     // replayed commands would be journaled again
+    if (journal.size() == 0) return true;
+
+    // records are consecutive, the first one not applied yet is found by its sequence
+    const uint64_t first_sequence = journal[0].sequence;
+    if (first_sequence > this->sequence + 1) return false;  // commands missing in between
+    auto discard = [](const Fill &) {};
+
+    for (size_t i = this->sequence + 1 - first_sequence; i < journal.size(); i++) {
+        const JournalRecord &record = journal[i];
+        bool applied = false;
+        switch (record.type) {
+            case JournalRecord::ADD:
+                applied = this->add_order(record.order_id, record.instrument, record.side, record.price,
+                                          record.volume, discard, record.order_type, record.participant.owner,
+                                          record.participant.stp, record.get_peak());
+                break;
+            case JournalRecord::AMEND:
+                applied = this->amend_order(record.order_id, record.price, record.volume, discard);
+                break;
+            case JournalRecord::PULL:
+                applied = this->pull_order(record.order_id);
+                break;
+            case JournalRecord::MASS_CANCEL:
+                applied = this->mass_cancel(record.participant.owner, record.instrument) > 0;
+                break;
+            case JournalRecord::ADD_STOP:
+                applied = this->add_stop_order(record.order_id, record.instrument, record.side,
+                                               record.get_stop_price(), record.price, record.volume, discard,
+                                               record.participant.owner, record.participant.stp);
+                break;
+            case JournalRecord::SET_PHASE:
+                applied = this->set_phase(record.instrument, (TradingPhase) record.volume, discard);
+                break;
+            case JournalRecord::CREATE_BOOK:
+                applied = this->create_book(string(record.symbol, record.symbol_length), record.price,
+                                            record.order_id, (size_t) record.volume) == record.instrument;
+                break;
+        }
+        if (!applied) return false;     // accepted when journaled, so this isn't the state it was journaled on
+    }
+    return true;
+}
+
+BestBidOffer MatchingEngine::get_top_of_book(const string &symbol) const {
+    return this->get_top_of_book(this->get_instrument_id(symbol));
+}
+
+BestBidOffer MatchingEngine::get_top_of_book(InstrumentId instrument) const {
+    const Book *target_book = this->get_book(instrument);
+    if (target_book == nullptr) {
+        return BestBidOffer{0, 0, 0, 0};
+    }
+
+    // the Book keeps its published top of book up to date, no level lookup needed
+    return target_book->get_top_of_book();
 }
 
 
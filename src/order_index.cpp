@@ -0,0 +1,72 @@
+#include "order_index.hpp"
+
+using TradeDS::OrderIndex, TradeDS::Order;
+
+OrderIndex::OrderIndex(size_t capacity) {
+    this->slots.resize(2);
+    this->mask = 1;
+    this->shift = 63;
+    this->reserve(capacity);
+}
+
+void OrderIndex::reserve(size_t capacity) {
+    // keep load factor at most 1/2
+    while (this->slots.size() < capacity * 2) this->grow();
+}
+
+void OrderIndex::grow() {
+    vector<Slot> old_slots(this->slots.size() * 2);
+    old_slots.swap(this->slots);
+    this->mask = this->slots.size() - 1;
+    this->shift--;
+
+    for (auto const &slot: old_slots) {
+        if (slot.order_id == 0) continue;
+
+        size_t i = this->home(slot.order_id);
+        while (this->slots[i].order_id != 0) i = (i + 1) & this->mask;
+        this->slots[i] = slot;
+    }
+}
+
+bool OrderIndex::insert(uint64_t order_id, Order *order) {
+    if (order_id == 0) return false;
+    if ((this->count + 1) * 2 > this->slots.size()) this->grow();
+
+    size_t i = this->home(order_id);
+    for (;; i = (i + 1) & this->mask) {
+        if (this->slots[i].order_id == order_id) return false;   // already indexed
+        if (this->slots[i].order_id == 0) break;
+    }
+
+    this->slots[i] = Slot{order_id, order};
+    this->count++;
+    return true;
+}
+
+Order *OrderIndex::erase(uint64_t order_id) {
+    if (order_id == 0) return nullptr;
+
+    size_t i = this->home(order_id);
+    for (;; i = (i + 1) & this->mask) {
+        if (this->slots[i].order_id == order_id) break;
+        if (this->slots[i].order_id == 0) return nullptr;    // not indexed
+    }
+
+    Order *erased = this->slots[i].order;
+    this->count--;
+
+    // backward-shift: pull following elements of the probe chain into the hole
+    size_t hole = i;
+    for (size_t j = (i + 1) & this->mask; this->slots[j].order_id != 0; j = (j + 1) & this->mask) {
+        const size_t j_home = this->home(this->slots[j].order_id);
+        // move j into the hole only if its home slot isn't cyclically in (hole, j]
+        if (((j - j_home) & this->mask) >= ((j - hole) & this->mask)) {
+            this->slots[hole] = this->slots[j];
+            hole = j;
+        }
+    }
+    this->slots[hole] = Slot{};
+
+    return erased;
+}
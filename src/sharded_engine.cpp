@@ -0,0 +1,198 @@
+#include "sharded_engine.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <functional>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    /**
+     * back off a spinning thread, a pause instruction when available
+     */
+    inline void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    constexpr size_t IDLE_SPINS = 1024;   // empty polls before a worker yields its core
+}
+
+ShardedEngine::Shard::Shard(size_t producers, size_t queue_capacity, int cpu)
+        : outbound{queue_capacity}, cpu{cpu} {
+    for (size_t i = 0; i < producers; i++) this->inbound.emplace_back(new SpscRing<OrderCommand>(queue_capacity));
+}
+
+ShardedEngine::ShardedEngine(const ShardedEngineConfig &config) : PRODUCERS{config.producers} {
+    const size_t shard_count = config.shards > 0 ? config.shards : 1;
+    for (size_t i = 0; i < shard_count; i++) {
+        const int cpu = i < config.cpus.size() ? config.cpus[i] : -1;
+        this->shards.emplace_back(new Shard(config.producers, config.queue_capacity, cpu));
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    this->stop();
+}
+
+InstrumentId ShardedEngine::create_book(const string &symbol, int64_t unit, size_t order_capacity,
+                                        size_t limit_capacity) {
+    const size_t shard = std::hash<string>{}(symbol) % this->shards.size();
+    return this->create_book(shard, symbol, unit, order_capacity, limit_capacity);
+}
+
+InstrumentId ShardedEngine::create_book(size_t shard, const string &symbol, int64_t unit, size_t order_capacity,
+                                        size_t limit_capacity) {
+    if (this->started) return 0;    // routing table is read without a lock once workers run
+    if (shard >= this->shards.size()) return 0;
+    if (this->instrument_ids.find(symbol) != this->instrument_ids.end()) return 0;  // symbol exists
+
+    const InstrumentId local_instrument = this->shards[shard]->engine.create_book(symbol, unit, order_capacity,
+                                                                                 limit_capacity);
+    if (local_instrument == 0) return 0;
+
+    const auto instrument = (InstrumentId) this->routes.size();
+    this->routes.push_back({shard, local_instrument});
+    this->instrument_ids[symbol] = instrument;
+    return instrument;
+}
+
+InstrumentId ShardedEngine::get_instrument_id(const string &symbol) const {
+    auto it = this->instrument_ids.find(symbol);
+    return it != this->instrument_ids.end() ? it->second : 0;
+}
+
+size_t ShardedEngine::get_shard(InstrumentId instrument) const {
+    if (instrument == 0 || instrument >= this->routes.size()) return this->shards.size();
+    return this->routes[instrument].shard;
+}
+
+const Book *ShardedEngine::get_book(InstrumentId instrument) const {
+    if (instrument == 0 || instrument >= this->routes.size()) return nullptr;
+    const Route &route = this->routes[instrument];
+    return this->shards[route.shard]->engine.get_book(route.local_instrument);
+}
+
+BestBidOffer ShardedEngine::get_top_of_book(InstrumentId instrument) const {
+    // books are never created or destroyed while running, only their published top of book is read
+    const Book *target_book = this->get_book(instrument);
+    return target_book != nullptr ? target_book->get_top_of_book() : BestBidOffer{0, 0, 0, 0};
+}
+
+void ShardedEngine::start() {
+    if (this->started) return;
+    this->started = true;
+    this->running.store(true, std::memory_order_release);
+
+    for (auto &shard: this->shards) {
+        Shard *const target_shard = shard.get();
+        target_shard->worker = std::thread([this, target_shard] { this->run(*target_shard); });
+    }
+}
+
+void ShardedEngine::stop() {
+    if (!this->started) return;
+    this->running.store(false, std::memory_order_release);
+
+    for (auto &shard: this->shards) {
+        if (shard->worker.joinable()) shard->worker.join();
+    }
+    this->started = false;
+}
+
+void ShardedEngine::run(Shard &shard) {
+    if (shard.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard.cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);    // best effort, runs unpinned on failure
+    }
+
+    OrderCommand command;
+    ShardEvent event;
+    auto publish = [&shard](const ShardEvent &outgoing) {
+        while (!shard.outbound.push(outgoing)) relax();   // never drop, wait for the consumer
+    };
+    auto on_fill = [&](const Fill &fill) {
+        event.type = ShardEvent::FILL;
+        event.fill = fill;
+        publish(event);
+    };
+
+    size_t idle = 0;
+    for (;;) {
+        // read the flag before polling, so everything submitted before stop is still drained
+        const bool stopping = !this->running.load(std::memory_order_acquire);
+
+        bool busy = false;
+        for (auto &inbound: shard.inbound) {
+            while (inbound->pop(command)) {
+                busy = true;
+                const InstrumentId local_instrument = this->routes[command.instrument].local_instrument;
+                event.instrument = command.instrument;
+                event.order_id = command.order_id;
+
+                bool accepted = false;
+                switch (command.type) {
+                    case OrderCommand::ADD:
+                        accepted = shard.engine.add_order(command.order_id, local_instrument, command.side,
+                                                          command.price, command.volume, on_fill, command.order_type,
+                                                          command.owner, command.stp, command.peak);
+                        break;
+                    case OrderCommand::AMEND:
+                        accepted = shard.engine.amend_order(local_instrument, command.order_id, command.price,
+                                                            command.volume, on_fill);
+                        break;
+                    case OrderCommand::PULL:
+                        accepted = shard.engine.pull_order(local_instrument, command.order_id);
+                        break;
+                }
+                if (!accepted) {
+                    event.type = ShardEvent::REJECTED;
+                    event.fill = Fill{};
+                    publish(event);
+                }
+            }
+        }
+
+        if (busy) {
+            idle = 0;
+        } else if (stopping) {
+            return;
+        } else if (++idle < IDLE_SPINS) {
+            relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ShardedEngine::submit(size_t producer, const OrderCommand &command) {
+    if (producer >= this->PRODUCERS) return false;
+    if (command.instrument == 0 || command.instrument >= this->routes.size()) return false;   // bad instrument
+
+    return this->shards[this->routes[command.instrument].shard]->inbound[producer]->push(command);
+}
+
+bool ShardedEngine::add_order(size_t producer, uint64_t order_id, InstrumentId instrument, Side side,
+                              int64_t price, int64_t volume, OrderType type, OwnerId owner, StpMode stp,
+                              int64_t peak) {
+    return this->submit(producer, {OrderCommand::ADD, type, side, instrument, order_id, price, volume, owner, stp,
+                                   peak});
+}
+
+bool ShardedEngine::amend_order(size_t producer, InstrumentId instrument, uint64_t order_id, int64_t new_price,
+                                int64_t new_active_volume) {
+    return this->submit(producer, {OrderCommand::AMEND, OrderType::LIMIT, Side::Buy, instrument, order_id, new_price,
+                                   new_active_volume});
+}
+
+bool ShardedEngine::pull_order(size_t producer, InstrumentId instrument, uint64_t order_id) {
+    return this->submit(producer, {OrderCommand::PULL, OrderType::LIMIT, Side::Buy, instrument, order_id, 0, 0});
+}
@@ -0,0 +1,109 @@
+#include <cstdint>
+#include <cstdio>
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "clob.hpp"
+
+using TradeDS::Book, TradeDS::WindowBook, TradeDS::FixedTickBook, TradeDS::Order;
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    const int64_t UNIT = 5;
+    const int64_t MIDDLE_TICK = 100000;
+
+    /**
+     * run one seeded flow of inserts, cancels and aggressive matches on a Book, in API prices, and trace every fill
+     * and the state of the Book after every step
+     */
+    template<typename BookType>
+    vector<int64_t> trace(uint64_t seed, size_t steps) {
+        BookType book("TRACE", UNIT);
+        std::mt19937_64 rng(seed);
+        std::unordered_map<uint64_t, Order *> resting;
+        vector<uint64_t> ids;
+        vector<int64_t> out;
+        uint64_t next_order_id = 1;
+        DepthLevel levels[5];
+
+        auto on_fill = [&](const Order &order, uint64_t traded) {
+            out.insert(out.end(), {(int64_t) order.order_id, book.to_price(order.price), (int64_t) traded,
+                                   (int64_t) order.volume});
+            if (order.volume == 0) resting.erase(order.order_id);
+        };
+
+        for (size_t step = 0; step < steps; step++) {
+            const uint64_t draw = rng();
+            const Side side = (draw & 1) ? Side::Sell : Side::Buy;
+            // mostly around the touch, now and then far enough to leave a 1024 tick window
+            int64_t offset = (int64_t) ((draw >> 8) % 64) - 32;
+            if ((draw >> 16) % 16 == 0) offset *= 100;
+            const int64_t price = (MIDDLE_TICK + offset) * UNIT;
+            const auto volume = (uint64_t) ((draw >> 24) % 200 + 1);
+
+            switch ((draw >> 40) % 4) {
+                case 0:
+                case 1: {
+                    // passive insert, whatever crosses is matched first
+                    const uint64_t order_id = next_order_id++;
+                    const uint64_t left = book.match(side, book.to_ticks(price), volume, on_fill);
+                    if (left > 0) {
+                        resting[order_id] = book.insert(book.create_order(order_id, side, book.to_ticks(price), left));
+                        ids.push_back(order_id);
+                    }
+                    break;
+                }
+                case 2: {
+                    if (ids.empty()) break;
+                    auto it = resting.find(ids[(draw >> 44) % ids.size()]);
+                    if (it == resting.end()) break;     // filled meanwhile
+                    out.push_back(book.remove(it->second));
+                    resting.erase(it);
+                    break;
+                }
+                default:
+                    out.push_back((int64_t) book.match(side, book.to_ticks(price), volume * 4, on_fill));
+            }
+
+            const BestBidOffer top = book.get_top_of_book();
+            out.insert(out.end(), {top.bid_price, top.bid_volume, top.ask_price, top.ask_volume,
+                                   (int64_t) book.get_order_count(), book.get_buy_volume(), book.get_sell_volume()});
+            for (const Side depth_side: {Side::Buy, Side::Sell}) {
+                const size_t count = book.depth(depth_side, 5, levels);
+                for (size_t i = 0; i < count; i++) {
+                    out.insert(out.end(), {levels[i].price, levels[i].volume, (int64_t) levels[i].order_count});
+                }
+            }
+        }
+        return out;
+    }
+}
+
+int main() {
+    // every tick policy and level storage must behave as Book on the same flow
+    for (uint64_t seed = 1; seed <= 8; seed++) {
+        const vector<int64_t> expected = trace<Book>(seed, 20000);
+        check(trace<WindowBook>(seed, 20000) == expected, "WindowBook traces as Book");
+        check(trace<FixedTickBook>(seed, 20000) == expected, "FixedTickBook traces as Book");
+    }
+
+    // the price band of a FixedTick Book is checked at the API edge
+    FixedTickBook fixed("FIXED", 1);
+    check(fixed.unit == UNIT, "FixedTick ignores the unit requested");
+    check(fixed.to_ticks(UNIT) == 1 && fixed.to_ticks(UNIT << 20) == 1 << 20, "FixedTick band edges");
+    check(fixed.to_ticks(0) == 0 && fixed.to_ticks((UNIT << 20) + UNIT) == 0, "FixedTick outside the band");
+    check(fixed.to_ticks(UNIT + 1) == 0, "FixedTick off the tick grid");
+
+    if (failures == 0) std::printf("book_policies: passed\n");
+    return failures == 0 ? 0 : 1;
+}
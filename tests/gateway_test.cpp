@@ -0,0 +1,142 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+
+#include "gateway.hpp"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    int connect_to(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    Wire::NewOrderMessage new_order(InstrumentId instrument, uint64_t order_id, Side side, int64_t price,
+                                    int64_t volume) {
+        Wire::NewOrderMessage message{};
+        message.header = {sizeof(message), Wire::NEW_ORDER, 0, instrument};
+        message.order_id = order_id;
+        message.price = price;
+        message.volume = volume;
+        message.side = side;
+        return message;
+    }
+
+    Wire::CancelMessage cancel(InstrumentId instrument, uint64_t order_id) {
+        return {{sizeof(Wire::CancelMessage), Wire::CANCEL, 0, instrument}, order_id};
+    }
+
+    /**
+     * poll the gateway until a client received count reports, or gave up waiting
+     */
+    vector<Wire::ExecutionReport> collect(Gateway &gateway, int fd, size_t count) {
+        vector<Wire::ExecutionReport> reports;
+        Wire::ExecutionReport report{};
+        size_t partial = 0;
+        for (int round = 0; round < 500 && reports.size() < count; round++) {
+            gateway.poll(1);
+            for (;;) {
+                const ssize_t bytes = recv(fd, reinterpret_cast<char *>(&report) + partial, sizeof(report) - partial,
+                                           MSG_DONTWAIT);
+                if (bytes <= 0) break;
+                partial += bytes;
+                if (partial == sizeof(report)) {
+                    reports.push_back(report);
+                    partial = 0;
+                }
+            }
+        }
+        return reports;
+    }
+
+    bool is(const Wire::ExecutionReport &report, Wire::ExecutionReport::Type type, uint64_t order_id) {
+        return report.report == type && report.order_id == order_id;
+    }
+}
+
+int main() {
+    MatchingEngine engine;
+    const InstrumentId instrument = engine.create_book("GATEWAY", 1);
+    GatewayConfig config;
+    config.address = "127.0.0.1";
+    Gateway gateway(engine, config);
+    check(gateway.open(), "gateway opens");
+
+    const int a = connect_to(gateway.get_port());
+    const int b = connect_to(gateway.get_port());
+    check(a >= 0 && b >= 0, "clients connect");
+    for (int round = 0; round < 500 && gateway.get_session_count() < 2; round++) gateway.poll(1);
+    check(gateway.get_session_count() == 2, "both sessions accepted");
+
+    // a resting order of A
+    const Wire::NewOrderMessage sell = new_order(instrument, 1, Side::Sell, 10, 50);
+    send(a, &sell, sizeof(sell), 0);
+    vector<Wire::ExecutionReport> reports = collect(gateway, a, 1);
+    check(reports.size() == 1 && is(reports[0], Wire::ExecutionReport::ACCEPTED, 1), "A's order is accepted");
+
+    // B neither cancels A's order nor reuses its order_id
+    const Wire::CancelMessage foreign_cancel = cancel(instrument, 1);
+    const Wire::NewOrderMessage duplicate = new_order(instrument, 1, Side::Sell, 11, 10);
+    send(b, &foreign_cancel, sizeof(foreign_cancel), 0);
+    send(b, &duplicate, sizeof(duplicate), 0);
+    reports = collect(gateway, b, 2);
+    check(reports.size() == 2 && is(reports[0], Wire::ExecutionReport::REJECTED, 1) &&
+          is(reports[1], Wire::ExecutionReport::REJECTED, 1), "B's cancel and duplicate of A's order are rejected");
+    check(engine.get_order(1) != nullptr && engine.get_order(1)->volume == 50, "A's order is left as it was");
+
+    // a trade is reported to both sessions, the resting side by the owner the engine tracks
+    const Wire::NewOrderMessage buy = new_order(instrument, 2, Side::Buy, 10, 20);
+    send(b, &buy, sizeof(buy), 0);
+    reports = collect(gateway, b, 2);
+    check(reports.size() == 2 && is(reports[0], Wire::ExecutionReport::FILL, 2) && reports[0].volume == 20 &&
+          is(reports[1], Wire::ExecutionReport::ACCEPTED, 2), "B's aggressor fill and status are reported");
+    reports = collect(gateway, a, 1);
+    check(reports.size() == 1 && is(reports[0], Wire::ExecutionReport::FILL, 1) &&
+          reports[0].remaining_volume == 30, "A's resting fill is reported to A");
+
+    // an order cancelled in the same round it was added, both commands in one batch
+    const Wire::NewOrderMessage own_add = new_order(instrument, 3, Side::Buy, 5, 10);
+    const Wire::CancelMessage own_cancel = cancel(instrument, 3);
+    char burst[sizeof(own_add) + sizeof(own_cancel)];
+    std::memcpy(burst, &own_add, sizeof(own_add));
+    std::memcpy(burst + sizeof(own_add), &own_cancel, sizeof(own_cancel));
+    send(a, burst, sizeof(burst), 0);
+    reports = collect(gateway, a, 2);
+    check(reports.size() == 2 && is(reports[0], Wire::ExecutionReport::ACCEPTED, 3) &&
+          is(reports[1], Wire::ExecutionReport::ACCEPTED, 3), "an order is cancelled in the round it was added");
+    check(engine.get_order(3) == nullptr, "the cancelled order is gone");
+
+    // A's resting orders go with A
+    ::close(a);
+    for (int round = 0; round < 500 && gateway.get_session_count() > 1; round++) gateway.poll(1);
+    check(gateway.get_session_count() == 1 && engine.get_order(1) == nullptr, "A's orders are cancelled on close");
+
+    ::close(b);
+    gateway.close();
+
+    if (failures == 0) std::printf("gateway: passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "latency_histogram.hpp"
+
+using TradeDS::LatencyHistogram;
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+}
+
+int main() {
+    static LatencyHistogram histogram;
+
+    // exact below 64
+    for (uint64_t value = 0; value < 64; value++) histogram.record(value);
+    check(histogram.count() == 64, "count of exact values");
+    check(histogram.percentile(0.5) == 31, "p50 of 0..63");
+    check(histogram.percentile(1.0) == 63, "p100 of 0..63");
+
+    // within ~3% above
+    histogram.reset();
+    histogram.record(1000000);
+    const uint64_t p50 = histogram.percentile(0.5);
+    check(p50 <= 1000000 && p50 >= 1000000 - 1000000 / 32, "p50 of one large value within a sub-bucket");
+
+    // the top bucket, a wrapped TSC delta
+    histogram.reset();
+    histogram.record(UINT64_MAX);
+    check(histogram.count() == 1, "count of UINT64_MAX");
+    check(histogram.max() == UINT64_MAX, "max of UINT64_MAX");
+    check(histogram.percentile(0.5) == UINT64_MAX, "p50 of UINT64_MAX");
+    histogram.record(1ull << 63);
+    check(histogram.percentile(0.0) >= (1ull << 63) && histogram.percentile(0.0) < UINT64_MAX, "p0 of 2^63");
+    check(histogram.percentile(1.0) == UINT64_MAX, "p100 of 2^63 and UINT64_MAX");
+
+    static LatencyHistogram merged;
+    merged.merge(histogram);
+    check(merged.count() == 2 && merged.percentile(1.0) == UINT64_MAX, "merge of the top bucket");
+
+    if (failures == 0) std::printf("latency_histogram: passed\n");
+    return failures == 0 ? 0 : 1;
+}
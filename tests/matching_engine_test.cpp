@@ -0,0 +1,282 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <vector>
+
+#include "matching_engine.hpp"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    const OwnerId OWN = 1;
+    const OwnerId OTHER = 2;
+
+    /**
+     * a book offering 100 at 10, an order of OTHER then one of OWN, then 100 of OTHER at 11
+     */
+    InstrumentId mixed_level(MatchingEngine &engine) {
+        vector<Fill> fills;
+        const InstrumentId instrument = engine.create_book("MIXED", 1);
+        engine.add_order(1, instrument, Side::Sell, 10, 50, fills, OrderType::LIMIT, OTHER);
+        engine.add_order(2, instrument, Side::Sell, 10, 50, fills, OrderType::LIMIT, OWN);
+        engine.add_order(3, instrument, Side::Sell, 11, 100, fills, OrderType::LIMIT, OTHER);
+        return instrument;
+    }
+
+    /**
+     * FOK is all or none under every self-trade prevention
+     */
+    void fok_with_self_trade_prevention() {
+        for (const StpMode stp: {StpMode::CANCEL_AGGRESSOR, StpMode::DECREMENT_BOTH, StpMode::CANCEL_RESTING}) {
+            MatchingEngine engine;
+            const InstrumentId instrument = mixed_level(engine);
+            vector<Fill> fills;
+
+            // 100 cross at 10, half of it is OWN's
+            check(!engine.add_order(10, instrument, Side::Buy, 10, 100, fills, OrderType::FOK, OWN, stp),
+                  "FOK against a level of own and foreign orders is rejected");
+            check(fills.empty(), "a rejected FOK fills nothing");
+            check(engine.get_order(1) != nullptr && engine.get_order(2) != nullptr, "a rejected FOK cancels nothing");
+            check(engine.get_book(instrument)->get_sell_volume() == 200, "a rejected FOK leaves the book as it was");
+
+            // what rests ahead of OWN's order is enough
+            fills.clear();
+            check(engine.add_order(11, instrument, Side::Buy, 10, 50, fills, OrderType::FOK, OWN, stp),
+                  "FOK filled ahead of an own order is accepted");
+            check(fills.size() == 1 && fills[0].other_order_id == 1 && fills[0].trade_volume == 50,
+                  "FOK filled ahead of an own order trades it all");
+        }
+
+        // CANCEL_RESTING takes OWN's order out of the way, the next level is foreign
+        MatchingEngine engine;
+        const InstrumentId instrument = mixed_level(engine);
+        vector<Fill> fills;
+        check(!engine.add_order(12, instrument, Side::Buy, 11, 200, fills, OrderType::FOK, OWN,
+                                StpMode::CANCEL_RESTING), "FOK counting an own order under CANCEL_RESTING is rejected");
+        check(engine.add_order(13, instrument, Side::Buy, 11, 150, fills, OrderType::FOK, OWN,
+                               StpMode::CANCEL_RESTING), "FOK of the foreign volume under CANCEL_RESTING is accepted");
+        int64_t traded = 0;
+        for (const Fill &fill: fills) traded += (fill.type == Fill::TRADE) ? fill.trade_volume : 0;
+        check(traded == 150, "FOK under CANCEL_RESTING trades its whole volume");
+        check(engine.get_order(2) == nullptr, "FOK under CANCEL_RESTING cancels the own order");
+
+        // without self-trade prevention, own orders trade as any other
+        MatchingEngine plain;
+        const InstrumentId plain_instrument = mixed_level(plain);
+        fills.clear();
+        check(plain.add_order(14, plain_instrument, Side::Buy, 10, 100, fills, OrderType::FOK, OWN),
+              "FOK without self-trade prevention counts own orders");
+        check(fills.size() == 2, "FOK without self-trade prevention trades own orders");
+    }
+
+    /**
+     * icebergs placed through process_batch, and FOK filled from their reserve
+     */
+    void fok_against_iceberg_reserve() {
+        MatchingEngine engine;
+        const InstrumentId instrument = engine.create_book("ICEBERG", 1);
+        OrderCommand commands[2];
+        commands[0] = {OrderCommand::ADD, OrderType::LIMIT, Side::Sell, instrument, 1, 10, 100, OTHER};
+        commands[0].peak = 10;
+        commands[1] = {OrderCommand::ADD, OrderType::LIMIT, Side::Sell, instrument, 2, 10, 20, OTHER};
+        vector<CommandFill> batch_fills;
+        check(engine.process_batch(commands, 2, batch_fills) == 2, "a batch of an iceberg is accepted");
+        check(engine.get_order(1) != nullptr && engine.get_order(1)->iceberg, "a batch command with peak rests an iceberg");
+        check(engine.get_book(instrument)->get_sell_volume() == 30, "an iceberg of a batch displays its peak");
+        check(engine.get_book(instrument)->get_hidden_volume(Side::Sell) == 90, "an iceberg of a batch keeps the rest");
+
+        // 30 displayed, 120 with the reserve
+        vector<Fill> fills;
+        check(!engine.add_order(10, instrument, Side::Buy, 10, 121, fills, OrderType::FOK),
+              "FOK beyond displayed and reserve volume is rejected");
+        check(fills.empty(), "a rejected FOK fills nothing");
+        check(engine.add_order(11, instrument, Side::Buy, 10, 120, fills, OrderType::FOK),
+              "FOK filled from the reserve is accepted");
+        int64_t traded = 0;
+        for (const Fill &fill: fills) traded += fill.trade_volume;
+        check(traded == 120 && engine.get_book(instrument)->get_order_count() == 0, "FOK takes the reserve out");
+
+        // the reserve behind an own order doesn't trade under DECREMENT_BOTH
+        engine.add_order(20, instrument, Side::Sell, 10, 100, fills, OrderType::LIMIT, OTHER, StpMode::NONE, 10);
+        engine.add_order(21, instrument, Side::Sell, 10, 10, fills, OrderType::LIMIT, OWN);
+        fills.clear();
+        check(!engine.add_order(22, instrument, Side::Buy, 10, 20, fills, OrderType::FOK, OWN,
+                                StpMode::DECREMENT_BOTH), "FOK of a reserve behind an own order is rejected");
+        check(fills.empty(), "a rejected FOK fills nothing");
+        check(engine.add_order(23, instrument, Side::Buy, 10, 20, fills, OrderType::FOK, OWN,
+                               StpMode::CANCEL_RESTING), "FOK of a reserve behind a cancelled own order is accepted");
+    }
+
+    /**
+     * an order repriced across an own resting order keeps the self-trade prevention of its add_order
+     */
+    void amend_with_self_trade_prevention() {
+        for (const StpMode stp: {StpMode::CANCEL_AGGRESSOR, StpMode::DECREMENT_BOTH, StpMode::CANCEL_RESTING}) {
+            MatchingEngine engine;
+            vector<Fill> fills;
+            const InstrumentId instrument = engine.create_book("AMEND", 1);
+            engine.add_order(1, instrument, Side::Sell, 11, 50, fills, OrderType::LIMIT, OWN, stp);
+            engine.add_order(2, instrument, Side::Buy, 10, 30, fills, OrderType::LIMIT, OWN, stp);
+
+            fills.clear();
+            check(engine.amend_order(2, 11, 30, fills), "an amend across an own order is accepted");
+            check(std::none_of(fills.begin(), fills.end(), [](const Fill &fill) { return fill.type == Fill::TRADE; }),
+                  "an amend across an own order doesn't trade");
+
+            const Order *const ask = engine.get_order(1);
+            const Order *const bid = engine.get_order(2);
+            switch (stp) {
+                case StpMode::CANCEL_AGGRESSOR:
+                    check(bid == nullptr && ask != nullptr && ask->volume == 50,
+                          "CANCEL_AGGRESSOR cancels the amended order");
+                    break;
+                case StpMode::CANCEL_RESTING:
+                    check(ask == nullptr && bid != nullptr && bid->volume == 30,
+                          "CANCEL_RESTING cancels the own order and rests the amended one");
+                    break;
+                default:
+                    check(bid == nullptr && ask != nullptr && ask->volume == 20,
+                          "DECREMENT_BOTH takes the amended volume off both orders");
+            }
+        }
+
+        // the self-trade prevention of a resting order survives a snapshot
+        MatchingEngine engine;
+        vector<Fill> fills;
+        const InstrumentId instrument = engine.create_book("AMEND", 1);
+        engine.add_order(1, instrument, Side::Sell, 11, 50, fills, OrderType::LIMIT, OWN, StpMode::CANCEL_AGGRESSOR);
+        engine.add_order(2, instrument, Side::Buy, 10, 30, fills, OrderType::LIMIT, OWN, StpMode::CANCEL_AGGRESSOR);
+        vector<char> image;
+        engine.snapshot(image);
+        vector<uint64_t> aligned((image.size() + 7) / 8);
+        const auto *const bytes = reinterpret_cast<const char *>(aligned.data());
+        std::copy(image.begin(), image.end(), reinterpret_cast<char *>(aligned.data()));
+        MatchingEngine restored;
+        check(restored.load_snapshot(bytes, image.size()), "a snapshot of own orders loads");
+        check(restored.amend_order(2, 11, 30, fills) && restored.get_order(2) == nullptr &&
+              restored.get_order(1) != nullptr && restored.get_order(1)->volume == 50,
+              "a restored order amends with the self-trade prevention of its add_order");
+    }
+
+    /**
+     * the stop orders of an owner go with its resting orders
+     */
+    void mass_cancel_with_stops() {
+        MatchingEngine engine;
+        vector<Fill> fills;
+        const InstrumentId instrument = engine.create_book("STOPS", 1);
+        const InstrumentId other_instrument = engine.create_book("OTHER", 1);
+        engine.add_order(1, instrument, Side::Sell, 12, 10, fills, OrderType::LIMIT, OWN);
+        engine.add_stop_order(2, instrument, Side::Buy, 20, 21, 10, fills, OWN, StpMode::CANCEL_AGGRESSOR);
+        engine.add_stop_order(3, instrument, Side::Sell, 5, 0, 10, fills, OWN);
+        engine.add_stop_order(4, instrument, Side::Buy, 20, 21, 10, fills, OTHER);
+        engine.add_stop_order(5, other_instrument, Side::Buy, 20, 21, 10, fills, OWN);
+        check(engine.get_book(instrument)->get_stop_count() == 3, "stop orders of owners wait");
+
+        check(engine.mass_cancel(OWN, instrument) == 3, "mass_cancel counts the stop orders of the owner");
+        check(engine.get_order(1) == nullptr, "mass_cancel cancels the resting order");
+        check(engine.get_book(instrument)->get_stop_count() == 1, "mass_cancel takes stop orders out of the book");
+        check(engine.get_book(other_instrument)->get_stop_count() == 1, "mass_cancel of one instrument keeps others");
+
+        // the ids are free again, and nothing of the cancelled stops triggers
+        check(engine.add_stop_order(2, instrument, Side::Sell, 5, 0, 10, fills), "a cancelled stop's id is reused");
+        engine.add_order(6, instrument, Side::Sell, 20, 10, fills, OrderType::LIMIT, OTHER);
+        fills.clear();
+        check(engine.add_order(7, instrument, Side::Buy, 20, 10, fills), "a trade at the stop price is accepted");
+        check(fills.size() == 1 && engine.get_order(4) != nullptr, "only the foreign stop order triggers");
+
+        // a triggered stop order rests as an order of its owner
+        check(engine.mass_cancel(OTHER, instrument) == 1 && engine.get_order(4) == nullptr,
+              "a triggered stop order is cancelled with its owner");
+        check(engine.mass_cancel(OWN) == 1 && engine.get_book(other_instrument)->get_stop_count() == 0,
+              "mass_cancel of all instruments takes the stop orders of the owner");
+        check(engine.pull_order(2) && engine.get_book(instrument)->get_stop_count() == 0, "a stop order is pulled");
+    }
+
+    /**
+     * a triggered stop order matches with its owner and self-trade prevention, also once restored from a snapshot
+     */
+    void stop_with_self_trade_prevention() {
+        MatchingEngine engine;
+        vector<Fill> fills;
+        const InstrumentId instrument = engine.create_book("STOPS", 1);
+        engine.add_order(1, instrument, Side::Sell, 21, 10, fills, OrderType::LIMIT, OWN);
+        engine.add_order(2, instrument, Side::Sell, 22, 10, fills, OrderType::LIMIT, OTHER);
+        engine.add_stop_order(3, instrument, Side::Buy, 20, 22, 10, fills, OWN, StpMode::CANCEL_RESTING);
+
+        vector<char> image;
+        engine.snapshot(image);
+        vector<uint64_t> aligned((image.size() + 7) / 8);
+        const auto *const bytes = reinterpret_cast<const char *>(aligned.data());
+        std::copy(image.begin(), image.end(), reinterpret_cast<char *>(aligned.data()));
+
+        for (const bool restore: {false, true}) {
+            MatchingEngine restored;
+            check(!restore || restored.load_snapshot(bytes, image.size()), "a snapshot of an own stop order loads");
+            MatchingEngine &target = restore ? restored : engine;
+
+            // a trade at 20 triggers the stop order, which crosses the own ask at 21 before the foreign one at 22
+            target.add_order(4, instrument, Side::Sell, 20, 5, fills, OrderType::LIMIT, OTHER);
+            fills.clear();
+            check(target.add_order(5, instrument, Side::Buy, 20, 5, fills), "a trade at the stop price is accepted");
+            check(std::none_of(fills.begin(), fills.end(), [](const Fill &fill) {
+                return fill.type == Fill::TRADE && fill.aggressor_order_id == 3 && fill.other_owner == OWN;
+            }), "a triggered stop order doesn't trade with its owner");
+            check(target.get_order(1) == nullptr, "a triggered stop order cancels the own resting order");
+            check(target.get_order(2) == nullptr && target.get_order(3) == nullptr,
+                  "a triggered stop order trades the foreign order");
+        }
+
+        // a restored stop order is still its owner's
+        MatchingEngine restored;
+        restored.load_snapshot(bytes, image.size());
+        check(restored.mass_cancel(OWN) == 2 && restored.get_book(instrument)->get_stop_count() == 0,
+              "a restored stop order is cancelled with its owner");
+    }
+
+    /**
+     * a snapshot whose stop record has a side out of range is rejected as any other corrupt field
+     */
+    void snapshot_with_corrupt_stop_side() {
+        MatchingEngine engine;
+        vector<Fill> fills;
+        const InstrumentId instrument = engine.create_book("STOPS", 1);
+        engine.add_stop_order(1, instrument, Side::Buy, 20, 21, 10, fills);
+
+        vector<char> image;
+        engine.snapshot(image);
+        vector<uint64_t> aligned((image.size() + 7) / 8);
+        auto *const bytes = reinterpret_cast<char *>(aligned.data());
+        std::copy(image.begin(), image.end(), bytes);
+
+        MatchingEngine restored;
+        check(restored.load_snapshot(bytes, image.size()), "a snapshot with a stop order loads");
+
+        // the stop record is last in the image
+        bytes[image.size() - sizeof(Snapshot::StopRecord) + offsetof(Snapshot::StopRecord, side)] = 7;
+        MatchingEngine corrupt;
+        check(!corrupt.load_snapshot(bytes, image.size()), "a stop record of an unknown side is rejected");
+        check(corrupt.get_book(instrument) == nullptr, "a rejected snapshot leaves no book");
+    }
+}
+
+int main() {
+    fok_with_self_trade_prevention();
+    fok_against_iceberg_reserve();
+    amend_with_self_trade_prevention();
+    mass_cancel_with_stops();
+    stop_with_self_trade_prevention();
+    snapshot_with_corrupt_stop_side();
+
+    if (failures == 0) std::printf("matching_engine: passed\n");
+    return failures == 0 ? 0 : 1;
+}
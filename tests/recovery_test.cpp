@@ -0,0 +1,234 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "matching_engine.hpp"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    const OwnerId OWN = 1;
+    const OwnerId OTHER = 2;
+    const size_t CAPACITY = 4096;
+    const uint64_t LAST_ORDER_ID = 20;
+
+    /**
+     * copy a snapshot image into 8-byte aligned memory, as load_snapshot reads it in place
+     */
+    vector<uint64_t> aligned(const vector<char> &image) {
+        vector<uint64_t> words((image.size() + 7) / 8);
+        std::copy(image.begin(), image.end(), reinterpret_cast<char *>(words.data()));
+        return words;
+    }
+
+    bool same_depth(const MatchingEngine &live, const MatchingEngine &restored, InstrumentId instrument, Side side) {
+        DepthLevel expected[64];
+        DepthLevel actual[64];
+        const size_t count = live.get_depth(instrument, side, 64, expected);
+        if (restored.get_depth(instrument, side, 64, actual) != count) return false;
+        for (size_t i = 0; i < count; i++) {
+            if (expected[i].price != actual[i].price || expected[i].volume != actual[i].volume ||
+                expected[i].order_count != actual[i].order_count) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool same_order(const Order *expected, const Order *actual) {
+        if (expected == nullptr || actual == nullptr) return expected == actual;
+        return expected->price == actual->price && expected->volume == actual->volume &&
+               expected->side == actual->side && expected->owner == actual->owner &&
+               (expected->owner == 0 || expected->stp == actual->stp) && expected->iceberg == actual->iceberg &&
+               (!expected->iceberg || (expected->hidden == actual->hidden && expected->peak == actual->peak));
+    }
+
+    /**
+     * compare a recovered engine with the live one: books, depth, the order index and the snapshot they write
+     */
+    void compare(const MatchingEngine &live, const MatchingEngine &restored, const char *what) {
+        char message[128];
+        std::snprintf(message, sizeof(message), "%s is at the live sequence", what);
+        check(restored.get_sequence() == live.get_sequence(), message);
+
+        for (const char *symbol: {"AAA", "BBB"}) {
+            const InstrumentId instrument = live.get_instrument_id(symbol);
+            const Book *const expected = live.get_book(instrument);
+            const Book *const actual = restored.get_book(restored.get_instrument_id(symbol));
+            std::snprintf(message, sizeof(message), "%s has book %s", what, symbol);
+            check(actual != nullptr && restored.get_instrument_id(symbol) == instrument, message);
+            if (actual == nullptr) continue;
+
+            std::snprintf(message, sizeof(message), "%s has the depth of %s", what, symbol);
+            check(same_depth(live, restored, instrument, Side::Buy) &&
+                  same_depth(live, restored, instrument, Side::Sell), message);
+            std::snprintf(message, sizeof(message), "%s has the reserve, stops and phase of %s", what, symbol);
+            check(expected->get_hidden_volume(Side::Buy) == actual->get_hidden_volume(Side::Buy) &&
+                  expected->get_hidden_volume(Side::Sell) == actual->get_hidden_volume(Side::Sell) &&
+                  expected->get_stop_count() == actual->get_stop_count() &&
+                  live.get_phase(instrument) == restored.get_phase(instrument), message);
+        }
+
+        bool same_index = true;
+        for (uint64_t order_id = 1; order_id <= LAST_ORDER_ID; order_id++) {
+            same_index = same_index && same_order(live.get_order(order_id), restored.get_order(order_id));
+        }
+        std::snprintf(message, sizeof(message), "%s indexes the live orders", what);
+        check(same_index, message);
+
+        vector<char> expected_image;
+        vector<char> actual_image;
+        live.snapshot(expected_image);
+        restored.snapshot(actual_image);
+        std::snprintf(message, sizeof(message), "%s writes the live snapshot", what);
+        check(expected_image == actual_image, message);
+    }
+
+    /**
+     * the commands before the snapshot: icebergs, owners of every StpMode, stop orders of owners, an amend in
+     * place and a trade that refreshes an iceberg and triggers a stop
+     */
+    void before_snapshot(MatchingEngine &engine, InstrumentId a, InstrumentId b) {
+        vector<Fill> fills;
+        check(engine.add_order(1, a, Side::Sell, 101, 100, fills, OrderType::LIMIT, OWN, StpMode::CANCEL_RESTING,
+                               10) &&
+              engine.add_order(2, a, Side::Sell, 102, 50, fills, OrderType::LIMIT, OTHER) &&
+              engine.add_order(3, a, Side::Buy, 99, 40, fills, OrderType::LIMIT, OWN, StpMode::DECREMENT_BOTH) &&
+              engine.add_order(4, a, Side::Buy, 98, 30, fills) &&
+              engine.add_order(5, b, Side::Sell, 505, 20, fills, OrderType::LIMIT, OTHER, StpMode::NONE, 5) &&
+              engine.add_order(6, b, Side::Buy, 495, 20, fills, OrderType::LIMIT, OWN, StpMode::CANCEL_AGGRESSOR),
+              "the resting orders are accepted");
+        check(engine.add_stop_order(7, a, Side::Buy, 101, 102, 30, fills, OWN, StpMode::CANCEL_RESTING) &&
+              engine.add_stop_order(8, a, Side::Sell, 98, 0, 10, fills, OTHER) &&
+              engine.add_stop_order(9, b, Side::Buy, 505, 510, 10, fills, OWN, StpMode::DECREMENT_BOTH),
+              "the stop orders are accepted");
+        check(engine.amend_order(3, 99, 20, fills), "an amend in place is accepted");
+        fills.clear();
+        check(engine.add_order(10, a, Side::Buy, 101, 15, fills, OrderType::LIMIT, OTHER) && !fills.empty(),
+              "an order trading an iceberg is accepted");
+    }
+
+    /**
+     * the commands journaled after the snapshot: a repriced amend triggering a stop, an auction and its uncross,
+     * a pull, a mass_cancel and more icebergs and stops
+     */
+    void after_snapshot(MatchingEngine &engine, InstrumentId a, InstrumentId b) {
+        vector<Fill> fills;
+        check(engine.amend_order(6, 505, 20, fills) && !fills.empty(), "a repriced amend trades");
+        check(engine.set_phase(a, TradingPhase::AUCTION, fills) &&
+              engine.add_order(11, a, Side::Buy, 103, 5, fills) &&
+              engine.add_order(12, a, Side::Sell, 97, 5, fills, OrderType::LIMIT, OTHER) &&
+              engine.set_phase(a, TradingPhase::CONTINUOUS, fills), "an auction is accepted");
+        check(engine.pull_order(4), "a pull is accepted");
+        check(engine.add_order(16, b, Side::Sell, 520, 10, fills, OrderType::LIMIT, OTHER) &&
+              engine.add_stop_order(17, b, Side::Sell, 480, 0, 5, fills, OTHER) && engine.mass_cancel(OTHER, b) == 2,
+              "a mass_cancel of resting and stop orders is accepted");
+        check(engine.add_order(13, a, Side::Sell, 100, 25, fills, OrderType::LIMIT, OWN, StpMode::CANCEL_AGGRESSOR,
+                               5) && engine.add_stop_order(14, a, Side::Sell, 90, 89, 5, fills, OWN) &&
+              engine.amend_order(13, 100, 3, fills), "an iceberg and a stop order are accepted");
+    }
+
+    /**
+     * run the same commands on two engines, the fills and what they cancel must be the same
+     */
+    void carry_on(MatchingEngine &live, MatchingEngine &restored, InstrumentId a, const char *what) {
+        vector<Fill> expected;
+        vector<Fill> actual;
+        live.add_order(15, a, Side::Buy, 102, 60, expected, OrderType::LIMIT, OTHER);
+        restored.add_order(15, a, Side::Buy, 102, 60, actual, OrderType::LIMIT, OTHER);
+        bool same_fills = expected.size() == actual.size();
+        for (size_t i = 0; same_fills && i < expected.size(); i++) {
+            same_fills = std::memcmp(&expected[i], &actual[i], sizeof(Fill)) == 0;
+        }
+        char message[128];
+        std::snprintf(message, sizeof(message), "%s fills as the live engine", what);
+        check(same_fills, message);
+        std::snprintf(message, sizeof(message), "%s cancels the orders of an owner as the live engine", what);
+        check(live.mass_cancel(OWN) == restored.mass_cancel(OWN), message);
+        compare(live, restored, what);
+    }
+}
+
+int main() {
+    const string path = "/tmp/matching_engine_recovery_test." + std::to_string(getpid()) + ".journal";
+    std::remove(path.c_str());
+
+    // the live engine journals everything, book creation included
+    Journal journal;
+    check(journal.open(path, CAPACITY, std::chrono::microseconds(1000)), "the journal opens");
+    MatchingEngine live;
+    check(live.set_journal(&journal), "the journal is attached");
+    const InstrumentId a = live.create_book("AAA", 1);
+    const InstrumentId b = live.create_book("BBB", 5);
+    before_snapshot(live, a, b);
+
+    vector<char> image;
+    live.snapshot(image);
+    const uint64_t snapshot_sequence = live.get_sequence();
+    after_snapshot(live, a, b);
+    check(live.get_sequence() > snapshot_sequence && journal.last_sequence() == live.get_sequence(),
+          "every accepted command is journaled");
+
+    // group commit catches up with the last command without a flush per command
+    for (int round = 0; round < 2000 && journal.durable_sequence() < live.get_sequence(); round++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(journal.durable_sequence() == live.get_sequence(), "group commit makes every command durable");
+    {
+        std::ifstream file(path, std::ios::binary);
+        vector<JournalRecord> records(journal.size());
+        file.read(reinterpret_cast<char *>(records.data()), (std::streamsize) (records.size() * sizeof(JournalRecord)));
+        bool consecutive = file.good();
+        for (size_t i = 0; consecutive && i < records.size(); i++) consecutive = records[i].sequence == i + 1;
+        check(consecutive, "the journal file holds every durable record in sequence");
+    }
+    live.set_journal(nullptr);
+    journal.close();
+
+    // recovery: the snapshot, then the journal past it
+    Journal reopened;
+    check(reopened.open(path, CAPACITY) && reopened.size() == live.get_sequence(), "the journal reopens whole");
+    const vector<uint64_t> words = aligned(image);
+    MatchingEngine restored;
+    check(restored.load_snapshot(reinterpret_cast<const char *>(words.data()), image.size()) &&
+          restored.get_sequence() == snapshot_sequence, "the snapshot loads at its sequence");
+    check(restored.replay_journal(reopened), "the journal replays past the snapshot");
+    compare(live, restored, "the engine restored from a snapshot");
+
+    // recovery from the journal alone
+    MatchingEngine replayed;
+    check(replayed.replay_journal(reopened), "the journal replays from the start");
+    compare(live, replayed, "the engine replayed from the journal");
+    reopened.close();
+
+    // both recovered engines carry on exactly as the live one
+    MatchingEngine live_copy;
+    vector<char> live_image;
+    live.snapshot(live_image);
+    const vector<uint64_t> live_words = aligned(live_image);
+    check(live_copy.load_snapshot(reinterpret_cast<const char *>(live_words.data()), live_image.size()),
+          "the live engine's snapshot loads");
+    carry_on(live_copy, restored, a, "the engine restored from a snapshot");
+    carry_on(live, replayed, a, "the engine replayed from the journal");
+
+    std::remove(path.c_str());
+
+    if (failures == 0) std::printf("recovery: passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <cstdio>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sharded_engine.hpp"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    /**
+     * what an event must be, in the order it must arrive
+     */
+    struct Expected {
+        ShardEvent::Type type;
+        InstrumentId instrument;
+        uint64_t order_id;
+        int64_t other_remaining_volume;     // of a fill
+    };
+
+    bool matches(const ShardEvent &event, const Expected &expected) {
+        return event.type == expected.type && event.instrument == expected.instrument &&
+               event.order_id == expected.order_id &&
+               (event.type != ShardEvent::FILL || event.fill.other_remaining_volume == expected.other_remaining_volume);
+    }
+
+    /**
+     * queue a resting sell, then one buy of 1 per unit of it and a pull once it's gone, on one producer slot
+     * @return the events they must produce, in order
+     */
+    vector<Expected> sweep(ShardedEngine &engine, size_t producer, InstrumentId instrument, uint64_t first_id,
+                           int64_t volume) {
+        vector<Expected> expected;
+        check(engine.add_order(producer, first_id, instrument, Side::Sell, 10, volume), "a resting order is queued");
+        for (int64_t i = 1; i <= volume; i++) {
+            check(engine.add_order(producer, first_id + i, instrument, Side::Buy, 10, 1), "a buy is queued");
+            expected.push_back({ShardEvent::FILL, instrument, first_id + (uint64_t) i, volume - i});
+        }
+        check(engine.pull_order(producer, instrument, first_id), "a pull is queued");
+        expected.push_back({ShardEvent::REJECTED, instrument, first_id, 0});
+        return expected;
+    }
+
+    bool in_order(const vector<ShardEvent> &events, const vector<Expected> &expected) {
+        if (events.size() != expected.size()) return false;
+        for (size_t i = 0; i < events.size(); i++) {
+            if (!matches(events[i], expected[i])) return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    ShardedEngineConfig config;
+    config.shards = 2;
+    config.producers = 2;
+    config.queue_capacity = 1024;
+    ShardedEngine engine(config);
+    const InstrumentId a = engine.create_book(0, "A", 1);
+    const InstrumentId b = engine.create_book(0, "B", 1);
+    const InstrumentId c = engine.create_book(1, "C", 1);
+    check(engine.get_shard(a) == 0 && engine.get_shard(b) == 0 && engine.get_shard(c) == 1, "books are placed");
+    engine.start();
+
+    // A and B share shard 0 and producer slot 0, their commands interleaved; C is alone on shard 1 and slot 1
+    vector<Expected> expected_a, expected_b, expected_shard;
+    for (int round = 0; round < 4; round++) {
+        const uint64_t base = 1000 * (round + 1);
+        const vector<Expected> sweep_a = sweep(engine, 0, a, base, 20);
+        const vector<Expected> sweep_b = sweep(engine, 0, b, base + 100, 5);
+        expected_a.insert(expected_a.end(), sweep_a.begin(), sweep_a.end());
+        expected_b.insert(expected_b.end(), sweep_b.begin(), sweep_b.end());
+        expected_shard.insert(expected_shard.end(), sweep_a.begin(), sweep_a.end());
+        expected_shard.insert(expected_shard.end(), sweep_b.begin(), sweep_b.end());
+    }
+    const vector<Expected> expected_c = sweep(engine, 1, c, 1, 50);
+
+    // drain a few events at a time, so both shards interleave
+    vector<ShardEvent> shard_events, events_a, events_b, events_c;
+    const size_t total = expected_shard.size() + expected_c.size();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (shard_events.size() + events_c.size() < total && std::chrono::steady_clock::now() < deadline) {
+        const size_t handled = engine.poll_events([&](const ShardEvent &event) {
+            if (event.instrument == c) {
+                events_c.push_back(event);
+                return;
+            }
+            shard_events.push_back(event);
+            (event.instrument == a ? events_a : events_b).push_back(event);
+        }, 3);
+        if (handled == 0) std::this_thread::yield();
+    }
+    engine.stop();
+
+    check(shard_events.size() + events_c.size() == total, "every event arrives");
+    check(in_order(events_a, expected_a) && in_order(events_b, expected_b) && in_order(events_c, expected_c),
+          "the events of an instrument arrive in the order its commands were queued, fills before a later reject");
+    check(in_order(shard_events, expected_shard),
+          "the events of a shard arrive in the order the commands of one producer slot were queued");
+
+    if (failures == 0) std::printf("sharded_engine: passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1071 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "matching_engine.hpp"
+
+/**
+ * Differential testing of MatchingEngine against a deliberately naive reference matcher\n
+ * \n
+ * A Harness decodes a command stream from raw bytes, so any byte string is a valid test case: matching_engine_fuzz
+ * feeds it seeded random bytes, matching_engine_libfuzzer lets a coverage-guided fuzzer pick them\n
+ * Every command runs on both engines; the return value, every Fill, and the BestBidOffer, order count, reserve
+ * volume, stop order count and depth of every instrument are compared after each one, and so is the L2 book a
+ * consumer builds from the level deltas the engine published; the first difference stops the run\n
+ * The same stream also runs on a third MatchingEngine, which takes the adds, amends and pulls through
+ * process_batch, in batches cut by every other command; each batch must return and fill as the engine did one
+ * command at a time, and leave the same books\n
+ * \n
+ * Covered: add_order of every OrderType, with owners and every StpMode, and with peak for iceberg orders;
+ * amend_order in place and repriced; pull_order of resting and stop orders; add_stop_order, limit and market, with
+ * owners, and the stops triggered by any command; set_phase into and out of auctions, and the uncross; mass_cancel
+ * of resting and stop orders, of one instrument and of all; three instruments of different units; rejected
+ * commands, negative, zero and off-unit prices and volumes, reused order ids\n
+ * Not covered: snapshots and the journal, see tests/recovery_test.cpp\n
+ */
+namespace Differential {
+    /**
+     * Reads a command stream, reading past the end yields zeroes
+     */
+    class ByteReader {
+    private:
+        const uint8_t *cursor;
+        const uint8_t *const end;
+
+    public:
+        ByteReader(const uint8_t *data, size_t size) : cursor{data}, end{data + size} {};
+
+        bool empty() const { return this->cursor >= this->end; }
+
+        uint8_t byte() { return this->cursor < this->end ? *this->cursor++ : 0; }
+
+        uint16_t word() {
+            const uint16_t low = this->byte();
+            return (uint16_t) (low | (this->byte() << 8));
+        }
+    };
+
+    /**
+     * The price-time priority matcher MatchingEngine must agree with: an ordered map of FIFO queues per side, in
+     * API prices; no ticks, no pools, no intrusive lists, no owner lists, nothing cached, every count and volume is
+     * summed up when asked for\n
+     * it validates its arguments the way MatchingEngine documents it, see MatchingEngine::add_order
+     */
+    class ReferenceEngine {
+    private:
+        struct RestingOrder {
+            uint64_t order_id;
+            int64_t volume;     // displayed
+            OwnerId owner;
+            StpMode stp;        // matched with again when repriced
+            int64_t hidden;     // reserve of an iceberg order
+            int64_t peak;       // 0 if not an iceberg order
+        };
+
+        using Levels = std::map<int64_t, std::deque<RestingOrder>>;
+
+        struct Book {
+            int64_t unit;
+            bool auction = false;
+            int64_t last_price = 0;     // of the last trade, 0 before the first one
+            Levels bids;
+            Levels asks;
+            Levels buy_stops;           // stop price - stop orders, price and volume as they match once triggered
+            Levels sell_stops;
+
+            explicit Book(int64_t unit) : unit{unit} {}
+
+            Levels &side_of(Side side) { return side == Side::Buy ? this->bids : this->asks; }
+
+            const Levels &side_of(Side side) const { return side == Side::Buy ? this->bids : this->asks; }
+        };
+
+        struct Location {
+            InstrumentId instrument;
+            Side side;
+            int64_t price;      // stop price of a stop order
+        };
+
+        struct StopOrder {
+            Location location;
+            int64_t price;      // 0 for a stop-market order
+        };
+
+        vector<Book> books = vector<Book>(1, Book(0));     // indexed by instrument id, 0 is never valid
+        std::unordered_map<uint64_t, Location> orders;
+        std::unordered_map<uint64_t, StopOrder> stops;
+
+        /**
+         * check whether an incoming order accepts a resting price
+         */
+        static bool acceptable(Side side, int64_t resting_price, int64_t limit) {
+            return (side == Side::Buy) ? resting_price <= limit : resting_price >= limit;
+        }
+
+        static Side opposite(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+
+        /**
+         * display the next peak of an iceberg order whose volume traded out
+         * @return True if it was refreshed, and so belongs at the back of its queue
+         */
+        static bool refresh(RestingOrder &order) {
+            if (order.volume != 0 || order.hidden == 0) return false;
+            order.volume = order.hidden < order.peak ? order.hidden : order.peak;
+            order.hidden -= order.volume;
+            return true;
+        }
+
+        /**
+         * find a resting order in its queue
+         */
+        RestingOrder &find(uint64_t order_id, const Location &location) {
+            for (RestingOrder &order: this->books[location.instrument].side_of(location.side)[location.price]) {
+                if (order.order_id == order_id) return order;
+            }
+            __builtin_unreachable();
+        }
+
+        /**
+         * remove a resting order from its queue
+         */
+        void erase(uint64_t order_id, const Location &location) {
+            auto &levels = this->books[location.instrument].side_of(location.side);
+            auto level = levels.find(location.price);
+            for (auto it = level->second.begin(); it != level->second.end(); it++) {
+                if (it->order_id == order_id) {
+                    level->second.erase(it);
+                    break;
+                }
+            }
+            if (level->second.empty()) levels.erase(level);
+            this->orders.erase(order_id);
+        }
+
+        /**
+         * trade an incoming order against the opposite side, best price first, FIFO within a price; only touches
+         * book, the caller forgets the resting orders the fills report gone
+         * @param market True to accept any price
+         * @return volume left, neither traded nor cancelled
+         */
+        static int64_t match(Book &book, Side side, int64_t limit, bool market, int64_t volume, uint64_t aggressor_id,
+                             OwnerId owner, StpMode stp, vector<Fill> &fills) {
+            const bool prevent = (owner != 0 && stp != StpMode::NONE);
+            auto &levels = book.side_of(opposite(side));
+            while (volume > 0 && !levels.empty()) {
+                auto level = (side == Side::Buy) ? levels.begin() : std::prev(levels.end());
+                if (!market && !acceptable(side, level->first, limit)) break;
+
+                auto &queue = level->second;
+                RestingOrder &resting = queue.front();
+                bool refreshed = false;
+                if (prevent && resting.owner == owner) {
+                    if (stp == StpMode::CANCEL_AGGRESSOR) {
+                        fills.push_back(Fill{resting.order_id, level->first, 0, aggressor_id, 0, resting.volume,
+                                             Fill::SELF_TRADE_PREVENTED, resting.owner});
+                        return 0;
+                    }
+                    const int64_t cancelled = (stp == StpMode::CANCEL_RESTING || resting.volume < volume)
+                                              ? resting.volume : volume;
+                    resting.volume -= cancelled;
+                    if (stp == StpMode::DECREMENT_BOTH) volume -= cancelled;
+                    if (resting.volume == 0) resting.hidden = 0;    // cancelled with its reserve
+                    fills.push_back(Fill{resting.order_id, level->first, cancelled, aggressor_id, volume,
+                                         resting.volume, Fill::SELF_TRADE_PREVENTED, resting.owner});
+                } else {
+                    const int64_t traded = resting.volume < volume ? resting.volume : volume;
+                    resting.volume -= traded;
+                    volume -= traded;
+                    book.last_price = level->first;
+                    refreshed = refresh(resting);
+                    fills.push_back(Fill{resting.order_id, level->first, traded, aggressor_id, volume,
+                                         resting.volume, Fill::TRADE, resting.owner});
+                }
+
+                if (refreshed) {
+                    queue.push_back(queue.front());
+                    queue.pop_front();
+                } else if (resting.volume == 0) {
+                    queue.pop_front();
+                    if (queue.empty()) levels.erase(level);
+                }
+            }
+            return volume;
+        }
+
+        /**
+         * match on an instrument's book, forgetting the resting orders filled or cancelled
+         */
+        int64_t execute(InstrumentId instrument, Side side, int64_t limit, bool market, int64_t volume,
+                        uint64_t aggressor_id, OwnerId owner, StpMode stp, vector<Fill> &fills) {
+            const size_t first = fills.size();
+            const int64_t remaining = match(this->books[instrument], side, limit, market, volume, aggressor_id, owner,
+                                            stp, fills);
+            for (size_t i = first; i < fills.size(); i++) {
+                if (fills[i].other_remaining_volume == 0) this->orders.erase(fills[i].other_order_id);
+            }
+            return remaining;
+        }
+
+        /**
+         * rest an order at the back of its price, displaying one peak of an iceberg order
+         */
+        void rest(InstrumentId instrument, uint64_t order_id, Side side, int64_t price, int64_t volume, OwnerId owner,
+                  StpMode stp, int64_t peak) {
+            RestingOrder order{order_id, volume, owner, stp, 0, 0};
+            if (peak > 0 && volume > peak) order = RestingOrder{order_id, peak, owner, stp, volume - peak, peak};
+            this->books[instrument].side_of(side)[price].push_back(order);
+            this->orders[order_id] = Location{instrument, side, price};
+        }
+
+        /**
+         * match every stop order the last trade price reached, Buy stops first, nearest stop price first, FIFO
+         * within a stop price, until none is left; each with the owner and self-trade prevention it was added with
+         */
+        void trigger(InstrumentId instrument, vector<Fill> &fills) {
+            Book &book = this->books[instrument];
+            while (!book.auction && book.last_price != 0) {
+                Levels *levels;
+                Levels::iterator level;
+                if (!book.buy_stops.empty() && book.buy_stops.begin()->first <= book.last_price) {
+                    levels = &book.buy_stops;
+                    level = book.buy_stops.begin();
+                } else if (!book.sell_stops.empty() && book.sell_stops.rbegin()->first >= book.last_price) {
+                    levels = &book.sell_stops;
+                    level = std::prev(book.sell_stops.end());
+                } else {
+                    return;
+                }
+
+                const RestingOrder triggered = level->second.front();
+                level->second.pop_front();
+                if (level->second.empty()) levels->erase(level);
+                const StopOrder stop = this->stops.at(triggered.order_id);
+                this->stops.erase(triggered.order_id);
+
+                const int64_t remaining = this->execute(instrument, stop.location.side, stop.price, stop.price == 0,
+                                                        triggered.volume, triggered.order_id, triggered.owner,
+                                                        triggered.stp, fills);
+                if (remaining > 0 && stop.price != 0) {
+                    this->rest(instrument, triggered.order_id, stop.location.side, stop.price, remaining,
+                               triggered.owner, triggered.stp, 0);
+                }
+            }
+        }
+
+        /**
+         * requeue the front order of a level if it was refreshed, or forget it if it traded out
+         */
+        void settle(Levels &levels, Levels::iterator level, bool refreshed) {
+            auto &queue = level->second;
+            if (refreshed) {
+                queue.push_back(queue.front());
+                queue.pop_front();
+            } else if (queue.front().volume == 0) {
+                this->orders.erase(queue.front().order_id);
+                queue.pop_front();
+                if (queue.empty()) levels.erase(level);
+            }
+        }
+
+        /**
+         * find the equilibrium price of a crossed book as MatchingEngine documents it, by trying every price a
+         * displayed order of the crossed range rests at
+         * @return executable volume, 0 if not crossed
+         */
+        static int64_t equilibrium(const Book &book, int64_t &price) {
+            price = 0;
+            if (book.bids.empty() || book.asks.empty()) return 0;
+            const int64_t low = book.asks.begin()->first;
+            const int64_t high = book.bids.rbegin()->first;
+            if (high < low) return 0;
+
+            std::set<int64_t> candidates;
+            for (const auto &level: book.bids) if (level.first >= low) candidates.insert(level.first);
+            for (const auto &level: book.asks) if (level.first <= high) candidates.insert(level.first);
+
+            int64_t best_executable = -1, best_surplus = 0;
+            for (const int64_t candidate: candidates) {
+                int64_t bids = 0, asks = 0;
+                for (const auto &level: book.bids) {
+                    for (const RestingOrder &order: level.second) bids += (level.first >= candidate) ? order.volume : 0;
+                }
+                for (const auto &level: book.asks) {
+                    for (const RestingOrder &order: level.second) asks += (level.first <= candidate) ? order.volume : 0;
+                }
+                const int64_t executable = bids < asks ? bids : asks;
+                const int64_t surplus = bids - asks;
+                const int64_t imbalance = surplus < 0 ? -surplus : surplus;
+                const int64_t best_imbalance = best_surplus < 0 ? -best_surplus : best_surplus;
+                if (executable > best_executable ||
+                    (executable == best_executable &&
+                     (imbalance < best_imbalance || (imbalance == best_imbalance && surplus > 0)))) {
+                    best_executable = executable;
+                    best_surplus = surplus;
+                    price = candidate;
+                }
+            }
+            return best_executable;
+        }
+
+        /**
+         * execute the crossed part of a book at its equilibrium price, best Buy against best Sell, FIFO within a
+         * price
+         */
+        void uncross(InstrumentId instrument, vector<Fill> &fills) {
+            Book &book = this->books[instrument];
+            int64_t price;
+            for (int64_t volume = equilibrium(book, price); volume > 0;) {
+                auto buy_level = std::prev(book.bids.end());
+                auto sell_level = book.asks.begin();
+                RestingOrder &buy = buy_level->second.front();
+                RestingOrder &sell = sell_level->second.front();
+                int64_t traded = buy.volume < sell.volume ? buy.volume : sell.volume;
+                if (volume < traded) traded = volume;
+                volume -= traded;
+                buy.volume -= traded;
+                sell.volume -= traded;
+                const bool buy_refreshed = refresh(buy);
+                const bool sell_refreshed = refresh(sell);
+                fills.push_back(Fill{sell.order_id, price, traded, buy.order_id, buy.volume, sell.volume,
+                                     Fill::UNCROSS, sell.owner});
+                book.last_price = price;
+
+                this->settle(book.bids, buy_level, buy_refreshed);
+                this->settle(book.asks, sell_level, sell_refreshed);
+            }
+        }
+
+        bool valid(InstrumentId instrument) const { return instrument != 0 && instrument < this->books.size(); }
+
+    public:
+        InstrumentId create_book(int64_t unit) {
+            this->books.emplace_back(unit);
+            return (InstrumentId) (this->books.size() - 1);
+        }
+
+        bool add_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t price, int64_t volume,
+                       vector<Fill> &fills, OrderType type, OwnerId owner, StpMode stp, int64_t peak) {
+            const bool market = (type == OrderType::MARKET);
+            if (order_id == 0 || this->orders.count(order_id) != 0 || this->stops.count(order_id) != 0) return false;
+            if ((price <= 0 && !market) || volume <= 0) return false;
+            if (peak < 0 || (peak > 0 && type != OrderType::LIMIT)) return false;
+            if (!this->valid(instrument)) return false;
+            Book &book = this->books[instrument];
+            if (!market && price % book.unit != 0) return false;
+            if (book.auction && type != OrderType::LIMIT) return false;
+
+            const auto &resting = book.side_of(opposite(side));
+            if (type == OrderType::POST_ONLY && !resting.empty()) {
+                const int64_t best = (side == Side::Buy) ? resting.begin()->first : resting.rbegin()->first;
+                if (acceptable(side, best, price)) return false;
+            }
+            if (type == OrderType::FOK) {
+                // all or none: match on a copy, every share must trade before self-trade prevention cancels any
+                Book copy = book;
+                vector<Fill> trial;
+                match(copy, side, price, false, volume, order_id, owner, stp, trial);
+                int64_t traded = 0;
+                for (const Fill &fill: trial) traded += (fill.type == Fill::TRADE) ? fill.trade_volume : 0;
+                if (traded < volume) return false;
+            }
+
+            const int64_t remaining = (type != OrderType::POST_ONLY && !book.auction)
+                                      ? this->execute(instrument, side, price, market, volume, order_id, owner, stp,
+                                                      fills)
+                                      : volume;
+            if (remaining > 0 && (type == OrderType::LIMIT || type == OrderType::POST_ONLY)) {
+                this->rest(instrument, order_id, side, price, remaining, owner, stp, peak);
+            }
+            this->trigger(instrument, fills);
+            return true;
+        }
+
+        bool add_stop_order(uint64_t order_id, InstrumentId instrument, Side side, int64_t stop_price, int64_t price,
+                            int64_t volume, vector<Fill> &fills, OwnerId owner, StpMode stp) {
+            if (order_id == 0 || this->orders.count(order_id) != 0 || this->stops.count(order_id) != 0) return false;
+            if (stop_price <= 0 || price < 0 || volume <= 0) return false;
+            if (!this->valid(instrument)) return false;
+            Book &book = this->books[instrument];
+            if (stop_price % book.unit != 0 || price % book.unit != 0) return false;
+
+            auto &stop_levels = (side == Side::Buy) ? book.buy_stops : book.sell_stops;
+            stop_levels[stop_price].push_back(RestingOrder{order_id, volume, owner, stp, 0, 0});
+            this->stops[order_id] = StopOrder{Location{instrument, side, stop_price}, price};
+            this->trigger(instrument, fills);
+            return true;
+        }
+
+        bool amend_order(uint64_t order_id, int64_t new_price, int64_t new_volume, vector<Fill> &fills) {
+            auto it = this->orders.find(order_id);
+            if (it == this->orders.end()) return false;
+            if (new_price <= 0 || new_volume <= 0) return false;
+            const Location location = it->second;
+            Book &book = this->books[location.instrument];
+            if (new_price % book.unit != 0) return false;
+
+            RestingOrder &resting = this->find(order_id, location);
+
+            // same price and no more volume keeps priority, anything else re-enters as a new order under the same id,
+            // with its reserve, its peak, its owner and its self-trade prevention
+            if (new_price == location.price && resting.volume >= new_volume) {
+                resting.volume = new_volume;
+                return true;
+            }
+            const RestingOrder amended = resting;
+            this->erase(order_id, location);
+            const int64_t volume = new_volume + amended.hidden;
+            const int64_t remaining = !book.auction
+                                      ? this->execute(location.instrument, location.side, new_price, false, volume,
+                                                      order_id, amended.owner, amended.stp, fills)
+                                      : volume;
+            if (remaining > 0) {
+                // an iceberg order shows at most one peak, even if it was amended to show more
+                const int64_t shown = (amended.peak > 0 && remaining > amended.peak) ? amended.peak : remaining;
+                book.side_of(location.side)[new_price].push_back(
+                        RestingOrder{order_id, shown, amended.owner, amended.stp, remaining - shown, amended.peak});
+                this->orders[order_id] = Location{location.instrument, location.side, new_price};
+            }
+            this->trigger(location.instrument, fills);
+            return true;
+        }
+
+        bool pull_order(uint64_t order_id) {
+            auto it = this->orders.find(order_id);
+            if (it != this->orders.end()) {
+                this->erase(order_id, Location{it->second});
+                return true;
+            }
+            auto stop = this->stops.find(order_id);
+            if (stop == this->stops.end()) return false;
+            const Location location = stop->second.location;
+            Book &book = this->books[location.instrument];
+            auto &stop_levels = (location.side == Side::Buy) ? book.buy_stops : book.sell_stops;
+            auto level = stop_levels.find(location.price);
+            for (auto order = level->second.begin(); order != level->second.end(); order++) {
+                if (order->order_id == order_id) {
+                    level->second.erase(order);
+                    break;
+                }
+            }
+            if (level->second.empty()) stop_levels.erase(level);
+            this->stops.erase(stop);
+            return true;
+        }
+
+        size_t mass_cancel(OwnerId owner, InstrumentId instrument) {
+            if (owner == 0 || (instrument != 0 && !this->valid(instrument))) return 0;
+            vector<uint64_t> cancelled;
+            for (InstrumentId i = 1; i < this->books.size(); i++) {
+                if (instrument != 0 && i != instrument) continue;
+                Book &book = this->books[i];
+                for (const Levels *levels: {&book.bids, &book.asks, &book.buy_stops, &book.sell_stops}) {
+                    for (const auto &level: *levels) {
+                        for (const RestingOrder &order: level.second) {
+                            if (order.owner == owner) cancelled.push_back(order.order_id);
+                        }
+                    }
+                }
+            }
+            for (const uint64_t order_id: cancelled) this->pull_order(order_id);
+            return cancelled.size();
+        }
+
+        bool set_phase(InstrumentId instrument, TradingPhase phase, vector<Fill> &fills) {
+            if (!this->valid(instrument)) return false;
+            Book &book = this->books[instrument];
+            if (book.auction == (phase == TradingPhase::AUCTION)) return false;
+
+            book.auction = (phase == TradingPhase::AUCTION);
+            if (!book.auction) {
+                this->uncross(instrument, fills);
+                this->trigger(instrument, fills);
+            }
+            return true;
+        }
+
+        /**
+         * get the price and displayed volume of a resting order
+         * @return False if the order doesn't rest, nothing is written
+         */
+        bool get_order(uint64_t order_id, int64_t &price, int64_t &volume) {
+            auto it = this->orders.find(order_id);
+            if (it == this->orders.end()) return false;
+            volume = this->find(order_id, it->second).volume;
+            price = it->second.price;
+            return true;
+        }
+
+        BestBidOffer get_top_of_book(InstrumentId instrument) const {
+            const Book &book = this->books[instrument];
+            BestBidOffer top{};
+            if (!book.bids.empty()) {
+                top.bid_price = book.bids.rbegin()->first;
+                for (const RestingOrder &order: book.bids.rbegin()->second) top.bid_volume += order.volume;
+            }
+            if (!book.asks.empty()) {
+                top.ask_price = book.asks.begin()->first;
+                for (const RestingOrder &order: book.asks.begin()->second) top.ask_volume += order.volume;
+            }
+            return top;
+        }
+
+        size_t get_order_count(InstrumentId instrument) const {
+            size_t count = 0;
+            for (const Levels *levels: {&this->books[instrument].bids, &this->books[instrument].asks}) {
+                for (const auto &level: *levels) count += level.second.size();
+            }
+            return count;
+        }
+
+        int64_t get_hidden_volume(InstrumentId instrument, Side side) const {
+            int64_t hidden = 0;
+            for (const auto &level: this->books[instrument].side_of(side)) {
+                for (const RestingOrder &order: level.second) hidden += order.hidden;
+            }
+            return hidden;
+        }
+
+        /**
+         * get the instrument of a resting or stop order
+         * @return 0 if the order neither rests nor waits
+         */
+        InstrumentId get_instrument(uint64_t order_id) const {
+            auto resting = this->orders.find(order_id);
+            if (resting != this->orders.end()) return resting->second.instrument;
+            auto stop = this->stops.find(order_id);
+            return stop != this->stops.end() ? stop->second.location.instrument : 0;
+        }
+
+        /**
+         * get every level of a side, from the touch outward
+         */
+        void get_depth(InstrumentId instrument, Side side, vector<DepthLevel> &out) const {
+            out.clear();
+            auto aggregate = [&out](const auto &level) {
+                DepthLevel depth{level.first, 0, level.second.size()};
+                for (const RestingOrder &order: level.second) depth.volume += order.volume;
+                out.push_back(depth);
+            };
+            const Levels &levels = this->books[instrument].side_of(side);
+            if (side == Side::Buy) {
+                for (auto level = levels.rbegin(); level != levels.rend(); level++) aggregate(*level);
+            } else {
+                for (auto level = levels.begin(); level != levels.end(); level++) aggregate(*level);
+            }
+        }
+
+        size_t get_stop_count(InstrumentId instrument) const {
+            size_t count = 0;
+            for (const Levels *levels: {&this->books[instrument].buy_stops, &this->books[instrument].sell_stops}) {
+                for (const auto &level: *levels) count += level.second.size();
+            }
+            return count;
+        }
+    };
+
+    /**
+     * Runs one command stream on a fresh MatchingEngine and a fresh ReferenceEngine side by side, and on a
+     * MatchingEngine fed through process_batch\n
+     * \n
+     * Command encoding, every command is COMMAND_SIZE bytes, missing bytes read as 0:\n
+     * - op, modulo 16: 0-6 and 15 add_order, 7-8 pull_order, 9-11 amend_order, 12 add_stop_order, 13 mass_cancel,
+     *   14 set_phase\n
+     * - flags: bits 0-1 instrument, 3 being an invalid id, or all instruments for a mass_cancel without bit 2;
+     *   bit 2 Side::Sell; bits 3-5 OrderType, LIMIT four times as likely as every other type; bits 6-7 price
+     *   mutation, 3 an off-unit price, 2 a non positive one or, for an amend, the price the order rests at and, for
+     *   a stop order, a stop-market order\n
+     * - price: signed offset from the middle of the book, within 32 ticks either side\n
+     * - volume: 0 is rejected; from 240 up, an amend moves the volume it rests with by -8 to +7\n
+     * - order id, 16 bits: an add takes a fresh id with the top bit clear, reuses one of the last 256 ids with it
+     *   set; a pull or an amend targets one of the last 256 ids, resting or not, with it clear, an unused id with it
+     *   set\n
+     * - owner: bits 0-1 owner, 0 for none; bits 2-3 StpMode; bits 4-7 peak, 0 up to 10, -1 at 11, 8 to 32 above\n
+     * - aux: signed stop price offset from the middle of the book, as price; set_phase asks for an auction if its
+     *   low two bits are clear, for continuous trading otherwise\n
+     */
+    class Harness {
+    private:
+        static constexpr int64_t UNITS[3] = {1, 5, 25};
+        static constexpr int64_t MIDDLE_TICK = 1000;
+        static constexpr size_t RECENT_IDS = 256;
+        static constexpr size_t BATCH_SIZE = 32;
+        static constexpr size_t MAX_DEPTH = 128;    // prices stay within 32 ticks of the middle, and so levels
+
+        MatchingEngine engine;
+        ReferenceEngine reference;
+        MatchingEngine batched;     // runs adds, amends and pulls through process_batch, see flush_batch
+        InstrumentId instruments[3] = {};
+        InstrumentId reference_instruments[3] = {};
+
+        TradeDS::SpscRing<LevelDelta> deltas{4096};     // level deltas of engine, drained after every command
+        std::map<int64_t, DepthLevel> l2[3][2];         // price - level, per instrument and side, built from deltas
+        DepthLevel depth[MAX_DEPTH] = {};
+        vector<DepthLevel> reference_depth;
+
+        vector<OrderCommand> batch;         // commands engine ran that batched hasn't yet
+        vector<bool> batch_results;         // what engine returned for them
+        vector<CommandFill> batch_fills;    // what engine filled for them, tagged with their index in batch
+        vector<CommandFill> batched_fills;
+        vector<Fill> batched_single_fills;  // of a command batched runs on its own
+
+        uint64_t recent_ids[RECENT_IDS] = {};
+        uint64_t next_order_id = 1;
+        vector<Fill> engine_fills;
+        vector<Fill> reference_fills;
+
+        uint64_t step_count = 0;
+        uint64_t fill_count = 0;
+        string failure;
+
+        uint64_t draw_order_id(uint16_t word) {
+            if ((word & 0x8000) == 0) {
+                const uint64_t order_id = this->next_order_id++;
+                this->recent_ids[order_id % RECENT_IDS] = order_id;
+                return order_id;
+            }
+            return this->recent_ids[word % RECENT_IDS];     // 0 until 256 ids are out, rejected as any 0 id
+        }
+
+        bool fail(const char *command, const char *what) {
+            char message[320];
+            std::snprintf(message, sizeof(message), "step %llu, %s: %s", (unsigned long long) this->step_count,
+                          command, what);
+            this->failure = message;
+            return false;
+        }
+
+        static bool same_fill(const Fill &fill, const Fill &expected) {
+            return fill.other_order_id == expected.other_order_id && fill.trade_price == expected.trade_price &&
+                   fill.trade_volume == expected.trade_volume &&
+                   fill.aggressor_order_id == expected.aggressor_order_id &&
+                   fill.aggressor_remaining_volume == expected.aggressor_remaining_volume &&
+                   fill.other_remaining_volume == expected.other_remaining_volume && fill.type == expected.type &&
+                   fill.other_owner == expected.other_owner;
+        }
+
+        static bool same_depth(const DepthLevel *levels, size_t count, const vector<DepthLevel> &expected) {
+            if (count != expected.size()) return false;
+            for (size_t i = 0; i < count; i++) {
+                if (levels[i].price != expected[i].price || levels[i].volume != expected[i].volume ||
+                    levels[i].order_count != expected[i].order_count) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * compare both engines after a command
+         */
+        bool compare(const char *command, bool engine_result, bool reference_result) {
+            char what[200];
+            if (engine_result != reference_result) {
+                std::snprintf(what, sizeof(what), "returned %d, reference %d", engine_result, reference_result);
+                return this->fail(command, what);
+            }
+            if (this->engine_fills.size() != this->reference_fills.size()) {
+                std::snprintf(what, sizeof(what), "%zu fills, reference %zu", this->engine_fills.size(),
+                              this->reference_fills.size());
+                return this->fail(command, what);
+            }
+            for (size_t i = 0; i < this->engine_fills.size(); i++) {
+                const Fill &fill = this->engine_fills[i];
+                const Fill &expected = this->reference_fills[i];
+                if (!same_fill(fill, expected)) {
+                    std::snprintf(what, sizeof(what),
+                                  "fill %zu is %d %llu-%llu %lld@%lld left %lld/%lld owner %u, "
+                                  "reference %d %llu-%llu %lld@%lld left %lld/%lld owner %u",
+                                  i, (int) fill.type, (unsigned long long) fill.aggressor_order_id,
+                                  (unsigned long long) fill.other_order_id, (long long) fill.trade_volume,
+                                  (long long) fill.trade_price, (long long) fill.aggressor_remaining_volume,
+                                  (long long) fill.other_remaining_volume, fill.other_owner, (int) expected.type,
+                                  (unsigned long long) expected.aggressor_order_id,
+                                  (unsigned long long) expected.other_order_id, (long long) expected.trade_volume,
+                                  (long long) expected.trade_price, (long long) expected.aggressor_remaining_volume,
+                                  (long long) expected.other_remaining_volume, expected.other_owner);
+                    return this->fail(command, what);
+                }
+            }
+            this->fill_count += this->engine_fills.size();
+            return this->apply_deltas(command) && this->compare_books(this->engine, "", command);
+        }
+
+        /**
+         * apply the level deltas engine published to the L2 books, every delta must fit the level it updates
+         */
+        bool apply_deltas(const char *command) {
+            char what[200];
+            LevelDelta delta;
+            bool ended = true;
+            while (this->deltas.pop(delta)) {
+                size_t i = 0;
+                while (i < 3 && this->instruments[i] != delta.instrument) i++;
+                if (i == 3) return this->fail(command, "a level delta of an unknown instrument");
+
+                auto &levels = this->l2[i][delta.side == Side::Buy ? 0 : 1];
+                auto level = levels.find(delta.price);
+                const bool known = (level != levels.end());
+                const bool populated = delta.volume > 0 && delta.order_count > 0;
+                const bool valid = (delta.type == LevelDelta::ADDED) ? !known && populated
+                                   : (delta.type == LevelDelta::CHANGED) ? known && populated
+                                   : known && delta.volume == 0 && delta.order_count == 0;
+                if (!valid) {
+                    std::snprintf(what, sizeof(what), "instrument %zu delta %d of %s %lld@%lld orders %u, %s", i,
+                                  (int) delta.type, delta.side == Side::Buy ? "bid" : "ask", (long long) delta.volume,
+                                  (long long) delta.price, delta.order_count, known ? "level known" : "no level");
+                    return this->fail(command, what);
+                }
+                if (delta.type == LevelDelta::REMOVED) {
+                    levels.erase(level);
+                } else {
+                    levels[delta.price] = DepthLevel{delta.price, delta.volume, delta.order_count};
+                }
+                ended = delta.end_of_message;
+            }
+            if (!ended) return this->fail(command, "the last level delta doesn't end its message");
+            if (this->deltas.dropped() != 0) return this->fail(command, "level deltas dropped");
+            return true;
+        }
+
+        /**
+         * compare the books of an engine with the reference, and the L2 books too for engine
+         * @param target engine or batched
+         * @param which prefix of a difference, to tell the engines apart
+         */
+        bool compare_books(const MatchingEngine &target, const char *which, const char *command) {
+            char what[200];
+            for (size_t i = 0; i < 3; i++) {
+                const BestBidOffer top = target.get_top_of_book(this->instruments[i]);
+                const BestBidOffer expected = this->reference.get_top_of_book(this->reference_instruments[i]);
+                if (top.bid_price != expected.bid_price || top.bid_volume != expected.bid_volume ||
+                    top.ask_price != expected.ask_price || top.ask_volume != expected.ask_volume) {
+                    std::snprintf(what, sizeof(what),
+                                  "%sinstrument %zu top %lld@%lld %lld@%lld, reference %lld@%lld %lld@%lld", which, i,
+                                  (long long) top.bid_volume, (long long) top.bid_price, (long long) top.ask_volume,
+                                  (long long) top.ask_price, (long long) expected.bid_volume,
+                                  (long long) expected.bid_price, (long long) expected.ask_volume,
+                                  (long long) expected.ask_price);
+                    return this->fail(command, what);
+                }
+                const Book *const book = target.get_book(this->instruments[i]);
+                const uint64_t count = book->get_order_count();
+                const uint64_t expected_count = this->reference.get_order_count(this->reference_instruments[i]);
+                if (count != expected_count) {
+                    std::snprintf(what, sizeof(what), "%sinstrument %zu holds %llu orders, reference %llu", which, i,
+                                  (unsigned long long) count, (unsigned long long) expected_count);
+                    return this->fail(command, what);
+                }
+                for (const Side side: {Side::Buy, Side::Sell}) {
+                    const int64_t hidden = book->get_hidden_volume(side);
+                    const int64_t expected_hidden = this->reference.get_hidden_volume(this->reference_instruments[i],
+                                                                                      side);
+                    if (hidden != expected_hidden) {
+                        std::snprintf(what, sizeof(what), "%sinstrument %zu %s reserve %lld, reference %lld", which,
+                                      i, side == Side::Buy ? "buy" : "sell", (long long) hidden,
+                                      (long long) expected_hidden);
+                        return this->fail(command, what);
+                    }
+
+                    this->reference.get_depth(this->reference_instruments[i], side, this->reference_depth);
+                    const size_t levels = target.get_depth(this->instruments[i], side, MAX_DEPTH, this->depth);
+                    if (!same_depth(this->depth, levels, this->reference_depth)) {
+                        std::snprintf(what, sizeof(what), "%sinstrument %zu %s depth of %zu levels, reference %zu",
+                                      which, i, side == Side::Buy ? "bid" : "ask", levels,
+                                      this->reference_depth.size());
+                        return this->fail(command, what);
+                    }
+                    if (&target != &this->engine) continue;
+
+                    // the L2 book from the touch outward, as depth
+                    const auto &l2_levels = this->l2[i][side == Side::Buy ? 0 : 1];
+                    size_t l2_count = 0;
+                    auto collect = [&](const std::pair<const int64_t, DepthLevel> &level) {
+                        if (l2_count < MAX_DEPTH) this->depth[l2_count] = level.second;
+                        l2_count++;
+                    };
+                    if (side == Side::Buy) {
+                        std::for_each(l2_levels.rbegin(), l2_levels.rend(), collect);
+                    } else {
+                        std::for_each(l2_levels.begin(), l2_levels.end(), collect);
+                    }
+                    if (l2_count > MAX_DEPTH || !same_depth(this->depth, l2_count, this->reference_depth)) {
+                        std::snprintf(what, sizeof(what), "instrument %zu %s L2 book of %zu levels, reference %zu",
+                                      i, side == Side::Buy ? "bid" : "ask", l2_count, this->reference_depth.size());
+                        return this->fail(command, what);
+                    }
+                }
+                const uint64_t stop_count = book->get_stop_count();
+                const uint64_t expected_stops = this->reference.get_stop_count(this->reference_instruments[i]);
+                if (stop_count != expected_stops) {
+                    std::snprintf(what, sizeof(what), "%sinstrument %zu holds %llu stop orders, reference %llu",
+                                  which, i, (unsigned long long) stop_count, (unsigned long long) expected_stops);
+                    return this->fail(command, what);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * get the instrument an order rests or waits on, as a batch command must name it
+         * @param fallback instrument of a command on an order neither rests nor waits
+         */
+        InstrumentId instrument_of(uint64_t order_id, InstrumentId fallback) const {
+            const InstrumentId reference_instrument = this->reference.get_instrument(order_id);
+            for (size_t i = 0; i < 3; i++) {
+                if (this->reference_instruments[i] == reference_instrument) return this->instruments[i];
+            }
+            return fallback;
+        }
+
+        /**
+         * queue an add, amend or pull engine ran for batched, with what engine returned and filled for it; a full
+         * batch runs right away
+         */
+        bool enqueue(const OrderCommand &command, bool result) {
+            for (const Fill &fill: this->engine_fills) {
+                this->batch_fills.push_back(CommandFill{this->batch.size(), fill});
+            }
+            this->batch.push_back(command);
+            this->batch_results.push_back(result);
+            return this->batch.size() < BATCH_SIZE || this->flush_batch();
+        }
+
+        /**
+         * run the queued commands as one process_batch on batched, which must return and fill as engine did one
+         * command at a time, and leave the same books
+         */
+        bool flush_batch() {
+            if (this->batch.empty()) return true;
+            char command[64];
+            char what[200];
+            std::snprintf(command, sizeof(command), "batch of %zu commands", this->batch.size());
+            bool accepted[BATCH_SIZE];
+            this->batched_fills.clear();
+            this->batched.process_batch(this->batch.data(), this->batch.size(), this->batched_fills, accepted);
+
+            for (size_t i = 0; i < this->batch.size(); i++) {
+                if (accepted[i] != this->batch_results[i]) {
+                    std::snprintf(what, sizeof(what), "command %zu returned %d, one at a time %d", i, accepted[i],
+                                  (int) this->batch_results[i]);
+                    return this->fail(command, what);
+                }
+            }
+            if (this->batched_fills.size() != this->batch_fills.size()) {
+                std::snprintf(what, sizeof(what), "%zu fills, one at a time %zu", this->batched_fills.size(),
+                              this->batch_fills.size());
+                return this->fail(command, what);
+            }
+            for (size_t i = 0; i < this->batch_fills.size(); i++) {
+                const CommandFill &fill = this->batched_fills[i];
+                const CommandFill &expected = this->batch_fills[i];
+                if (fill.command_index != expected.command_index || !same_fill(fill.fill, expected.fill)) {
+                    std::snprintf(what, sizeof(what), "fill %zu of command %zu, one at a time of command %zu", i,
+                                  fill.command_index, expected.command_index);
+                    return this->fail(command, what);
+                }
+            }
+            this->batch.clear();
+            this->batch_results.clear();
+            this->batch_fills.clear();
+            return this->compare_books(this->batched, "batched ", command);
+        }
+
+        /**
+         * compare batched with engine after a command it doesn't take in a batch, run one at a time
+         * @param same_result whether both returned the same
+         */
+        bool compare_batched(const char *command, bool same_result) {
+            if (!same_result) return this->fail(command, "batched returned otherwise");
+            bool same_fills = this->batched_single_fills.size() == this->engine_fills.size();
+            for (size_t i = 0; same_fills && i < this->engine_fills.size(); i++) {
+                same_fills = same_fill(this->batched_single_fills[i], this->engine_fills[i]);
+            }
+            if (!same_fills) return this->fail(command, "batched filled otherwise");
+            return this->compare_books(this->batched, "batched ", command);
+        }
+
+    public:
+        static constexpr size_t COMMAND_SIZE = 8;
+
+        Harness() {
+            for (size_t i = 0; i < 3; i++) {
+                const string symbol = "DIFF" + std::to_string(i);
+                this->instruments[i] = this->engine.create_book(symbol, UNITS[i]);
+                this->reference_instruments[i] = this->reference.create_book(UNITS[i]);
+                this->batched.create_book(symbol, UNITS[i]);
+                this->engine.set_delta_feed(this->instruments[i], &this->deltas);
+            }
+        }
+
+        Harness(Harness const &rhs) = delete;
+
+        Harness &operator=(Harness const &rhs) = delete;
+
+        /**
+         * decode and run one command on both engines, queue it for batched or run it there too, then compare them
+         * @param input
+         * @return False on the first difference, see get_failure
+         */
+        bool step(ByteReader &input) {
+            const uint8_t op = input.byte() % 16;
+            const uint8_t flags = input.byte();
+            const int8_t offset = (int8_t) input.byte();
+            const uint8_t volume_byte = input.byte();
+            const uint16_t id_word = input.word();
+            const uint8_t owner_byte = input.byte();
+            const int8_t aux = (int8_t) input.byte();
+            this->step_count++;
+            this->engine_fills.clear();
+            this->reference_fills.clear();
+            this->batched_single_fills.clear();
+
+            const size_t index = flags & 3;
+            const int64_t unit = UNITS[index < 3 ? index : 0];
+            const InstrumentId instrument = (index < 3) ? this->instruments[index] : this->instruments[2] + 1;
+            const InstrumentId reference_instrument = (index < 3) ? this->reference_instruments[index]
+                                                               : this->reference_instruments[2] + 1;
+            const Side side = (flags & 4) ? Side::Sell : Side::Buy;
+            const uint8_t type_bits = (flags >> 3) & 7;
+            const OrderType type = (type_bits < 4) ? OrderType::LIMIT : (OrderType) (type_bits - 3);
+            const uint8_t mutation = flags >> 6;
+            int64_t price = (MIDDLE_TICK + offset / 4) * unit;
+            if (mutation == 3) price += (unit > 1) ? 1 : -price;    // off-unit, or 0 where every price is on unit
+            if (mutation == 2) price = -price;
+
+            const OwnerId owner = owner_byte & 3;
+            const auto stp = (StpMode) ((owner_byte >> 2) & 3);
+            const int peak_bits = owner_byte >> 4;
+            const int64_t peak = (peak_bits < 11) ? 0 : (peak_bits == 11) ? -1 : (peak_bits - 11) * 8;
+
+            char command[128];
+            if (op < 7 || op == 15) {
+                const uint64_t order_id = this->draw_order_id(id_word);
+                const int64_t volume = volume_byte;
+                std::snprintf(command, sizeof(command),
+                              "add %llu instrument %zu %s type %d %lld@%lld owner %u stp %d peak %lld",
+                              (unsigned long long) order_id, index, side == Side::Buy ? "buy" : "sell", (int) type,
+                              (long long) volume, (long long) price, owner, (int) stp, (long long) peak);
+                const bool result = this->engine.add_order(order_id, instrument, side, price, volume,
+                                                           this->engine_fills, type, owner, stp, peak);
+                const bool expected = this->reference.add_order(order_id, reference_instrument, side, price, volume,
+                                                                this->reference_fills, type, owner, stp, peak);
+                return this->compare(command, result, expected) &&
+                       this->enqueue({OrderCommand::ADD, type, side, instrument, order_id, price, volume, owner, stp,
+                                      peak}, result);
+            }
+
+            // the other commands aren't batch commands, batched runs them one at a time, after what it has queued
+            if (op >= 12 && !this->flush_batch()) return false;
+
+            if (op == 12) {
+                const uint64_t order_id = this->draw_order_id(id_word);
+                const int64_t stop_price = (MIDDLE_TICK + aux / 4) * unit;
+                if (mutation == 2) price = 0;   // stop-market
+                const int64_t volume = volume_byte;
+                std::snprintf(command, sizeof(command),
+                              "stop %llu instrument %zu %s %lld@%lld at %lld owner %u stp %d",
+                              (unsigned long long) order_id, index, side == Side::Buy ? "buy" : "sell",
+                              (long long) volume, (long long) price, (long long) stop_price, owner, (int) stp);
+                const bool result = this->engine.add_stop_order(order_id, instrument, side, stop_price, price, volume,
+                                                                this->engine_fills, owner, stp);
+                const bool expected = this->reference.add_stop_order(order_id, reference_instrument, side, stop_price,
+                                                                     price, volume, this->reference_fills, owner, stp);
+                const bool batched_result = this->batched.add_stop_order(order_id, instrument, side, stop_price,
+                                                                         price, volume, this->batched_single_fills,
+                                                                         owner, stp);
+                return this->compare(command, result, expected) &&
+                       this->compare_batched(command, batched_result == result);
+            }
+
+            if (op == 13) {
+                // instrument 0 is every instrument, only for mass_cancel
+                const bool all = (index == 3 && side == Side::Buy);
+                std::snprintf(command, sizeof(command), "mass cancel owner %u instrument %zu%s", owner, index,
+                              all ? " (all)" : "");
+                const size_t result = this->engine.mass_cancel(owner, all ? 0 : instrument);
+                const size_t expected = this->reference.mass_cancel(owner, all ? 0 : reference_instrument);
+                const size_t batched_result = this->batched.mass_cancel(owner, all ? 0 : instrument);
+                if (result != expected) {
+                    char what[64];
+                    std::snprintf(what, sizeof(what), "cancelled %zu, reference %zu", result, expected);
+                    return this->fail(command, what);
+                }
+                return this->compare(command, true, true) &&
+                       this->compare_batched(command, batched_result == result);
+            }
+
+            if (op == 14) {
+                const TradingPhase phase = (aux & 3) == 0 ? TradingPhase::AUCTION : TradingPhase::CONTINUOUS;
+                std::snprintf(command, sizeof(command), "phase instrument %zu %s", index,
+                              phase == TradingPhase::AUCTION ? "auction" : "continuous");
+                const bool result = this->engine.set_phase(instrument, phase, this->engine_fills);
+                const bool expected = this->reference.set_phase(reference_instrument, phase, this->reference_fills);
+                const bool batched_result = this->batched.set_phase(instrument, phase, this->batched_single_fills);
+                return this->compare(command, result, expected) &&
+                       this->compare_batched(command, batched_result == result);
+            }
+
+            const uint64_t order_id = (id_word & 0x8000) ? this->next_order_id : this->recent_ids[id_word % RECENT_IDS];
+            const InstrumentId target_instrument = this->instrument_of(order_id, instrument);
+            if (op < 9) {
+                std::snprintf(command, sizeof(command), "pull %llu", (unsigned long long) order_id);
+                const bool result = this->engine.pull_order(order_id);
+                const bool expected = this->reference.pull_order(order_id);
+                return this->compare(command, result, expected) &&
+                       this->enqueue({OrderCommand::PULL, OrderType::LIMIT, Side::Buy, target_instrument, order_id, 0,
+                                      0, 0, StpMode::NONE, 0}, result);
+            }
+
+            int64_t resting_price = 0, resting_volume = 0, volume = volume_byte;
+            if (this->reference.get_order(order_id, resting_price, resting_volume)) {
+                if (mutation == 2) price = resting_price;
+                if (volume_byte >= 240) volume = resting_volume + (volume_byte - 248);
+            }
+            std::snprintf(command, sizeof(command), "amend %llu to %lld@%lld", (unsigned long long) order_id,
+                          (long long) volume, (long long) price);
+            const bool result = this->engine.amend_order(order_id, price, volume, this->engine_fills);
+            const bool expected = this->reference.amend_order(order_id, price, volume, this->reference_fills);
+            return this->compare(command, result, expected) &&
+                   this->enqueue({OrderCommand::AMEND, OrderType::LIMIT, Side::Buy, target_instrument, order_id, price,
+                                  volume, 0, StpMode::NONE, 0}, result);
+        }
+
+        /**
+         * run a whole command stream
+         * @param data
+         * @param size
+         * @return False on the first difference, see get_failure
+         */
+        bool run(const uint8_t *data, size_t size) {
+            ByteReader input(data, size);
+            while (!input.empty()) {
+                if (!this->step(input)) return false;
+            }
+            return this->flush_batch();
+        }
+
+        /**
+         * get the description of the first difference, empty if none
+         */
+        const string &get_failure() const { return this->failure; }
+
+        uint64_t get_step_count() const { return this->step_count; }
+
+        uint64_t get_fill_count() const { return this->fill_count; }
+    };
+}
+
+#endif  // !DIFFERENTIAL_H
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "differential.hpp"
+
+namespace {
+    void usage(const char *program) {
+        std::fprintf(stderr, "usage: %s [seeds=64] [commands=100000] [budget_ms=0] [first_seed=1]\n"
+                             "       runs seeds one after the other, fails on the first divergence, or if budget_ms "
+                             "runs out before all passed, 0 for no budget\n", program);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 5) {
+        usage(argv[0]);
+        return 1;
+    }
+    const uint64_t seeds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    const uint64_t commands = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    const uint64_t budget_ms = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+    const uint64_t first_seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+    if (seeds == 0 || commands == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto deadline = start_time + std::chrono::milliseconds(budget_ms);
+    vector<uint8_t> input(commands * Differential::Harness::COMMAND_SIZE);
+    uint64_t seeds_run = 0, steps = 0, fills = 0;
+
+    for (uint64_t seed = first_seed; seed < first_seed + seeds; seed++) {
+        if (budget_ms != 0 && std::chrono::steady_clock::now() >= deadline) break;
+
+        std::mt19937_64 rng(seed);
+        for (uint8_t &byte: input) byte = (uint8_t) rng();
+
+        Differential::Harness harness;
+        const bool passed = harness.run(input.data(), input.size());
+        seeds_run++;
+        steps += harness.get_step_count();
+        fills += harness.get_fill_count();
+        if (!passed) {
+            std::fprintf(stderr, "seed %llu diverged at %s\n", (unsigned long long) seed,
+                         harness.get_failure().c_str());
+            return 1;
+        }
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end_time - start_time).count();
+    if (budget_ms != 0 && end_time > deadline) {
+        std::fprintf(stderr, "over budget: %llu of %llu seeds, %llu commands in %.3f s, budget %.3f s\n",
+                     (unsigned long long) seeds_run, (unsigned long long) seeds, (unsigned long long) steps, elapsed,
+                     (double) budget_ms / 1000);
+        return 1;
+    }
+    std::printf("%llu seeds, %llu commands, %llu fills in %.3f s, %.0f commands/sec, no divergence\n",
+                (unsigned long long) seeds_run, (unsigned long long) steps, (unsigned long long) fills, elapsed,
+                elapsed > 0 ? (double) steps / elapsed : 0.0);
+    return 0;
+}
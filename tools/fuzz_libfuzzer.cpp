@@ -0,0 +1,17 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "differential.hpp"
+
+/**
+ * libFuzzer entry point, every input is one command stream on a fresh Harness, see Differential::Harness
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    Differential::Harness harness;
+    if (!harness.run(data, size)) {
+        std::fprintf(stderr, "diverged at %s\n", harness.get_failure().c_str());
+        std::abort();
+    }
+    return 0;
+}
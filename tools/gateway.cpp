@@ -0,0 +1,58 @@
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+
+#include "gateway.hpp"
+#include "matching_engine.hpp"
+
+namespace {
+    Gateway *running_gateway = nullptr;
+
+    void on_signal(int) {
+        if (running_gateway != nullptr) running_gateway->stop();
+    }
+
+    void usage(const char *program) {
+        std::fprintf(stderr, "usage: %s [port=0] [instruments=16] [unit=1]\n"
+                             "       serves the order entry protocol of wire_format.hpp, until SIGINT\n", program);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    const long port = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 0;
+    const long instruments = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 16;
+    const long long unit = argc > 3 ? std::strtoll(argv[3], nullptr, 10) : 1;
+    if (port < 0 || port > 0xffff || instruments <= 0 || unit <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    MatchingEngine engine;
+    for (long i = 0; i < instruments; i++) {
+        const string symbol = "SYM" + std::to_string(i);
+        std::printf("%s instrument %u\n", symbol.c_str(), (unsigned) engine.create_book(symbol, unit));
+    }
+
+    GatewayConfig config;
+    config.port = (uint16_t) port;
+    Gateway gateway(engine, config);
+    if (!gateway.open()) {
+        std::perror("listen");
+        return 1;
+    }
+    std::printf("listening on port %u\n", (unsigned) gateway.get_port());
+    std::fflush(stdout);
+
+    running_gateway = &gateway;
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    gateway.run();
+    running_gateway = nullptr;
+    return 0;
+}
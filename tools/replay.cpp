@@ -0,0 +1,406 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cycle_clock.hpp"
+#include "instrumentation.hpp"
+#include "latency_histogram.hpp"
+#include "matching_engine.hpp"
+#include "replay_format.hpp"
+
+using TradeDS::CycleClock, TradeDS::Instrumentation, TradeDS::LatencyHistogram;
+
+namespace {
+    /**
+     * one 64-bit FNV-1a step over the 8 bytes of value
+     */
+    uint64_t fnv1a(uint64_t hash, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (8 * i)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    /**
+     * checksum of a book's resting orders in priority order: order_id, side, price and volume of each
+     */
+    uint64_t checksum(const Book &book) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const Order *order: book.get_orders()) {
+            hash = fnv1a(hash, order->order_id);
+            hash = fnv1a(hash, order->side == Side::Buy ? 0 : 1);
+            hash = fnv1a(hash, (uint64_t) order->price);
+            hash = fnv1a(hash, order->volume);
+        }
+        return hash;
+    }
+
+    /**
+     * append a packed message to a byte buffer
+     */
+    template<typename Message>
+    void append(vector<char> &buffer, Message message, Replay::MessageType type) {
+        message.header.length = sizeof(Message);
+        message.header.type = type;
+        const char *bytes = reinterpret_cast<const char *>(&message);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(Message));
+    }
+
+    /**
+     * Synthetic order flow with production-like proportions: most adds rest near the touch and most of them get
+     * cancelled, a few cross; generated against a live MatchingEngine so every cancel and replace targets an order
+     * that is still resting at that point of the stream
+     */
+    class FlowGenerator {
+    private:
+        struct Instrument {
+            uint16_t locate;
+            InstrumentId instrument;
+            int64_t unit;
+            int64_t mid;                // in ticks
+            vector<uint64_t> live;      // order ids resting in this book
+        };
+
+        MatchingEngine engine;
+        std::mt19937_64 rng;
+        vector<Instrument> instruments;
+        unordered_map<uint64_t, std::pair<size_t, size_t>> positions;     // order_id - instrument index, live index
+        uint64_t next_order_id = 1;
+
+        void track(size_t index, uint64_t order_id) {
+            auto &live = this->instruments[index].live;
+            this->positions[order_id] = {index, live.size()};
+            live.push_back(order_id);
+        }
+
+        void forget(uint64_t order_id) {
+            auto it = this->positions.find(order_id);
+            if (it == this->positions.end()) return;
+
+            auto &live = this->instruments[it->second.first].live;
+            const size_t position = it->second.second;
+            live[position] = live.back();
+            this->positions[live[position]].second = position;
+            live.pop_back();
+            this->positions.erase(it);
+        }
+
+        int64_t draw_offset() {
+            // geometric distance from the mid, mostly within a few ticks
+            return 1 + __builtin_ctzll(this->rng() | (1ull << 20)) * 2 + (int64_t) (this->rng() % 3);
+        }
+
+        uint32_t draw_volume() {
+            return (this->rng() % 20 == 0) ? 100 * (uint32_t) (10 + this->rng() % 90)
+                                            : 100 * (uint32_t) (1 + this->rng() % 10);
+        }
+
+    public:
+        explicit FlowGenerator(uint64_t seed) : rng{seed} {}
+
+        /**
+         * generate a recording
+         * @param path output file
+         * @param message_count number of order messages, directory messages excluded
+         * @param instrument_count
+         * @return True on success
+         */
+        bool generate(const char *path, uint64_t message_count, uint16_t instrument_count) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+
+            vector<char> buffer;
+            Replay::FileHeader file_header{};
+            std::memcpy(file_header.magic, Replay::MAGIC, sizeof(Replay::MAGIC));
+            file_header.version = Replay::VERSION;
+            buffer.insert(buffer.end(), reinterpret_cast<const char *>(&file_header),
+                          reinterpret_cast<const char *>(&file_header) + sizeof(file_header));
+
+            for (uint16_t locate = 0; locate < instrument_count; locate++) {
+                Replay::DirectoryMessage message{};
+                char symbol[16];
+                std::snprintf(symbol, sizeof(symbol), "SYM%-5u", (unsigned) locate);
+                std::memcpy(message.symbol, symbol, sizeof(message.symbol));
+                message.locate = locate;
+                message.unit = (locate % 2 == 0) ? 1 : 5;
+                append(buffer, message, Replay::DIRECTORY);
+
+                const InstrumentId instrument = this->engine.create_book(string(symbol, 8), message.unit);
+                this->instruments.push_back({locate, instrument, message.unit, 10000, {}});
+            }
+
+            auto on_fill = [this](const Fill &fill) {
+                if (fill.other_remaining_volume == 0) this->forget(fill.other_order_id);
+            };
+
+            for (uint64_t n = 0; n < message_count; n++) {
+                // low locates are busier
+                const size_t index = std::min(this->rng() % instrument_count, this->rng() % instrument_count);
+                Instrument &target = this->instruments[index];
+                if (this->rng() % 50 == 0) target.mid += (this->rng() & 1) ? 1 : -1;
+                if (target.mid < 100) target.mid = 100;
+
+                const uint64_t roll = this->rng() % 100;
+                if (target.live.empty() || roll < 50) {
+                    // add, one in ten crosses the mid
+                    Replay::AddMessage message{};
+                    const bool buy = this->rng() & 1;
+                    const int64_t offset = (roll % 10 == 0) ? -this->draw_offset() : this->draw_offset();
+                    message.locate = target.locate;
+                    message.order_id = this->next_order_id++;
+                    message.side = buy ? 'B' : 'S';
+                    message.volume = this->draw_volume();
+                    message.price = (buy ? target.mid - offset : target.mid + offset) * target.unit;
+                    append(buffer, message, Replay::ADD);
+
+                    this->engine.add_order(message.order_id, target.instrument, buy ? Side::Buy : Side::Sell,
+                                           message.price, message.volume, on_fill);
+                    if (this->engine.get_order(message.order_id) != nullptr) this->track(index, message.order_id);
+                } else if (roll < 90) {
+                    // cancel
+                    Replay::DeleteMessage message{};
+                    message.locate = target.locate;
+                    message.order_id = target.live[this->rng() % target.live.size()];
+                    append(buffer, message, Replay::DELETE);
+
+                    this->engine.pull_order(message.order_id);
+                    this->forget(message.order_id);
+                } else {
+                    // replace, mostly a volume reduction keeping priority, otherwise a move near the mid
+                    Replay::ReplaceMessage message{};
+                    message.locate = target.locate;
+                    message.order_id = target.live[this->rng() % target.live.size()];
+                    const Order *order = this->engine.get_order(message.order_id);
+                    if (this->rng() % 10 < 6) {
+                        message.volume = (uint32_t) (1 + this->rng() % order->volume);
+                        message.price = order->price * target.unit;
+                    } else {
+                        const int64_t offset = this->draw_offset();
+                        message.volume = this->draw_volume();
+                        message.price = (order->side == Side::Buy ? target.mid - offset : target.mid + offset) *
+                                        target.unit;
+                    }
+                    append(buffer, message, Replay::REPLACE);
+
+                    this->engine.amend_order(target.instrument, message.order_id, message.price, message.volume,
+                                             on_fill);
+                    if (this->engine.get_order(message.order_id) == nullptr) this->forget(message.order_id);
+                }
+
+                if (buffer.size() > (1 << 20)) {
+                    out.write(buffer.data(), (std::streamsize) buffer.size());
+                    buffer.clear();
+                }
+            }
+            out.write(buffer.data(), (std::streamsize) buffer.size());
+            return (bool) out;
+        }
+    };
+
+    enum MessageKind { ADD, REPLACE, DELETE, KINDS };
+
+    const char *KIND_NAMES[KINDS] = {"add", "replace", "delete"};
+
+    /**
+     * drive a memory-mapped recording through a MatchingEngine and report throughput, latencies and checksums
+     * @param path
+     * @param timed if every engine call is timed, costs two CycleClock reads per message
+     * @return process exit code
+     */
+    int replay(const char *path, bool timed) {
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            std::perror(path);
+            return 1;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(Replay::FileHeader)) {
+            std::fprintf(stderr, "%s: not a replay file\n", path);
+            close(fd);
+            return 1;
+        }
+        const size_t size = info.st_size;
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            std::perror("mmap");
+            return 1;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        const char *cursor = static_cast<const char *>(mapping);
+        const char *const end = cursor + size;
+
+        Replay::FileHeader file_header{};
+        std::memcpy(&file_header, cursor, sizeof(file_header));
+        if (std::memcmp(file_header.magic, Replay::MAGIC, sizeof(Replay::MAGIC)) != 0 ||
+            file_header.version != Replay::VERSION) {
+            std::fprintf(stderr, "%s: bad magic or version\n", path);
+            munmap(mapping, size);
+            return 1;
+        }
+        cursor += sizeof(file_header);
+
+        MatchingEngine engine;
+        vector<InstrumentId> instruments(1 << 16, 0);   // locate - instrument id
+        vector<std::pair<string, InstrumentId>> directory;
+        LatencyHistogram histograms[KINDS];
+        uint64_t counts[KINDS] = {};
+        uint64_t rejected[KINDS] = {};
+        uint64_t malformed = 0;
+        uint64_t fill_count = 0;
+        auto on_fill = [&fill_count](const Fill &) { fill_count++; };
+
+        auto execute = [&](MessageKind kind, auto &&operation) {
+            bool ok;
+            if (timed) {
+                const uint64_t start = CycleClock::now();
+                ok = operation();
+                histograms[kind].record(CycleClock::now() - start);
+            } else {
+                ok = operation();
+            }
+            counts[kind]++;
+            if (!ok) rejected[kind]++;
+        };
+
+        const auto start_time = std::chrono::steady_clock::now();
+        while (cursor + sizeof(Replay::MessageHeader) <= end) {
+            Replay::MessageHeader header{};
+            std::memcpy(&header, cursor, sizeof(header));
+            if (header.length < sizeof(header) || cursor + header.length > end) {
+                std::fprintf(stderr, "%s: truncated message at offset %zu\n", path,
+                             (size_t) (cursor - static_cast<const char *>(mapping)));
+                break;
+            }
+
+            switch (header.type) {
+                case Replay::DIRECTORY: {
+                    Replay::DirectoryMessage message{};
+                    if (header.length < sizeof(message)) break;
+                    std::memcpy(&message, cursor, sizeof(message));
+
+                    string symbol(message.symbol, sizeof(message.symbol));
+                    symbol.erase(symbol.find_last_not_of(' ') + 1);
+                    instruments[message.locate] = engine.create_book(symbol, message.unit);
+                    directory.emplace_back(symbol, instruments[message.locate]);
+                    break;
+                }
+                case Replay::ADD: {
+                    Replay::AddMessage message{};
+                    if (header.length < sizeof(message)) break;
+                    std::memcpy(&message, cursor, sizeof(message));
+
+                    const Side side = message.side == 'B' ? Side::Buy : Side::Sell;
+                    execute(ADD, [&] {
+                        return engine.add_order(message.order_id, instruments[message.locate], side, message.price,
+                                                message.volume, on_fill);
+                    });
+                    break;
+                }
+                case Replay::REPLACE: {
+                    Replay::ReplaceMessage message{};
+                    if (header.length < sizeof(message)) break;
+                    std::memcpy(&message, cursor, sizeof(message));
+
+                    execute(REPLACE, [&] {
+                        return engine.amend_order(instruments[message.locate], message.order_id, message.price,
+                                                  message.volume, on_fill);
+                    });
+                    break;
+                }
+                case Replay::DELETE: {
+                    Replay::DeleteMessage message{};
+                    if (header.length < sizeof(message)) break;
+                    std::memcpy(&message, cursor, sizeof(message));
+
+                    execute(DELETE, [&] { return engine.pull_order(message.order_id); });
+                    break;
+                }
+                default:
+                    malformed++;    // unknown type, skipped by length
+            }
+            cursor += header.length;
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        munmap(mapping, size);
+
+        // report
+        const uint64_t total = counts[ADD] + counts[REPLACE] + counts[DELETE];
+        std::printf("replayed %llu messages in %.3f s, %.0f msgs/sec, %llu fills, %llu unknown\n",
+                    (unsigned long long) total, elapsed, elapsed > 0 ? (double) total / elapsed : 0.0,
+                    (unsigned long long) fill_count, (unsigned long long) malformed);
+
+        std::printf("\n%-8s %12s %10s %10s %10s %10s %10s %12s\n", "type", "count", "rejected", "mean_ns", "p50_ns",
+                    "p99_ns", "p99.9_ns", "max_ns");
+        for (int kind = 0; kind < KINDS; kind++) {
+            const LatencyHistogram &histogram = histograms[kind];
+            std::printf("%-8s %12llu %10llu %10.1f %10.1f %10.1f %10.1f %12.1f\n", KIND_NAMES[kind],
+                        (unsigned long long) counts[kind], (unsigned long long) rejected[kind],
+                        histogram.mean() * CycleClock::ns_per_tick(), CycleClock::to_ns(histogram.percentile(0.50)),
+                        CycleClock::to_ns(histogram.percentile(0.99)), CycleClock::to_ns(histogram.percentile(0.999)),
+                        CycleClock::to_ns(histogram.max()));
+        }
+
+        std::printf("\n%-8s %10s %14s %14s %12s %12s %18s\n", "symbol", "orders", "buy_volume", "sell_volume", "bid",
+                    "ask", "checksum");
+        for (const auto &[symbol, instrument]: directory) {
+            const Book *book = engine.get_book(instrument);
+            if (book == nullptr) continue;
+            const BestBidOffer top = engine.get_top_of_book(instrument);
+            std::printf("%-8s %10llu %14lld %14lld %12lld %12lld   %016llx\n", symbol.c_str(),
+                        (unsigned long long) book->get_order_count(), (long long) book->get_buy_volume(),
+                        (long long) book->get_sell_volume(), (long long) top.bid_price, (long long) top.ask_price,
+                        (unsigned long long) checksum(*book));
+        }
+
+        // per-stage breakdown, only in a -DMATCHING_ENGINE_INSTRUMENTATION=ON build
+        if (Instrumentation::ENABLED) std::printf("\n%s", Instrumentation::dump().c_str());
+        return 0;
+    }
+
+    void usage(const char *program) {
+        std::fprintf(stderr,
+                     "usage: %s <recording> [--untimed]\n"
+                     "       %s --generate <recording> [messages=1000000] [instruments=16] [seed=1]\n",
+                     program, program);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && std::strcmp(argv[1], "--generate") == 0) {
+        const uint64_t messages = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000000;
+        const long instruments = argc > 4 ? std::strtol(argv[4], nullptr, 10) : 16;
+        const uint64_t seed = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1;
+        if (instruments <= 0 || instruments > 0xffff) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        FlowGenerator generator(seed);
+        if (!generator.generate(argv[2], messages, (uint16_t) instruments)) {
+            std::perror(argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 2 || (argc == 3 && std::strcmp(argv[2], "--untimed") == 0)) return replay(argv[1], argc == 2);
+
+    usage(argv[0]);
+    return 1;
+}
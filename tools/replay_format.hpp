@@ -0,0 +1,70 @@
+#ifndef REPLAY_FORMAT_H
+#define REPLAY_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * An ITCH-like binary order-flow recording, as read by matching_engine_replay\n
+ * \n
+ * A file is a FileHeader followed by back to back messages, every message starts with a MessageHeader
+ * whose length covers the whole message, so readers can skip types they don't know\n
+ * All fields are packed and little-endian; prices are in API units, not ticks\n
+ * Instruments are referred to by a 16-bit locate code, introduced once by a DirectoryMessage\n
+ */
+namespace Replay {
+    constexpr char MAGIC[8] = {'M', 'E', 'R', 'E', 'P', 'L', 'A', 'Y'};
+    constexpr uint32_t VERSION = 1;
+
+    enum MessageType : char {
+        DIRECTORY = 'R',    // a new instrument
+        ADD = 'A',          // a new order, may trade
+        REPLACE = 'U',      // amend price and/or volume of a resting order, may trade
+        DELETE = 'D',       // cancel a resting order
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+    };
+
+    struct MessageHeader {
+        uint16_t length;    // bytes of the whole message, header included
+        char type;
+    };
+
+    struct DirectoryMessage {
+        MessageHeader header;
+        uint16_t locate;
+        char symbol[8];     // right padded with spaces
+        int64_t unit;
+    };
+
+    struct AddMessage {
+        MessageHeader header;
+        uint16_t locate;
+        uint64_t order_id;
+        char side;          // 'B' or 'S'
+        uint32_t volume;
+        int64_t price;
+    };
+
+    struct ReplaceMessage {
+        MessageHeader header;
+        uint16_t locate;
+        uint64_t order_id;
+        uint32_t volume;
+        int64_t price;
+    };
+
+    struct DeleteMessage {
+        MessageHeader header;
+        uint16_t locate;
+        uint64_t order_id;
+    };
+#pragma pack(pop)
+}
+
+#endif  // !REPLAY_FORMAT_H